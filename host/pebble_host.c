@@ -0,0 +1,1506 @@
+// Host build of the SDK: see pebble.h and pebble_host.h
+//
+// Draws into one framebuffer in the watch's own format (8-bit argb on color
+// platforms, 1-bit with the leftmost pixel in the low bit on black and
+// white), which persists between frames as the watch's does. Time is
+// simulated: app_event_loop() jumps the clock straight to whichever timer,
+// tick or animation frame is due next, and renders the window whenever a
+// layer was marked dirty, the whole layer tree at once as PebbleOS does
+
+#include "pebble_host.h"
+
+#include <malloc.h>
+#include <stdarg.h>
+
+// Monday 2026-01-05 00:00 UTC; the host clock runs in UTC
+#define HOST_EPOCH_S 1767571200LL
+#define HOST_ANIMATION_FRAME_MS 33
+#define HOST_PERSIST_MAX_KEYS 128
+
+#ifndef HOST_HEAP_BYTES
+#define HOST_HEAP_BYTES 65536
+#endif
+
+#ifdef PBL_COLOR
+#define HOST_FRAMEBUFFER_FORMAT GBitmapFormat8Bit
+#else
+#define HOST_FRAMEBUFFER_FORMAT GBitmapFormat1Bit
+#endif
+
+static int64_t clock_ms = HOST_EPOCH_S * 1000;
+
+// Logging
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number,
+             const char *fmt, ...) {
+  const char *name = strrchr(src_filename, '/');
+  const char *level = log_level <= APP_LOG_LEVEL_ERROR     ? "E"
+                      : log_level <= APP_LOG_LEVEL_WARNING ? "W"
+                      : log_level <= APP_LOG_LEVEL_INFO    ? "I"
+                                                           : "D";
+  printf("[%s] %s:%d> ", level, name ? name + 1 : src_filename,
+         src_line_number);
+  va_list args;
+  va_start(args, fmt);
+  vprintf(fmt, args);
+  va_end(args);
+  putchar('\n');
+}
+
+// Bitmaps
+
+struct GBitmap {
+  uint8_t *addr; // Shared with the parent for sub-bitmaps
+  uint16_t row_size_bytes;
+  GBitmapFormat format;
+  GRect bounds; // Where in addr's rows this bitmap sits
+  GColor *palette;
+  bool is_data_owned;
+  bool is_palette_owned;
+};
+
+static uint16_t row_size_for(GBitmapFormat format, int width) {
+  switch (format) {
+  case GBitmapFormat1Bit:
+    return ((width + 31) / 32) * 4; // Word aligned, like the framebuffer
+  case GBitmapFormat1BitPalette:
+    return (width + 7) / 8;
+  case GBitmapFormat2BitPalette:
+    return (width + 3) / 4;
+  case GBitmapFormat4BitPalette:
+    return (width + 1) / 2;
+  default:
+    return width;
+  }
+}
+
+static int palette_size_for(GBitmapFormat format) {
+  switch (format) {
+  case GBitmapFormat1BitPalette:
+    return 2;
+  case GBitmapFormat2BitPalette:
+    return 4;
+  case GBitmapFormat4BitPalette:
+    return 16;
+  default:
+    return 0;
+  }
+}
+
+static GBitmap *bitmap_create(GSize size, GBitmapFormat format) {
+  if (size.w <= 0 || size.h <= 0) {
+    return NULL;
+  }
+  GBitmap *bmp = calloc(1, sizeof(GBitmap));
+  const uint16_t row_size = row_size_for(format, size.w);
+  uint8_t *addr = calloc(size.h, row_size);
+  if (!bmp || !addr) {
+    free(bmp);
+    free(addr);
+    return NULL;
+  }
+  *bmp = (GBitmap){.addr = addr,
+                   .row_size_bytes = row_size,
+                   .format = format,
+                   .bounds = {.size = size},
+                   .is_data_owned = true};
+  return bmp;
+}
+
+GBitmap *gbitmap_create_blank(GSize size, GBitmapFormat format) {
+  GBitmap *bmp = bitmap_create(size, format);
+  const int colors = palette_size_for(format);
+  if (bmp && colors > 0) {
+    gbitmap_set_palette(bmp, calloc(colors, sizeof(GColor)), true);
+  }
+  return bmp;
+}
+
+GBitmap *gbitmap_create_blank_with_palette(GSize size, GBitmapFormat format,
+                                           GColor *palette,
+                                           bool free_on_destroy) {
+  GBitmap *bmp = bitmap_create(size, format);
+  if (bmp) {
+    gbitmap_set_palette(bmp, palette, free_on_destroy);
+  }
+  return bmp;
+}
+
+GBitmap *gbitmap_create_with_resource(uint32_t resource_id) {
+  if ((int)resource_id >= HOST_RESOURCE_COUNT ||
+      !HOST_RESOURCES[resource_id].data) {
+    return NULL;
+  }
+  const HostResource *res = &HOST_RESOURCES[resource_id];
+  GBitmap *bmp = bitmap_create(GSize(res->width, res->height),
+                               GBitmapFormat1BitPalette);
+  GColor *palette = malloc(2 * sizeof(GColor));
+  if (!bmp || !palette) {
+    gbitmap_destroy(bmp);
+    free(palette);
+    return NULL;
+  }
+  memcpy(bmp->addr, res->data, bmp->row_size_bytes * res->height);
+  palette[0] = GColorBlack;
+  palette[1] = GColorWhite;
+  gbitmap_set_palette(bmp, palette, true);
+  return bmp;
+}
+
+static GRect rect_intersect(GRect a, GRect b) {
+  const int x0 = a.origin.x > b.origin.x ? a.origin.x : b.origin.x;
+  const int y0 = a.origin.y > b.origin.y ? a.origin.y : b.origin.y;
+  const int ax1 = a.origin.x + a.size.w;
+  const int bx1 = b.origin.x + b.size.w;
+  const int ay1 = a.origin.y + a.size.h;
+  const int by1 = b.origin.y + b.size.h;
+  const int x1 = ax1 < bx1 ? ax1 : bx1;
+  const int y1 = ay1 < by1 ? ay1 : by1;
+  if (x1 <= x0 || y1 <= y0) {
+    return GRectZero;
+  }
+  return GRect(x0, y0, x1 - x0, y1 - y0);
+}
+
+GBitmap *gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap,
+                                      GRect sub_rect) {
+  const GRect bounds = rect_intersect(sub_rect, base_bitmap->bounds);
+  GBitmap *bmp = calloc(1, sizeof(GBitmap));
+  if (!bmp || bounds.size.w == 0) {
+    free(bmp);
+    return NULL;
+  }
+  *bmp = *base_bitmap;
+  bmp->bounds = bounds;
+  bmp->is_data_owned = false;
+  bmp->is_palette_owned = false;
+  return bmp;
+}
+
+void gbitmap_destroy(GBitmap *bitmap) {
+  if (!bitmap) {
+    return;
+  }
+  if (bitmap->is_data_owned) {
+    free(bitmap->addr);
+  }
+  if (bitmap->is_palette_owned) {
+    free(bitmap->palette);
+  }
+  free(bitmap);
+}
+
+uint8_t *gbitmap_get_data(const GBitmap *bitmap) { return bitmap->addr; }
+
+uint16_t gbitmap_get_bytes_per_row(const GBitmap *bitmap) {
+  return bitmap->row_size_bytes;
+}
+
+GBitmapFormat gbitmap_get_format(const GBitmap *bitmap) {
+  return bitmap->format;
+}
+
+GRect gbitmap_get_bounds(const GBitmap *bitmap) { return bitmap->bounds; }
+
+void gbitmap_set_bounds(GBitmap *bitmap, GRect bounds) {
+  bitmap->bounds = bounds;
+}
+
+GColor *gbitmap_get_palette(const GBitmap *bitmap) { return bitmap->palette; }
+
+void gbitmap_set_palette(GBitmap *bitmap, GColor *palette,
+                         bool free_on_destroy) {
+  if (bitmap->is_palette_owned && bitmap->palette != palette) {
+    free(bitmap->palette);
+  }
+  bitmap->palette = palette;
+  bitmap->is_palette_owned = free_on_destroy;
+}
+
+static GColor bitmap_pixel(const GBitmap *bmp, int x, int y) {
+  const uint8_t *row = bmp->addr + (y * bmp->row_size_bytes);
+  switch (bmp->format) {
+  case GBitmapFormat1Bit:
+    return (row[x >> 3] >> (x & 7)) & 1 ? GColorWhite : GColorBlack;
+  case GBitmapFormat1BitPalette:
+    return bmp->palette[(row[x >> 3] >> (7 - (x & 7))) & 1];
+  case GBitmapFormat2BitPalette:
+    return bmp->palette[(row[x >> 2] >> (6 - (2 * (x & 3)))) & 3];
+  case GBitmapFormat4BitPalette:
+    return bmp->palette[(row[x >> 1] >> (4 - (4 * (x & 1)))) & 15];
+  default:
+    return (GColor){.argb = row[x]};
+  }
+}
+
+// Graphics
+
+struct GContext {
+  GBitmap *framebuffer;
+  GPoint offset; // Where the layer being drawn puts its (0, 0)
+  GRect clip;    // In screen coordinates
+  GColor stroke_color;
+  GColor fill_color;
+  GCompOp compositing_mode;
+};
+
+static GContext context;
+
+#ifndef PBL_COLOR
+// The black and white screens take anything brighter than mid grey as white
+static bool is_white(GColor color) {
+  return color.r + color.g + color.b > 4;
+}
+#endif
+
+static void blend_pixel(int x, int y, GColor color) {
+  GBitmap *fb = context.framebuffer;
+  if (color.a == 0) {
+    return;
+  }
+  uint8_t *row = fb->addr + (y * fb->row_size_bytes);
+#ifdef PBL_COLOR
+  if (color.a < 3) {
+    const GColor under = {.argb = row[x]};
+    color.r = ((color.r * color.a) + (under.r * (3 - color.a))) / 3;
+    color.g = ((color.g * color.a) + (under.g * (3 - color.a))) / 3;
+    color.b = ((color.b * color.a) + (under.b * (3 - color.a))) / 3;
+    color.a = 3;
+  }
+  row[x] = color.argb;
+#else
+  if (is_white(color)) {
+    row[x >> 3] |= 1 << (x & 7);
+  } else {
+    row[x >> 3] &= ~(1 << (x & 7));
+  }
+#endif
+}
+
+static void composite_pixel(int x, int y, GColor color, GCompOp op) {
+  switch (op) {
+  case GCompOpAssign:
+    color.a = 3;
+    break;
+  case GCompOpAssignInverted:
+    color.argb = ~color.argb;
+    color.a = 3;
+    break;
+  case GCompOpOr:
+    if (color.a == 0 || !gcolor_equal(color, GColorWhite)) {
+      return;
+    }
+    break;
+  case GCompOpAnd:
+    if (color.a == 0 || !gcolor_equal(color, GColorBlack)) {
+      return;
+    }
+    break;
+  case GCompOpClear:
+    if (color.a == 0 || !gcolor_equal(color, GColorWhite)) {
+      return;
+    }
+    color = GColorBlack;
+    break;
+  case GCompOpSet:
+    break;
+  }
+  blend_pixel(x, y, color);
+}
+
+static GRect to_screen(GRect rect) {
+  rect.origin.x += context.offset.x;
+  rect.origin.y += context.offset.y;
+  return rect;
+}
+
+// The SWEEP_MODE harness's (harness.c), when it's linked in. The watch clips
+// a draw that reaches past the framebuffer without a word; the sweep wants
+// to hear about every one
+void harness_flag_draw(const char *what, int x, int y) __attribute__((weak));
+
+static void check_on_screen(const char *what, GRect screen) {
+  if (harness_flag_draw &&
+      (screen.origin.x < 0 || screen.origin.y < 0 ||
+       screen.origin.x + screen.size.w > PBL_DISPLAY_WIDTH ||
+       screen.origin.y + screen.size.h > PBL_DISPLAY_HEIGHT)) {
+    harness_flag_draw(what, screen.origin.x, screen.origin.y);
+  }
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color) {
+  ctx->stroke_color = color;
+}
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color) {
+  ctx->fill_color = color;
+}
+
+void graphics_context_set_compositing_mode(GContext *ctx, GCompOp mode) {
+  ctx->compositing_mode = mode;
+}
+
+void graphics_draw_pixel(GContext *ctx, GPoint point) {
+  const int x = point.x + ctx->offset.x;
+  const int y = point.y + ctx->offset.y;
+  check_on_screen("pixel past the screen", GRect(x, y, 1, 1));
+  const GRect clip = ctx->clip;
+  if (x >= clip.origin.x && x < clip.origin.x + clip.size.w &&
+      y >= clip.origin.y && y < clip.origin.y + clip.size.h) {
+    blend_pixel(x, y, ctx->stroke_color);
+  }
+}
+
+void graphics_draw_line(GContext *ctx, GPoint p0, GPoint p1) {
+  int x = p0.x;
+  int y = p0.y;
+  const int dx = abs(p1.x - p0.x);
+  const int dy = -abs(p1.y - p0.y);
+  const int step_x = p0.x < p1.x ? 1 : -1;
+  const int step_y = p0.y < p1.y ? 1 : -1;
+  int error = dx + dy;
+  for (;;) {
+    graphics_draw_pixel(ctx, GPoint(x, y));
+    if (x == p1.x && y == p1.y) {
+      return;
+    }
+    if (2 * error >= dy) {
+      error += dy;
+      x += step_x;
+    }
+    if (2 * error <= dx) {
+      error += dx;
+      y += step_y;
+    }
+  }
+}
+
+// Whether (x, y) in rect falls outside one of its masked rounded corners
+static bool is_outside_corner(GRect rect, int x, int y, int radius,
+                              GCornerMask corner_mask) {
+  const int left = x - rect.origin.x;
+  const int right = rect.origin.x + rect.size.w - 1 - x;
+  const int top = y - rect.origin.y;
+  const int bottom = rect.origin.y + rect.size.h - 1 - y;
+  const int across = left < radius ? left : right < radius ? right : -1;
+  const int down = top < radius ? top : bottom < radius ? bottom : -1;
+  if (across < 0 || down < 0) {
+    return false;
+  }
+  const GCornerMask corner =
+      top < radius ? (left < radius ? GCornerTopLeft : GCornerTopRight)
+                   : (left < radius ? GCornerBottomLeft : GCornerBottomRight);
+  if (!(corner_mask & corner)) {
+    return false;
+  }
+  // Distance of the pixel's centre from the corner circle's, doubled
+  const int cx = (2 * (radius - across)) - 1;
+  const int cy = (2 * (radius - down)) - 1;
+  return (cx * cx) + (cy * cy) > 4 * radius * radius;
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius,
+                        GCornerMask corner_mask) {
+  const GRect screen = to_screen(rect);
+  check_on_screen("fill past the screen", screen);
+  const GRect area = rect_intersect(screen, ctx->clip);
+  for (int y = area.origin.y; y < area.origin.y + area.size.h; y++) {
+    for (int x = area.origin.x; x < area.origin.x + area.size.w; x++) {
+      if (!is_outside_corner(screen, x, y, corner_radius, corner_mask)) {
+        blend_pixel(x, y, ctx->fill_color);
+      }
+    }
+  }
+}
+
+// Bitmaps smaller than the rect tile it, as on the watch
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap,
+                                  GRect rect) {
+  if (!bitmap) {
+    return;
+  }
+  const GRect screen = to_screen(rect);
+  check_on_screen("bitmap past the screen", screen);
+  const GRect area = rect_intersect(screen, ctx->clip);
+  const GRect src = bitmap->bounds;
+  for (int y = area.origin.y; y < area.origin.y + area.size.h; y++) {
+    const int src_y = src.origin.y + ((y - screen.origin.y) % src.size.h);
+    for (int x = area.origin.x; x < area.origin.x + area.size.w; x++) {
+      const int src_x = src.origin.x + ((x - screen.origin.x) % src.size.w);
+      composite_pixel(x, y, bitmap_pixel(bitmap, src_x, src_y),
+                      ctx->compositing_mode);
+    }
+  }
+}
+
+GBitmap *graphics_capture_frame_buffer(GContext *ctx) {
+  return ctx->framebuffer;
+}
+
+bool graphics_release_frame_buffer(GContext *ctx, GBitmap *buffer) {
+  return buffer == ctx->framebuffer;
+}
+
+GBitmap *host_framebuffer(void) { return context.framebuffer; }
+
+// Screenshots: 8-bit RGB PNGs whose image data is stored, one deflate block
+// per line, rather than compressed, so the host needs no zlib.
+// tools/screenshots.py recompresses the ones it keeps
+
+typedef struct PngWriter {
+  FILE *file;
+  uint32_t crc;
+  uint32_t adler_a;
+  uint32_t adler_b;
+} PngWriter;
+
+static uint32_t png_crc_table[256];
+
+static void png_write(PngWriter *png, const uint8_t *data, size_t size) {
+  if (!png_crc_table[1]) {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      png_crc_table[n] = c;
+    }
+  }
+  for (size_t i = 0; i < size; i++) {
+    png->crc = png_crc_table[(png->crc ^ data[i]) & 0xFF] ^ (png->crc >> 8);
+  }
+  fwrite(data, 1, size, png->file);
+}
+
+// Image bytes, which the zlib stream's checksum covers too
+static void png_write_image(PngWriter *png, const uint8_t *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    png->adler_a = (png->adler_a + data[i]) % 65521;
+    png->adler_b = (png->adler_b + png->adler_a) % 65521;
+  }
+  png_write(png, data, size);
+}
+
+static void png_write_u32(PngWriter *png, uint32_t value) {
+  const uint8_t bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+  png_write(png, bytes, sizeof(bytes));
+}
+
+// The length isn't covered by the CRC; the type is
+static void png_begin_chunk(PngWriter *png, const char *type,
+                            uint32_t length) {
+  png_write_u32(png, length);
+  png->crc = 0xFFFFFFFF;
+  png_write(png, (const uint8_t *)type, 4);
+}
+
+static void png_end_chunk(PngWriter *png) {
+  png_write_u32(png, png->crc ^ 0xFFFFFFFF);
+}
+
+static void screen_rgb(int x, int y, uint8_t *rgb) {
+  const GBitmap *fb = context.framebuffer;
+  const uint8_t *row = fb->addr + (y * fb->row_size_bytes);
+#ifdef PBL_COLOR
+  const GColor color = {.argb = row[x]};
+  rgb[0] = color.r * 85;
+  rgb[1] = color.g * 85;
+  rgb[2] = color.b * 85;
+#else
+  const uint8_t level = (row[x >> 3] >> (x & 7)) & 1 ? 0xFF : 0x00;
+  rgb[0] = rgb[1] = rgb[2] = level;
+#endif
+}
+
+bool host_write_png(const char *path) {
+  PngWriter png = {.file = fopen(path, "wb"), .adler_a = 1};
+  if (!png.file) {
+    return false;
+  }
+  static const uint8_t SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+                                       '\n'};
+  fwrite(SIGNATURE, 1, sizeof(SIGNATURE), png.file);
+
+  png_begin_chunk(&png, "IHDR", 13);
+  png_write_u32(&png, PBL_DISPLAY_WIDTH);
+  png_write_u32(&png, PBL_DISPLAY_HEIGHT);
+  // 8 bits per channel, RGB, deflate, no filter method, not interlaced
+  const uint8_t layout[5] = {8, 2, 0, 0, 0};
+  png_write(&png, layout, sizeof(layout));
+  png_end_chunk(&png);
+
+  // Each line is filter type 0, then its pixels
+  uint8_t line[1 + (PBL_DISPLAY_WIDTH * 3)] = {0};
+  const uint32_t block_bytes = 5 + sizeof(line);
+  png_begin_chunk(&png, "IDAT", 2 + (PBL_DISPLAY_HEIGHT * block_bytes) + 4);
+  const uint8_t zlib_header[2] = {0x78, 0x01};
+  png_write(&png, zlib_header, sizeof(zlib_header));
+  for (int y = 0; y < PBL_DISPLAY_HEIGHT; y++) {
+    const uint16_t length = sizeof(line);
+    const uint8_t block_header[5] = {y == PBL_DISPLAY_HEIGHT - 1,
+                                     length & 0xFF, length >> 8,
+                                     ~length & 0xFF, (~length >> 8) & 0xFF};
+    png_write(&png, block_header, sizeof(block_header));
+    for (int x = 0; x < PBL_DISPLAY_WIDTH; x++) {
+      screen_rgb(x, y, &line[1 + (x * 3)]);
+    }
+    png_write_image(&png, line, sizeof(line));
+  }
+  png_write_u32(&png, (png.adler_b << 16) | png.adler_a);
+  png_end_chunk(&png);
+
+  png_begin_chunk(&png, "IEND", 0);
+  png_end_chunk(&png);
+  return fclose(png.file) == 0;
+}
+
+// Layers and windows
+
+struct Layer {
+  GRect frame;
+  GRect bounds;
+  LayerUpdateProc update_proc;
+  Layer *parent;
+  Layer *first_child;
+  Layer *next_sibling;
+  bool is_hidden;
+  void *data;
+};
+
+struct Window {
+  Layer *root_layer;
+  GColor background_color;
+  WindowHandlers handlers;
+};
+
+static Window *top_window;
+static bool is_render_pending;
+
+Layer *layer_create_with_data(GRect frame, size_t data_size) {
+  Layer *layer = calloc(1, sizeof(Layer) + data_size);
+  if (!layer) {
+    return NULL;
+  }
+  layer->frame = frame;
+  layer->bounds = (GRect){.size = frame.size};
+  layer->data = data_size > 0 ? layer + 1 : NULL;
+  return layer;
+}
+
+Layer *layer_create(GRect frame) { return layer_create_with_data(frame, 0); }
+
+void layer_destroy(Layer *layer) {
+  if (!layer) {
+    return;
+  }
+  layer_remove_from_parent(layer);
+  layer_remove_child_layers(layer);
+  free(layer);
+}
+
+void *layer_get_data(const Layer *layer) { return layer->data; }
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc) {
+  layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer) { is_render_pending = true; }
+
+GRect layer_get_frame(const Layer *layer) { return layer->frame; }
+
+// Bounds that matched the old frame follow it, as in the SDK
+void layer_set_frame(Layer *layer, GRect frame) {
+  if (layer->bounds.origin.x == 0 && layer->bounds.origin.y == 0 &&
+      layer->bounds.size.w == layer->frame.size.w &&
+      layer->bounds.size.h == layer->frame.size.h) {
+    layer->bounds.size = frame.size;
+  }
+  layer->frame = frame;
+  layer_mark_dirty(layer);
+}
+
+GRect layer_get_bounds(const Layer *layer) { return layer->bounds; }
+
+void layer_set_bounds(Layer *layer, GRect bounds) {
+  layer->bounds = bounds;
+  layer_mark_dirty(layer);
+}
+
+// Nothing obstructs the host's screen unless a test says so; see
+// host_set_unobstructed_height()
+static int unobstructed_height = PBL_DISPLAY_HEIGHT;
+
+GRect layer_get_unobstructed_bounds(const Layer *layer) {
+  GRect bounds = layer->bounds;
+  if (bounds.size.h > unobstructed_height) {
+    bounds.size.h = unobstructed_height;
+  }
+  return bounds;
+}
+
+void layer_add_child(Layer *parent, Layer *child) {
+  layer_remove_from_parent(child);
+  Layer **slot = &parent->first_child;
+  while (*slot) {
+    slot = &(*slot)->next_sibling;
+  }
+  *slot = child;
+  child->parent = parent;
+  layer_mark_dirty(parent);
+}
+
+void layer_remove_from_parent(Layer *child) {
+  if (!child->parent) {
+    return;
+  }
+  Layer **slot = &child->parent->first_child;
+  while (*slot != child) {
+    slot = &(*slot)->next_sibling;
+  }
+  *slot = child->next_sibling;
+  child->parent = NULL;
+  child->next_sibling = NULL;
+  layer_mark_dirty(child);
+}
+
+void layer_remove_child_layers(Layer *parent) {
+  while (parent->first_child) {
+    layer_remove_from_parent(parent->first_child);
+  }
+}
+
+void layer_set_hidden(Layer *layer, bool hidden) {
+  if (layer->is_hidden != hidden) {
+    layer->is_hidden = hidden;
+    layer_mark_dirty(layer);
+  }
+}
+
+Window *window_create(void) {
+  Window *window = calloc(1, sizeof(Window));
+  if (!window) {
+    return NULL;
+  }
+  window->root_layer =
+      layer_create(GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT));
+  window->background_color = GColorWhite;
+  return window;
+}
+
+void window_destroy(Window *window) {
+  if (!window) {
+    return;
+  }
+  if (top_window == window) {
+    top_window = NULL;
+  }
+  layer_destroy(window->root_layer);
+  free(window);
+}
+
+Layer *window_get_root_layer(const Window *window) {
+  return window->root_layer;
+}
+
+void window_set_background_color(Window *window, GColor background_color) {
+  window->background_color = background_color;
+  layer_mark_dirty(window->root_layer);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers) {
+  window->handlers = handlers;
+}
+
+void window_stack_push(Window *window, bool animated) {
+  top_window = window;
+  if (window->handlers.load) {
+    window->handlers.load(window);
+  }
+  if (window->handlers.appear) {
+    window->handlers.appear(window);
+  }
+  layer_mark_dirty(window->root_layer);
+}
+
+static void render_layer(Layer *layer, GPoint parent_origin,
+                         GRect parent_clip) {
+  if (layer->is_hidden) {
+    return;
+  }
+  const GRect frame =
+      GRect(parent_origin.x + layer->frame.origin.x,
+            parent_origin.y + layer->frame.origin.y, layer->frame.size.w,
+            layer->frame.size.h);
+  const GRect clip = rect_intersect(frame, parent_clip);
+  const GPoint origin = GPoint(frame.origin.x + layer->bounds.origin.x,
+                               frame.origin.y + layer->bounds.origin.y);
+  if (layer->update_proc) {
+    // Each layer starts from the default drawing state
+    context.offset = origin;
+    context.clip = clip;
+    context.stroke_color = GColorBlack;
+    context.fill_color = GColorBlack;
+    context.compositing_mode = GCompOpAssign;
+    layer->update_proc(layer, &context);
+  }
+  for (Layer *child = layer->first_child; child; child = child->next_sibling) {
+    render_layer(child, origin, clip);
+  }
+}
+
+static void render(void) {
+  is_render_pending = false;
+  if (!top_window) {
+    return;
+  }
+  const GRect screen = GRect(0, 0, PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT);
+  context.offset = GPointZero;
+  context.clip = screen;
+  if (!gcolor_equal(top_window->background_color, GColorClear)) {
+    context.fill_color = top_window->background_color;
+    graphics_fill_rect(&context, screen, 0, GCornerNone);
+  }
+  render_layer(top_window->root_layer, GPointZero, screen);
+}
+
+// Clock
+
+time_t __wrap_time(time_t *out) {
+  const time_t now = (time_t)(clock_ms / 1000);
+  if (out) {
+    *out = now;
+  }
+  return now;
+}
+
+uint16_t time_ms(time_t *t_utc, uint16_t *out_ms) {
+  const uint16_t ms = (uint16_t)(clock_ms % 1000);
+  if (t_utc) {
+    *t_utc = (time_t)(clock_ms / 1000);
+  }
+  if (out_ms) {
+    *out_ms = ms;
+  }
+  return ms;
+}
+
+bool clock_is_24h_style(void) { return false; }
+
+// Timers, kept in the order they fall due. Handles are ids, so a handle to a
+// timer that has already fired is harmless, as on the watch
+
+typedef struct HostTimer {
+  uintptr_t id;
+  int64_t due_ms;
+  AppTimerCallback callback;
+  void *data;
+  struct HostTimer *next;
+} HostTimer;
+
+static HostTimer *timers;
+static uintptr_t next_timer_id = 1;
+
+static void insert_timer(HostTimer *timer) {
+  HostTimer **slot = &timers;
+  while (*slot && (*slot)->due_ms <= timer->due_ms) {
+    slot = &(*slot)->next;
+  }
+  timer->next = *slot;
+  *slot = timer;
+}
+
+static HostTimer *unlink_timer(AppTimer *handle) {
+  for (HostTimer **slot = &timers; *slot; slot = &(*slot)->next) {
+    if ((*slot)->id == (uintptr_t)handle) {
+      HostTimer *timer = *slot;
+      *slot = timer->next;
+      return timer;
+    }
+  }
+  return NULL;
+}
+
+AppTimer *app_timer_register(uint32_t timeout_ms, AppTimerCallback callback,
+                             void *callback_data) {
+  HostTimer *timer = malloc(sizeof(HostTimer));
+  if (!timer) {
+    return NULL;
+  }
+  *timer = (HostTimer){.id = next_timer_id++,
+                       .due_ms = clock_ms + timeout_ms,
+                       .callback = callback,
+                       .data = callback_data};
+  insert_timer(timer);
+  return (AppTimer *)timer->id;
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms) {
+  HostTimer *timer = unlink_timer(timer_handle);
+  if (!timer) {
+    return false;
+  }
+  timer->due_ms = clock_ms + new_timeout_ms;
+  insert_timer(timer);
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle) {
+  free(unlink_timer(timer_handle));
+}
+
+// Tick service
+
+static TickHandler tick_handler;
+static TimeUnits tick_units;
+static int64_t next_tick_s;
+
+static int tick_step_s(void) {
+  if (tick_units & SECOND_UNIT) {
+    return 1;
+  }
+  if (tick_units & MINUTE_UNIT) {
+    return 60;
+  }
+  return tick_units & HOUR_UNIT ? 3600 : 86400;
+}
+
+static void schedule_tick(void) {
+  const int64_t step = tick_step_s();
+  next_tick_s = ((clock_ms / 1000 / step) + 1) * step;
+}
+
+void tick_timer_service_subscribe(TimeUnits units, TickHandler handler) {
+  tick_units = units;
+  tick_handler = handler;
+  schedule_tick();
+}
+
+void tick_timer_service_unsubscribe(void) { tick_handler = NULL; }
+
+static void fire_tick(void) {
+  const time_t now = (time_t)next_tick_s;
+  struct tm *tick_time = localtime(&now);
+  TimeUnits changed = SECOND_UNIT;
+  if (tick_time->tm_sec == 0) {
+    changed |= MINUTE_UNIT;
+    if (tick_time->tm_min == 0) {
+      changed |= HOUR_UNIT;
+      if (tick_time->tm_hour == 0) {
+        changed |= DAY_UNIT;
+        if (tick_time->tm_mday == 1) {
+          changed |= MONTH_UNIT;
+          if (tick_time->tm_mon == 0) {
+            changed |= YEAR_UNIT;
+          }
+        }
+      }
+    }
+  }
+  schedule_tick();
+  if (changed & tick_units) {
+    tick_handler(tick_time, changed);
+  }
+}
+
+// Animations, stepped every HOST_ANIMATION_FRAME_MS and freed once they stop
+
+struct Animation {
+  uint32_t duration_ms;
+  AnimationCurve curve;
+  const AnimationImplementation *implementation;
+  AnimationHandlers handlers;
+  void *context;
+  bool is_scheduled;
+  int64_t start_ms;
+  int64_t next_frame_ms;
+  Animation *next;
+};
+
+static Animation *animations;
+
+static bool is_live(Animation *animation) {
+  for (Animation *a = animations; a; a = a->next) {
+    if (a == animation) {
+      return true;
+    }
+  }
+  return false;
+}
+
+Animation *animation_create(void) {
+  Animation *animation = calloc(1, sizeof(Animation));
+  if (!animation) {
+    return NULL;
+  }
+  animation->duration_ms = 250;
+  animation->curve = AnimationCurveEaseInOut;
+  animation->next = animations;
+  animations = animation;
+  return animation;
+}
+
+bool animation_destroy(Animation *animation) {
+  for (Animation **slot = &animations; *slot; slot = &(*slot)->next) {
+    if (*slot == animation) {
+      *slot = animation->next;
+      free(animation);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool animation_set_duration(Animation *animation, uint32_t duration_ms) {
+  if (!is_live(animation)) {
+    return false;
+  }
+  animation->duration_ms = duration_ms;
+  return true;
+}
+
+bool animation_set_curve(Animation *animation, AnimationCurve curve) {
+  if (!is_live(animation)) {
+    return false;
+  }
+  animation->curve = curve;
+  return true;
+}
+
+bool animation_set_implementation(
+    Animation *animation, const AnimationImplementation *implementation) {
+  if (!is_live(animation)) {
+    return false;
+  }
+  animation->implementation = implementation;
+  return true;
+}
+
+bool animation_set_handlers(Animation *animation, AnimationHandlers callbacks,
+                            void *context) {
+  if (!is_live(animation)) {
+    return false;
+  }
+  animation->handlers = callbacks;
+  animation->context = context;
+  return true;
+}
+
+void *animation_get_context(Animation *animation) {
+  return is_live(animation) ? animation->context : NULL;
+}
+
+bool animation_is_scheduled(Animation *animation) {
+  return is_live(animation) && animation->is_scheduled;
+}
+
+bool animation_schedule(Animation *animation) {
+  if (!is_live(animation) || animation->is_scheduled) {
+    return false;
+  }
+  animation->is_scheduled = true;
+  animation->start_ms = clock_ms;
+  animation->next_frame_ms = clock_ms + HOST_ANIMATION_FRAME_MS;
+  if (animation->handlers.started) {
+    animation->handlers.started(animation, animation->context);
+  }
+  if (animation->implementation && animation->implementation->setup) {
+    animation->implementation->setup(animation);
+  }
+  return true;
+}
+
+static void stop_animation(Animation *animation, bool finished) {
+  animation->is_scheduled = false;
+  if (animation->handlers.stopped) {
+    animation->handlers.stopped(animation, finished, animation->context);
+  }
+  if (animation->implementation && animation->implementation->teardown) {
+    animation->implementation->teardown(animation);
+  }
+  animation_destroy(animation);
+}
+
+bool animation_unschedule(Animation *animation) {
+  if (!animation_is_scheduled(animation)) {
+    return false;
+  }
+  stop_animation(animation, false);
+  return true;
+}
+
+static AnimationProgress curve_progress(AnimationCurve curve, uint32_t t) {
+  const uint64_t max = ANIMATION_NORMALIZED_MAX;
+  switch (curve) {
+  case AnimationCurveEaseIn:
+    return (AnimationProgress)((uint64_t)t * t / max);
+  case AnimationCurveEaseOut:
+    return (AnimationProgress)(max - ((max - t) * (max - t) / max));
+  case AnimationCurveEaseInOut:
+    return t < max / 2
+               ? (AnimationProgress)(2 * (uint64_t)t * t / max)
+               : (AnimationProgress)(max - (2 * (max - t) * (max - t) / max));
+  default:
+    return t;
+  }
+}
+
+static void step_animation(Animation *animation) {
+  const int64_t elapsed = clock_ms - animation->start_ms;
+  const bool is_done = elapsed >= animation->duration_ms;
+  const uint32_t t =
+      is_done ? ANIMATION_NORMALIZED_MAX
+              : (uint32_t)(elapsed * ANIMATION_NORMALIZED_MAX /
+                           animation->duration_ms);
+  animation->next_frame_ms = clock_ms + HOST_ANIMATION_FRAME_MS;
+  if (animation->implementation && animation->implementation->update) {
+    animation->implementation->update(animation,
+                                      curve_progress(animation->curve, t));
+  }
+  if (is_done && animation_is_scheduled(animation)) {
+    stop_animation(animation, true);
+  }
+}
+
+static Animation *next_animation_frame(void) {
+  Animation *next = NULL;
+  for (Animation *a = animations; a; a = a->next) {
+    if (a->is_scheduled && (!next || a->next_frame_ms < next->next_frame_ms)) {
+      next = a;
+    }
+  }
+  return next;
+}
+
+void host_render(void) {
+  if (is_render_pending) {
+    render();
+  }
+}
+
+static UnobstructedAreaHandlers unobstructed_handlers;
+static void *unobstructed_context;
+
+void unobstructed_area_service_subscribe(UnobstructedAreaHandlers handlers,
+                                         void *context) {
+  unobstructed_handlers = handlers;
+  unobstructed_context = context;
+}
+
+void unobstructed_area_service_unsubscribe(void) {
+  unobstructed_handlers = (UnobstructedAreaHandlers){0};
+}
+
+void host_set_unobstructed_height(int height) { unobstructed_height = height; }
+
+// One pixel per frame, as a slow Quick View would
+void host_animate_unobstructed_height(int height) {
+  const UnobstructedAreaHandlers handlers = unobstructed_handlers;
+  const int from = unobstructed_height;
+  if (handlers.will_change) {
+    handlers.will_change(GRect(0, 0, PBL_DISPLAY_WIDTH, height),
+                         unobstructed_context);
+  }
+  const int step = height < from ? -1 : 1;
+  while (unobstructed_height != height) {
+    unobstructed_height += step;
+    if (handlers.change) {
+      handlers.change((AnimationProgress)((int64_t)ANIMATION_NORMALIZED_MAX *
+                                          (unobstructed_height - from) /
+                                          (height - from)),
+                      unobstructed_context);
+    }
+    host_render();
+  }
+  if (handlers.did_change) {
+    handlers.did_change(unobstructed_context);
+  }
+  host_render();
+}
+
+// Other services: a watch at 80% on the wrist, connected, that never taps
+
+static BatteryStateHandler battery_handler;
+static BluetoothConnectionHandler connection_handler;
+static bool is_connected = true;
+
+void battery_state_service_subscribe(BatteryStateHandler handler) {
+  battery_handler = handler;
+}
+
+void battery_state_service_unsubscribe(void) { battery_handler = NULL; }
+
+BatteryChargeState battery_state_service_peek(void) {
+  return (BatteryChargeState){.charge_percent = 80};
+}
+
+void bluetooth_connection_service_subscribe(
+    BluetoothConnectionHandler handler) {
+  connection_handler = handler;
+}
+
+void bluetooth_connection_service_unsubscribe(void) {
+  connection_handler = NULL;
+}
+
+bool bluetooth_connection_service_peek(void) { return is_connected; }
+
+void host_set_connected(bool connected) {
+  is_connected = connected;
+  if (connection_handler) {
+    connection_handler(connected);
+  }
+}
+
+void accel_tap_service_subscribe(AccelTapHandler handler) {}
+
+void accel_tap_service_unsubscribe(void) {}
+
+bool health_service_events_subscribe(HealthEventHandler handler,
+                                     void *context) {
+  return true;
+}
+
+bool health_service_events_unsubscribe(void) { return true; }
+
+HealthActivityMask health_service_peek_current_activities(void) {
+  return HealthActivityNone;
+}
+
+void vibes_short_pulse(void) {}
+
+void vibes_long_pulse(void) {}
+
+void vibes_double_pulse(void) {}
+
+// Storage, optionally kept in the file HOST_PERSIST_FILE names between runs
+
+typedef struct HostPersistEntry {
+  uint32_t key;
+  uint16_t size;
+  uint8_t data[PERSIST_DATA_MAX_LENGTH];
+} HostPersistEntry;
+
+static HostPersistEntry persist_entries[HOST_PERSIST_MAX_KEYS];
+static int persist_count;
+
+static HostPersistEntry *persist_find(uint32_t key) {
+  for (int i = 0; i < persist_count; i++) {
+    if (persist_entries[i].key == key) {
+      return &persist_entries[i];
+    }
+  }
+  return NULL;
+}
+
+static void persist_save(void) {
+  const char *path = getenv("HOST_PERSIST_FILE");
+  FILE *f = path ? fopen(path, "wb") : NULL;
+  if (!f) {
+    return;
+  }
+  fwrite(persist_entries, sizeof(HostPersistEntry), persist_count, f);
+  fclose(f);
+}
+
+static void persist_load(void) {
+  const char *path = getenv("HOST_PERSIST_FILE");
+  FILE *f = path ? fopen(path, "rb") : NULL;
+  if (!f) {
+    return;
+  }
+  persist_count = (int)fread(persist_entries, sizeof(HostPersistEntry),
+                             HOST_PERSIST_MAX_KEYS, f);
+  fclose(f);
+}
+
+bool persist_exists(const uint32_t key) { return persist_find(key) != NULL; }
+
+int persist_get_size(const uint32_t key) {
+  const HostPersistEntry *entry = persist_find(key);
+  return entry ? entry->size : E_DOES_NOT_EXIST;
+}
+
+int persist_read_data(const uint32_t key, void *buffer,
+                      const size_t buffer_size) {
+  const HostPersistEntry *entry = persist_find(key);
+  if (!entry) {
+    return E_DOES_NOT_EXIST;
+  }
+  const int size = entry->size < buffer_size ? entry->size : (int)buffer_size;
+  memcpy(buffer, entry->data, size);
+  return size;
+}
+
+int persist_write_data(const uint32_t key, const void *data,
+                       const size_t size) {
+  HostPersistEntry *entry = persist_find(key);
+  if (!entry) {
+    if (persist_count == HOST_PERSIST_MAX_KEYS) {
+      return E_OUT_OF_STORAGE;
+    }
+    entry = &persist_entries[persist_count++];
+    entry->key = key;
+  }
+  entry->size =
+      size < PERSIST_DATA_MAX_LENGTH ? size : PERSIST_DATA_MAX_LENGTH;
+  memcpy(entry->data, data, entry->size);
+  persist_save();
+  return entry->size;
+}
+
+status_t persist_delete(const uint32_t key) {
+  HostPersistEntry *entry = persist_find(key);
+  if (!entry) {
+    return E_DOES_NOT_EXIST;
+  }
+  *entry = persist_entries[--persist_count];
+  persist_save();
+  return S_SUCCESS;
+}
+
+void host_persist_clear(void) {
+  persist_count = 0;
+  persist_save();
+}
+
+// The app's heap is the platform's app memory (HOST_HEAP_BYTES, from the
+// Makefile); malloc() doesn't hold the app to it
+size_t heap_bytes_used(void) { return mallinfo2().uordblks; }
+
+size_t heap_bytes_free(void) {
+  const size_t used = heap_bytes_used();
+  return used < HOST_HEAP_BYTES ? HOST_HEAP_BYTES - used : 0;
+}
+
+// Dictionaries, in the SDK's wire format
+
+uint32_t dict_calc_buffer_size(const uint8_t tuple_count, ...) {
+  uint32_t size = sizeof(Dictionary);
+  va_list sizes;
+  va_start(sizes, tuple_count);
+  for (int i = 0; i < tuple_count; i++) {
+    size += sizeof(Tuple) + va_arg(sizes, size_t);
+  }
+  va_end(sizes);
+  return size;
+}
+
+DictionaryResult dict_write_begin(DictionaryIterator *iter, uint8_t *buffer,
+                                  const uint16_t size) {
+  if (!iter || !buffer) {
+    return DICT_INVALID_ARGS;
+  }
+  if (size < sizeof(Dictionary)) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  iter->dictionary = (Dictionary *)buffer;
+  iter->dictionary->count = 0;
+  iter->cursor = iter->dictionary->head;
+  iter->end = buffer + size;
+  return DICT_OK;
+}
+
+static DictionaryResult write_tuple(DictionaryIterator *iter,
+                                    const uint32_t key, TupleType type,
+                                    const void *data, const uint16_t size) {
+  uint8_t *cursor = (uint8_t *)iter->cursor;
+  if (cursor + sizeof(Tuple) + size > (const uint8_t *)iter->end) {
+    return DICT_NOT_ENOUGH_STORAGE;
+  }
+  iter->cursor->key = key;
+  iter->cursor->type = type;
+  iter->cursor->length = size;
+  memcpy(cursor + sizeof(Tuple), data, size);
+  iter->cursor = (Tuple *)(cursor + sizeof(Tuple) + size);
+  iter->dictionary->count++;
+  return DICT_OK;
+}
+
+DictionaryResult dict_write_data(DictionaryIterator *iter, const uint32_t key,
+                                 const uint8_t *data, const uint16_t size) {
+  return write_tuple(iter, key, TUPLE_BYTE_ARRAY, data, size);
+}
+
+DictionaryResult dict_write_int32(DictionaryIterator *iter, const uint32_t key,
+                                  const int32_t value) {
+  return write_tuple(iter, key, TUPLE_INT, &value, sizeof(value));
+}
+
+DictionaryResult dict_write_uint32(DictionaryIterator *iter,
+                                   const uint32_t key, const uint32_t value) {
+  return write_tuple(iter, key, TUPLE_UINT, &value, sizeof(value));
+}
+
+uint32_t dict_write_end(DictionaryIterator *iter) {
+  const uint32_t size =
+      (uint32_t)((uint8_t *)iter->cursor - (uint8_t *)iter->dictionary);
+  iter->end = iter->cursor;
+  iter->cursor = iter->dictionary->head;
+  return size;
+}
+
+Tuple *dict_read_begin_from_buffer(DictionaryIterator *iter,
+                                   const uint8_t *buffer, const uint16_t size) {
+  iter->dictionary = (Dictionary *)buffer;
+  iter->end = buffer + size;
+  iter->cursor = iter->dictionary->head;
+  return iter->dictionary->count > 0 ? iter->cursor : NULL;
+}
+
+Tuple *dict_find(const DictionaryIterator *iter, const uint32_t key) {
+  uint8_t *cursor = (uint8_t *)iter->dictionary->head;
+  for (int i = 0; i < iter->dictionary->count; i++) {
+    Tuple *tuple = (Tuple *)cursor;
+    if (tuple->key == key) {
+      return tuple;
+    }
+    cursor += sizeof(Tuple) + tuple->length;
+  }
+  return NULL;
+}
+
+// AppMessage: sends land in a buffer tests can read back
+
+static AppMessageInboxReceived inbox_received;
+static AppMessageOutboxSent outbox_sent;
+static AppMessageOutboxFailed outbox_failed;
+static uint8_t *outbox_buffer;
+static uint32_t outbox_size;
+static DictionaryIterator outbox_iter;
+static uint8_t *last_sent;
+static uint16_t last_sent_size;
+static int sent_count;
+
+void app_message_register_inbox_received(
+    AppMessageInboxReceived received_callback) {
+  inbox_received = received_callback;
+}
+
+void app_message_register_inbox_dropped(
+    AppMessageInboxDropped dropped_callback) {}
+
+void app_message_register_outbox_sent(AppMessageOutboxSent sent_callback) {
+  outbox_sent = sent_callback;
+}
+
+void app_message_register_outbox_failed(
+    AppMessageOutboxFailed failed_callback) {
+  outbox_failed = failed_callback;
+}
+
+AppMessageResult app_message_open(const uint32_t size_inbound,
+                                  const uint32_t size_outbound) {
+  free(outbox_buffer);
+  free(last_sent);
+  outbox_buffer = malloc(size_outbound);
+  last_sent = malloc(size_outbound);
+  outbox_size = size_outbound;
+  return outbox_buffer && last_sent ? APP_MSG_OK : APP_MSG_OUT_OF_MEMORY;
+}
+
+AppMessageResult app_message_outbox_begin(DictionaryIterator **iterator) {
+  if (!outbox_buffer) {
+    return APP_MSG_INVALID_ARGS;
+  }
+  dict_write_begin(&outbox_iter, outbox_buffer, outbox_size);
+  *iterator = &outbox_iter;
+  return APP_MSG_OK;
+}
+
+AppMessageResult app_message_outbox_send(void) {
+  if (!outbox_buffer) {
+    return APP_MSG_INVALID_ARGS;
+  }
+  if (!is_connected) {
+    return APP_MSG_NOT_CONNECTED;
+  }
+  last_sent_size = dict_write_end(&outbox_iter);
+  memcpy(last_sent, outbox_buffer, last_sent_size);
+  sent_count++;
+  return APP_MSG_OK;
+}
+
+const uint8_t *host_outbox_last(uint16_t *size) {
+  *size = last_sent_size;
+  return sent_count > 0 ? last_sent : NULL;
+}
+
+int host_outbox_count(void) { return sent_count; }
+
+void host_outbox_ack_last(void) {
+  DictionaryIterator iter;
+  if (outbox_sent && sent_count > 0 &&
+      dict_read_begin_from_buffer(&iter, last_sent, last_sent_size)) {
+    outbox_sent(&iter, NULL);
+  }
+}
+
+void host_outbox_fail_last(AppMessageResult reason) {
+  DictionaryIterator iter;
+  if (outbox_failed && sent_count > 0 &&
+      dict_read_begin_from_buffer(&iter, last_sent, last_sent_size)) {
+    outbox_failed(&iter, reason, NULL);
+  }
+}
+
+void host_inbox_deliver(const uint8_t *buffer, uint16_t size) {
+  DictionaryIterator iter;
+  if (inbox_received && dict_read_begin_from_buffer(&iter, buffer, size)) {
+    inbox_received(&iter, NULL);
+  }
+}
+
+// Event loop
+
+void app_event_loop(void) {
+  const char *run_seconds = getenv("HOST_RUN_SECONDS");
+  const int64_t end_ms =
+      run_seconds ? clock_ms + (atoll(run_seconds) * 1000) : INT64_MAX;
+  for (;;) {
+    if (is_render_pending) {
+      render();
+    }
+    // Whichever is due first; timers win ties, then animations, then ticks
+    Animation *animation = next_animation_frame();
+    const int64_t timer_ms = timers ? timers->due_ms : INT64_MAX;
+    const int64_t frame_ms = animation ? animation->next_frame_ms : INT64_MAX;
+    const int64_t tick_ms = tick_handler ? next_tick_s * 1000 : INT64_MAX;
+    int64_t due_ms = timer_ms;
+    if (frame_ms < due_ms) {
+      due_ms = frame_ms;
+    } else {
+      animation = NULL;
+    }
+    const bool is_tick = tick_ms < due_ms;
+    if (is_tick) {
+      due_ms = tick_ms;
+    }
+    if (due_ms == INT64_MAX || due_ms > end_ms) {
+      break;
+    }
+    if (due_ms > clock_ms) {
+      clock_ms = due_ms;
+    }
+    if (is_tick) {
+      fire_tick();
+    } else if (animation) {
+      step_animation(animation);
+    } else {
+      HostTimer *timer = timers;
+      timers = timer->next;
+      timer->callback(timer->data);
+      free(timer);
+    }
+  }
+  fflush(stdout);
+}
+
+// Runs before the app's main(): the screen, the saved persist keys, and UTC
+// for localtime()
+__attribute__((constructor)) static void host_init(void) {
+  setenv("TZ", "UTC0", 1);
+  tzset();
+  context.framebuffer = bitmap_create(
+      GSize(PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT), HOST_FRAMEBUFFER_FORMAT);
+  persist_load();
+}
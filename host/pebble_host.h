@@ -0,0 +1,57 @@
+#pragma once
+
+// What the host build adds to the stand-in SDK (pebble.h): the resource pack
+// tools/host_resources.py generates, and hooks for tests and tools to drive
+// the simulation the way the watch and phone would
+
+#include "pebble.h"
+
+// One bitmap resource, packed as the SDK loads a 1BitPalette one: rows of
+// (width + 7) / 8 bytes, leftmost pixel in the top bit, palette {Black,
+// White}. NULL data for resources the host doesn't load (the menu icon)
+typedef struct HostResource {
+  uint16_t width;
+  uint16_t height;
+  const uint8_t *data;
+} HostResource;
+
+extern const HostResource HOST_RESOURCES[];
+extern const int HOST_RESOURCE_COUNT;
+
+// The screen, as graphics_capture_frame_buffer() would hand it over
+GBitmap *host_framebuffer(void);
+
+// Writes the screen to path as a PNG, at the platform's resolution and in
+// its colors; returns whether it did
+bool host_write_png(const char *path);
+
+// Draws a frame now if any layer is dirty, as the event loop would
+void host_render(void);
+
+// Obstructs all but the top height pixels of the screen, as Timeline Quick
+// View does, without telling the app: for a launch under Quick View
+void host_set_unobstructed_height(int height);
+
+// Slides the unobstructed height to height, calling the subscribed handlers
+// and drawing a frame for each pixel it moves
+void host_animate_unobstructed_height(int height);
+
+// Forgets every persist key, as a reinstall (or a fresh watch) would
+void host_persist_clear(void);
+
+// Flips the Bluetooth connection, calling the subscribed handler
+void host_set_connected(bool is_connected);
+
+// Delivers a dictionary from the phone to the inbox handler
+void host_inbox_deliver(const uint8_t *buffer, uint16_t size);
+
+// The last dictionary the app sent, and how many it has sent; NULL and 0
+// before the first
+const uint8_t *host_outbox_last(uint16_t *size);
+int host_outbox_count(void);
+
+// Reports the last dictionary sent as delivered, as the phone's ACK would
+void host_outbox_ack_last(void);
+
+// Reports the last dictionary sent as failed, as a NACK from the phone would
+void host_outbox_fail_last(AppMessageResult reason);
@@ -0,0 +1,148 @@
+// Governor: feeds governor_frame_drawn() frames of known cost and checks when
+// the render quality steps down and back up; and checks the power tier each
+// battery level gets
+//
+//   make -C host test
+
+#include "governor.h"
+#include "pebble_host.h"
+
+// The face's own main() is renamed by host/Makefile for test builds
+#undef main
+
+#define BUDGET_MS 33
+#define SLOW_MS 40
+#define FAST_MS 5
+#define MINUTE_MS (60 * 1000)
+
+static int failures;
+// The simulated clock frames are fed in at; it only ever moves forwards, as
+// the governor's state lasts from one test to the next
+static uint32_t clock_ms = 1000;
+
+#define CHECK(what, expected, actual)                                          \
+  check(__func__, what, (int)(expected), (int)(actual))
+
+static void check(const char *test, const char *what, int expected,
+                  int actual) {
+  if (expected != actual) {
+    printf("FAIL %s: %s is %d, expected %d\n", test, what, actual, expected);
+    failures++;
+  }
+}
+
+// One frame a second, as live seconds draw them, for this many seconds
+static bool frames(int seconds, bool is_ghosted, uint32_t frame_ms) {
+  bool is_changed = false;
+  for (int i = 0; i < seconds; i++) {
+    clock_ms += 1000;
+    is_changed |=
+        governor_frame_drawn(clock_ms, is_ghosted, frame_ms, BUDGET_MS);
+  }
+  return is_changed;
+}
+
+// Back to full quality, with the hold at its first length
+static void reset(void) {
+  while (governor_quality() != RENDER_QUALITY_FULL) {
+    frames(60, false, 0);
+  }
+  frames(32 * 60, false, 0);
+}
+
+static void test_step_down_at_once(void) {
+  reset();
+  CHECK("changed", true, frames(1, true, SLOW_MS));
+  CHECK("quality", RENDER_QUALITY_LIGHT_SMEARS, governor_quality());
+  frames(2, true, SLOW_MS);
+  CHECK("quality", RENDER_QUALITY_MINIMAL, governor_quality());
+  CHECK("changed at the bottom", false, frames(1, true, SLOW_MS));
+}
+
+// Frames that only blit row caches still count towards stepping back up
+static void test_step_up_on_cached_frames(void) {
+  reset();
+  frames(1, true, SLOW_MS);
+  frames(59, false, 0);
+  CHECK("quality before the hold", RENDER_QUALITY_LIGHT_SMEARS,
+        governor_quality());
+  CHECK("changed", true, frames(1, false, 0));
+  CHECK("quality after the hold", RENDER_QUALITY_FULL, governor_quality());
+}
+
+// A trail frame over half the budget starts the hold again
+static void test_close_frame_restarts_hold(void) {
+  reset();
+  frames(1, true, SLOW_MS);
+  frames(30, false, 0);
+  frames(1, true, BUDGET_MS / 2 + 1);
+  frames(59, true, FAST_MS);
+  CHECK("quality", RENDER_QUALITY_LIGHT_SMEARS, governor_quality());
+  frames(1, true, FAST_MS);
+  CHECK("quality", RENDER_QUALITY_FULL, governor_quality());
+}
+
+// A step up that runs over again doubles the hold, up to 32 minutes
+static void test_failed_probe_doubles_hold(void) {
+  reset();
+  int hold_s = 60;
+  for (int probe = 0; probe < 7; probe++) {
+    frames(1, true, SLOW_MS);
+    frames(hold_s - 1, false, 0);
+    CHECK("quality before the hold", RENDER_QUALITY_LIGHT_SMEARS,
+          governor_quality());
+    frames(1, false, 0);
+    CHECK("quality after the hold", RENDER_QUALITY_FULL, governor_quality());
+    hold_s = hold_s * 2 > 32 * 60 ? 32 * 60 : hold_s * 2;
+  }
+}
+
+// Once a step up has held for a whole hold, the next one waits a minute again
+static void test_held_probe_resets_hold(void) {
+  reset();
+  frames(1, true, SLOW_MS);
+  frames(60, false, 0);
+  frames(1, true, SLOW_MS);
+  frames(120, false, 0);
+  CHECK("quality after a doubled hold", RENDER_QUALITY_FULL,
+        governor_quality());
+  frames(120, false, 0);
+  // Two steps down, so stepping up twice shows each hold
+  frames(2, true, SLOW_MS);
+  frames(60, false, 0);
+  CHECK("quality after one step", RENDER_QUALITY_LIGHT_SMEARS,
+        governor_quality());
+  frames(60, false, 0);
+  CHECK("quality after the next", RENDER_QUALITY_FULL, governor_quality());
+}
+
+// Critical set above low (the sliders allow it) is kept a step below low,
+// so the reduced tier still covers a range of battery levels
+static void test_critical_above_low(void) {
+  const PowerThresholds crossed = {.low_battery_percent = 20,
+                                   .critical_battery_percent = 40};
+  governor_start(&crossed, NULL);
+  governor_set_battery(30, false);
+  CHECK("tier above low", POWER_TIER_FULL, governor_tier());
+  governor_set_battery(20, false);
+  CHECK("tier at low", POWER_TIER_REDUCED, governor_tier());
+  governor_set_battery(15, false);
+  CHECK("tier a step below low", POWER_TIER_STATIC, governor_tier());
+
+  PowerThresholds clamped = crossed;
+  governor_clamp_thresholds(&clamped);
+  CHECK("clamped critical", 15, clamped.critical_battery_percent);
+  CHECK("clamped low", 20, clamped.low_battery_percent);
+  governor_stop();
+}
+
+int main(void) {
+  test_critical_above_low();
+  test_step_down_at_once();
+  test_step_up_on_cached_frames();
+  test_close_frame_restarts_hold();
+  test_failed_probe_doubles_hold();
+  test_held_probe_resets_hold();
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,76 @@
+// Quick View reflows: slides the unobstructed height a pixel per frame and
+// checks the face ends up with the same pixels as a launch at that height,
+// which paints the whole screen. Only the rows a reflow moves redraw, so
+// anything they leave behind shows up here
+//
+//   make -C host test
+
+#include "pebble_host.h"
+
+#include <string.h>
+
+// The face's own main() is renamed by host/Makefile for test builds
+#undef main
+
+void init(void);
+void deinit(void);
+
+// Timeline Quick View's height on rectangular watches
+#define QUICK_VIEW_HEIGHT_PX 51
+
+static int failures;
+
+static uint8_t expected_pixels[PBL_DISPLAY_WIDTH * PBL_DISPLAY_HEIGHT];
+
+static int framebuffer_bytes(void) {
+  GBitmap *fb = host_framebuffer();
+  return gbitmap_get_bytes_per_row(fb) * PBL_DISPLAY_HEIGHT;
+}
+
+// A fresh launch under an unobstructed height, drawn once. Persist is
+// cleared first, so no snapshot stands in for the face
+static void launch(int height) {
+  host_persist_clear();
+  host_set_unobstructed_height(height);
+  init();
+  host_render();
+}
+
+static void check_slide(const char *test, int from, int to) {
+  launch(to);
+  memcpy(expected_pixels, gbitmap_get_data(host_framebuffer()),
+         framebuffer_bytes());
+  deinit();
+
+  launch(from);
+  host_animate_unobstructed_height(to);
+  const uint8_t *pixels = gbitmap_get_data(host_framebuffer());
+  const int stride = gbitmap_get_bytes_per_row(host_framebuffer());
+  for (int y = 0; y < PBL_DISPLAY_HEIGHT; y++) {
+    if (memcmp(pixels + (y * stride), expected_pixels + (y * stride),
+               stride)) {
+      printf("FAIL %s: line %d differs from a launch at height %d\n", test, y,
+             to);
+      failures++;
+      break;
+    }
+  }
+  deinit();
+}
+
+static void test_quick_view_in(void) {
+  check_slide(__func__, PBL_DISPLAY_HEIGHT,
+              PBL_DISPLAY_HEIGHT - QUICK_VIEW_HEIGHT_PX);
+}
+
+static void test_quick_view_out(void) {
+  check_slide(__func__, PBL_DISPLAY_HEIGHT - QUICK_VIEW_HEIGHT_PX,
+              PBL_DISPLAY_HEIGHT);
+}
+
+int main(void) {
+  test_quick_view_in();
+  test_quick_view_out();
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
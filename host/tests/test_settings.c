@@ -0,0 +1,191 @@
+// Settings migration: launches the face over each kind of record an older
+// release may have left in persist, and checks what it stores in its place.
+// Also checks the settings report the face sends the phone
+//
+//   make -C host test
+
+#include "pebble_host.h"
+
+// The face's own main() is renamed by host/Makefile for test builds
+#undef main
+
+void init(void);
+void deinit(void);
+
+// As watchface.c numbers and packs them
+#define LEGACY_SETTINGS_KEY 1
+#define SETTINGS_RECORD_KEY 2
+#define SETTINGS_RECORD_VERSION 4
+#define SETTING_HEX_MODE (1 << 0)
+#define SETTING_POWER_MODE (1 << 1)
+#define SETTING_COLORIZE_DIGITS (1 << 2)
+#define SETTING_GHOST_TIME (1 << 3)
+#define SETTING_GHOST_DATE (1 << 4)
+#define SETTING_HOURLY_VIBRATE (1 << 5)
+#define SETTING_DISCONNECT_VIBRATE (1 << 6)
+#define SETTING_ANIMATE_TRANSITIONS (1 << 7)
+#define SETTINGS_DEFAULT_BITS                                                  \
+  (SETTING_HEX_MODE | SETTING_POWER_MODE | SETTING_GHOST_TIME |                \
+   SETTING_DISCONNECT_VIBRATE)
+// 30%, 10% and 5 seconds, packed as index.js packs them
+#define POWER_THRESHOLDS_DEFAULT_PACKED (30 | (10 << 8) | (5 << 16))
+
+static int failures;
+
+#define CHECK(what, expected, actual)                                          \
+  check(__func__, what, (int)(expected), (int)(actual))
+
+static void check(const char *test, const char *what, int expected,
+                  int actual) {
+  if (expected != actual) {
+    printf("FAIL %s: %s is %d (0x%x), expected %d (0x%x)\n", test, what,
+           actual, actual, expected, expected);
+    failures++;
+  }
+}
+
+// Launches and exits the face once over whatever persist holds
+static void launch(void) {
+  init();
+  deinit();
+}
+
+// The record launch() left: its version and bits
+static void check_record(const char *test, int version, int bits) {
+  uint8_t record[4] = {0};
+  const int size = persist_read_data(SETTINGS_RECORD_KEY, record,
+                                     sizeof(record));
+  check(test, "record size", sizeof(record), size);
+  check(test, "record version", version, record[0]);
+  check(test, "record bits", bits, record[2] | (record[3] << 8));
+}
+
+static void test_no_settings(void) {
+  host_persist_clear();
+  launch();
+  check_record(__func__, SETTINGS_RECORD_VERSION, SETTINGS_DEFAULT_BITS);
+}
+
+// The first releases persisted their 7-bool ClaySettings as is
+static void test_legacy_record(void) {
+  host_persist_clear();
+  const bool legacy[7] = {true, false, true, false, true, true, false};
+  persist_write_data(LEGACY_SETTINGS_KEY, legacy, sizeof(legacy));
+  launch();
+  check_record(__func__, SETTINGS_RECORD_VERSION,
+               SETTING_HEX_MODE | SETTING_COLORIZE_DIGITS |
+                   SETTING_GHOST_DATE | SETTING_HOURLY_VIBRATE);
+  CHECK("legacy key exists", false, persist_exists(LEGACY_SETTINGS_KEY));
+}
+
+// Anything but exactly 7 bytes isn't a legacy record, so isn't read as one
+static void test_legacy_record_wrong_size(void) {
+  host_persist_clear();
+  const bool legacy[9] = {false};
+  persist_write_data(LEGACY_SETTINGS_KEY, legacy, sizeof(legacy));
+  launch();
+  check_record(__func__, SETTINGS_RECORD_VERSION, SETTINGS_DEFAULT_BITS);
+}
+
+// Version 1 only knew the first 7 bits; the rest take their defaults even if
+// set in the record
+static void test_v1_record(void) {
+  host_persist_clear();
+  const uint16_t bits = SETTING_POWER_MODE | SETTING_ANIMATE_TRANSITIONS;
+  const uint8_t record[4] = {1, 0, bits & 0xFF, bits >> 8};
+  persist_write_data(SETTINGS_RECORD_KEY, record, sizeof(record));
+  launch();
+  check_record(__func__, SETTINGS_RECORD_VERSION, SETTING_POWER_MODE);
+}
+
+// A record takes precedence over a legacy key still lying around
+static void test_record_over_legacy(void) {
+  host_persist_clear();
+  const bool legacy[7] = {true, true, true, true, true, true, true};
+  persist_write_data(LEGACY_SETTINGS_KEY, legacy, sizeof(legacy));
+  const uint8_t record[4] = {SETTINGS_RECORD_VERSION, 0, SETTING_GHOST_DATE,
+                             0};
+  persist_write_data(SETTINGS_RECORD_KEY, record, sizeof(record));
+  launch();
+  check_record(__func__, SETTINGS_RECORD_VERSION, SETTING_GHOST_DATE);
+}
+
+// Runs the face's event loop for a few simulated seconds
+static void run_for(const char *seconds) {
+  setenv("HOST_RUN_SECONDS", seconds, 1);
+  app_event_loop();
+  unsetenv("HOST_RUN_SECONDS");
+}
+
+// The last dictionary the face sent: its settings bits and power thresholds
+static void check_report(const char *test, int bits, int thresholds) {
+  uint16_t size;
+  const uint8_t *sent = host_outbox_last(&size);
+  DictionaryIterator iter;
+  if (!sent || !dict_read_begin_from_buffer(&iter, sent, size)) {
+    check(test, "report sent", true, false);
+    return;
+  }
+  const Tuple *bits_tuple = dict_find(&iter, MESSAGE_KEY_SettingsBits);
+  const Tuple *thresholds_tuple =
+      dict_find(&iter, MESSAGE_KEY_PowerThresholds);
+  check(test, "report has bits", true, bits_tuple != NULL);
+  check(test, "report has thresholds", true, thresholds_tuple != NULL);
+  if (bits_tuple && thresholds_tuple) {
+    check(test, "reported bits", bits, bits_tuple->value->int32);
+    check(test, "reported thresholds", thresholds,
+          thresholds_tuple->value->int32);
+  }
+}
+
+static void test_report_on_launch(void) {
+  host_persist_clear();
+  const uint8_t record[4] = {SETTINGS_RECORD_VERSION, 0, SETTING_GHOST_DATE,
+                             0};
+  persist_write_data(SETTINGS_RECORD_KEY, record, sizeof(record));
+  const int sent = host_outbox_count();
+  init();
+  CHECK("reports sent", sent + 1, host_outbox_count());
+  check_report(__func__, SETTING_GHOST_DATE, POWER_THRESHOLDS_DEFAULT_PACKED);
+  deinit();
+}
+
+// Nothing goes out while disconnected; the report waits for the reconnect
+static void test_report_on_reconnect(void) {
+  host_persist_clear();
+  host_set_connected(false);
+  const int sent = host_outbox_count();
+  init();
+  CHECK("reports sent disconnected", sent, host_outbox_count());
+  host_set_connected(true);
+  CHECK("reports sent on reconnect", sent + 1, host_outbox_count());
+  check_report(__func__, SETTINGS_DEFAULT_BITS,
+               POWER_THRESHOLDS_DEFAULT_PACKED);
+  deinit();
+}
+
+// A report the phone NACKs (its JS still starting, say) is sent again
+static void test_report_retried(void) {
+  host_persist_clear();
+  const int sent = host_outbox_count();
+  init();
+  host_outbox_fail_last(APP_MSG_SEND_REJECTED);
+  run_for("3");
+  CHECK("reports sent after a NACK", sent + 2, host_outbox_count());
+  check_report(__func__, SETTINGS_DEFAULT_BITS,
+               POWER_THRESHOLDS_DEFAULT_PACKED);
+  deinit();
+}
+
+int main(void) {
+  test_no_settings();
+  test_legacy_record();
+  test_legacy_record_wrong_size();
+  test_v1_record();
+  test_record_over_legacy();
+  test_report_on_launch();
+  test_report_on_reconnect();
+  test_report_retried();
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+// Telemetry delivery: sends batches through the face's own outbox handlers
+// and checks that a batch is only dropped once the phone acknowledges it
+//
+//   make -C host test
+
+#include "pebble_host.h"
+#include "telemetry.h"
+
+// The face's own main() is renamed by host/Makefile for test builds
+#undef main
+
+void init(void);
+void deinit(void);
+
+static int failures;
+
+#define CHECK(what, expected, actual)                                          \
+  check(__func__, what, (int)(expected), (int)(actual))
+
+static void check(const char *test, const char *what, int expected,
+                  int actual) {
+  if (expected != actual) {
+    printf("FAIL %s: %s is %d, expected %d\n", test, what, actual, expected);
+    failures++;
+  }
+}
+
+static void updates(int count) {
+  for (int i = 0; i < count; i++) {
+    telemetry_update_begin();
+    telemetry_update_end(true);
+  }
+}
+
+// The update count of the last batch sent, or -1 if the last message sent
+// wasn't a batch
+static int last_batch_updates(void) {
+  uint16_t size;
+  const uint8_t *sent = host_outbox_last(&size);
+  DictionaryIterator iter;
+  if (!sent || !dict_read_begin_from_buffer(&iter, sent, size)) {
+    return -1;
+  }
+  const Tuple *tuple = dict_find(&iter, MESSAGE_KEY_Telemetry);
+  if (!tuple) {
+    return -1;
+  }
+  const uint8_t *batch = (const uint8_t *)tuple->value;
+  return batch[2] | (batch[3] << 8);
+}
+
+// A fresh face with telemetry on, and nothing in flight
+static void launch(void) {
+  host_persist_clear();
+  init();
+  telemetry_set_enabled(true);
+}
+
+static void test_acked_batch_dropped(void) {
+  launch();
+  updates(3);
+  telemetry_flush();
+  CHECK("first batch updates", 3, last_batch_updates());
+  host_outbox_ack_last();
+  updates(2);
+  telemetry_flush();
+  CHECK("second batch updates", 2, last_batch_updates());
+  deinit();
+}
+
+static void test_failed_batch_merged(void) {
+  launch();
+  updates(3);
+  telemetry_flush();
+  host_outbox_fail_last(APP_MSG_SEND_TIMEOUT);
+  updates(2);
+  telemetry_flush();
+  CHECK("batch after a failure", 5, last_batch_updates());
+  deinit();
+}
+
+// Nothing new goes out while the phone hasn't answered for the last batch
+static void test_unanswered_batch_held(void) {
+  launch();
+  updates(3);
+  telemetry_flush();
+  const int sent = host_outbox_count();
+  updates(2);
+  telemetry_flush();
+  CHECK("sent while in flight", sent, host_outbox_count());
+  host_outbox_fail_last(APP_MSG_SEND_TIMEOUT);
+  telemetry_flush();
+  CHECK("batch once answered", 5, last_batch_updates());
+  deinit();
+}
+
+int main(void) {
+  test_acked_batch_dropped();
+  test_failed_batch_merged();
+  test_unanswered_batch_held();
+  printf("%s\n", failures ? "FAILED" : "PASSED");
+  return failures ? 1 : 0;
+}
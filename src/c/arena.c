@@ -0,0 +1,96 @@
+// Render arena: see arena.h
+
+#include "arena.h"
+
+#include "framebuffer.h"
+#include "memstats.h"
+
+static GBitmap *arena_bmp;
+static int capacity_lines;
+static int used_lines;
+static GBitmap *surfaces[ARENA_MAX_SURFACES];
+static int surface_count;
+// So a row that keeps asking while the arena is full only warns once
+static bool is_full_logged;
+#ifdef MEMORY_REPORT
+static int peak_lines;
+#endif
+
+bool arena_init(int lines) {
+  // Whatever the heap has room for is better than no caches at all
+  while (lines > 0 && !arena_bmp) {
+    arena_bmp = gbitmap_create_blank(GSize(PBL_DISPLAY_WIDTH, lines),
+                                     FRAMEBUFFER_FORMAT);
+    if (!arena_bmp) {
+      lines /= 2;
+    }
+  }
+  capacity_lines = arena_bmp ? lines : 0;
+  used_lines = 0;
+  if (!arena_bmp) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "No heap for the arena; rows go uncached");
+  }
+#ifdef MEMORY_REPORT
+  APP_LOG(APP_LOG_LEVEL_INFO, "MEM arena capacity=%d lines bytes=%d",
+          capacity_lines,
+          arena_bmp ? capacity_lines * gbitmap_get_bytes_per_row(arena_bmp)
+                    : 0);
+#endif
+  return arena_bmp != NULL;
+}
+
+void arena_deinit(void) {
+  arena_reset();
+  if (arena_bmp) {
+    gbitmap_destroy(arena_bmp);
+    arena_bmp = NULL;
+  }
+  capacity_lines = 0;
+}
+
+GBitmap *arena_carve(int lines) {
+  if (!arena_bmp || surface_count == ARENA_MAX_SURFACES ||
+      used_lines + lines > capacity_lines) {
+    if (!is_full_logged) {
+      APP_LOG(APP_LOG_LEVEL_WARNING, "Arena full: %d of %d lines free",
+              capacity_lines - used_lines, capacity_lines);
+      is_full_logged = true;
+    }
+    return NULL;
+  }
+  GBitmap *surface = gbitmap_create_as_sub_bitmap(
+      arena_bmp, (GRect){.origin = {0, used_lines},
+                         .size = {PBL_DISPLAY_WIDTH, lines}});
+  if (!surface) {
+    return NULL;
+  }
+  surfaces[surface_count++] = surface;
+  used_lines += lines;
+#ifdef MEMORY_REPORT
+  if (used_lines > peak_lines) {
+    peak_lines = used_lines;
+    APP_LOG(APP_LOG_LEVEL_INFO, "MEM arena used=%d/%d lines surfaces=%d",
+            used_lines, capacity_lines, surface_count);
+  }
+#endif
+  MEMSTATS_SAMPLE("arena_carve");
+  return surface;
+}
+
+void arena_reset(void) {
+  for (int i = 0; i < surface_count; i++) {
+    gbitmap_destroy(surfaces[i]);
+    surfaces[i] = NULL;
+  }
+  surface_count = 0;
+  used_lines = 0;
+  is_full_logged = false;
+}
+
+int arena_lines_free(void) { return capacity_lines - used_lines; }
+
+uint8_t *arena_surface_data(GBitmap *surface) {
+  return (uint8_t *)gbitmap_get_data(surface) +
+         (gbitmap_get_bounds(surface).origin.y *
+          gbitmap_get_bytes_per_row(surface));
+}
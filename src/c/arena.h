@@ -0,0 +1,29 @@
+#pragma once
+
+#include "common.h"
+
+// One display-wide bitmap, allocated once at launch, that the row surfaces
+// are carved from instead of each being its own heap allocation. Carving only
+// ever bumps down the arena; nothing is handed back until arena_reset(), which
+// the face calls whenever its settings change which rows it caches. A carve
+// that won't fit fails, and the row just goes uncached
+
+// A cache and a back buffer per digit row
+#define ARENA_MAX_SURFACES 10
+
+// Takes the largest block up to lines tall the heap has room for; returns
+// whether it got any
+bool arena_init(int lines);
+void arena_deinit(void);
+
+// A PBL_DISPLAY_WIDTH wide surface, or NULL once the arena (or the heap, for
+// the sub-bitmap itself) is out of room. Its contents are left as they were
+GBitmap *arena_carve(int lines);
+
+// Frees every surface carved so far; drop any pointer to them first
+void arena_reset(void);
+
+int arena_lines_free(void);
+
+// Where a surface's first line starts: a sub-bitmap's data is its parent's
+uint8_t *arena_surface_data(GBitmap *surface);
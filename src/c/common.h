@@ -4,6 +4,53 @@
 
 // #define DEBUG_MODE
 
+// Replaces the normal tick-driven face with the render harness (harness.c),
+// which steps through every settings combination at a handful of fixed times
+// and logs frame cost. Run with `pebble install --emulator <platform> --logs`,
+// or on Linux from host/Makefile, which sets it itself
+// #define BENCHMARK_MODE
+
+// Turns the harness into a rendering sweep: every value of every row, under
+// every settings combination and clock style, logged as one hash per row for
+// tools/sweep.py to compare against golden hashes. Implies BENCHMARK_MODE
+// #define SWEEP_MODE
+
+// Turns the harness into a screenshot run: each store-page preset is drawn
+// once and held on screen while tools/screenshots.py captures it. Implies
+// BENCHMARK_MODE
+// #define SCREENSHOT_MODE
+
+#if (defined(SWEEP_MODE) || defined(SCREENSHOT_MODE)) &&                      \
+    !defined(BENCHMARK_MODE)
+#define BENCHMARK_MODE
+#endif
+
+// Draws glyphs, smears, the seconds comb and the battery bars straight into
+// the captured framebuffer (framebuffer.c) rather than through graphics_*.
+// The SDK path stays the default; BENCHMARK_MODE can compare the two
+// #define DIRECT_FRAMEBUFFER_RENDERING
+
+// Logs heap use (memstats.c) around each allocation phase of init(), and the
+// heap high-water mark whenever drawing pushes it up
+// #define MEMORY_REPORT
+
+// Replays a day of events (src/c/replay_trace.auto.h, from tools/replay.py)
+// through the face's own handlers on a simulated clock that jumps straight to
+// whatever is due next, once per candidate setting, and logs what each day
+// cost: wakeups, frames, draw calls, pixels, motor time and AppMessage bytes.
+// Can't be combined with BENCHMARK_MODE
+// #define REPLAY_MODE
+
+#if defined(REPLAY_MODE) && defined(BENCHMARK_MODE)
+#error "REPLAY_MODE runs the tick-driven face, which BENCHMARK_MODE replaces"
+#endif
+
+// Relaunches paint the last frame from a persisted snapshot (snapshot.c)
+// while everything else loads. Sweeps and screenshots draw every frame
+#if !defined(SWEEP_MODE) && !defined(SCREENSHOT_MODE)
+#define SNAPSHOT_ENABLED
+#endif
+
 #ifdef DEBUG_MODE
 #define IS_DEBUGGING true
 #else
@@ -14,8 +61,153 @@
 #define VERBOSE_LOGGING_ENABLED
 #endif
 
+// Debug builds log every event a handler gets as a TRACE line, which
+// `tools/replay.py capture` turns into a trace REPLAY_MODE can replay
+#ifdef DEBUG_MODE
+#define TRACE_EVENT(kind, value)                                               \
+  APP_LOG(APP_LOG_LEVEL_DEBUG, "TRACE t=%ld " #kind "=%ld", (long)time(NULL),  \
+          (long)(value))
+#else
+#define TRACE_EVENT(kind, value)
+#endif
+
 #ifdef VERBOSE_LOGGING_ENABLED
 #define VERBOSE_LOG(msg, ...) APP_LOG(APP_LOG_LEVEL_DEBUG, msg, ##__VA_ARGS__)
 #else
 #define VERBOSE_LOG(msg, ...)
-#endif
\ No newline at end of file
+#endif
+
+// Debug builds count calls to (and time spent in) the expensive parts of a
+// redraw, so their cost can be told apart; see profile_log() in telemetry.c
+#ifdef DEBUG_MODE
+#define PROFILING_ENABLED
+#endif
+
+#ifdef PROFILING_ENABLED
+typedef enum ProfileSection {
+  PROFILE_HEX_ROW,
+  PROFILE_SECONDS_COMB,
+  PROFILE_SMEAR,
+  PROFILE_SECTION_COUNT
+} ProfileSection;
+
+typedef struct ProfileCounter {
+  uint32_t calls;
+  uint32_t total_ms;
+} ProfileCounter;
+
+extern ProfileCounter profile_counters[PROFILE_SECTION_COUNT];
+uint32_t profile_now_ms(void);
+void profile_log(void);
+
+// A BEGIN and its END must be in the same scope
+#define PROFILE_BEGIN(section) const uint32_t section##_start = profile_now_ms()
+#define PROFILE_END(section)                                                   \
+  (profile_counters[section].calls++,                                          \
+   profile_counters[section].total_ms += profile_now_ms() - section##_start)
+#else
+#define PROFILE_BEGIN(section)
+#define PROFILE_END(section)
+#endif
+
+// The harness and replay log what every frame draws, and debug builds send
+// it with their telemetry; release builds don't pay for the counting
+#if defined(BENCHMARK_MODE) || defined(REPLAY_MODE) ||                        \
+    defined(PROFILING_ENABLED)
+#define FRAME_STATS_ENABLED
+#endif
+
+#ifdef FRAME_STATS_ENABLED
+typedef struct FrameStats {
+  uint32_t draw_calls;
+  uint32_t state_changes;
+  uint32_t pixels_written;
+} FrameStats;
+
+extern FrameStats frame_stats;
+
+static inline uint32_t frame_stats_clipped_area(GRect rect) {
+  int x0 = rect.origin.x < 0 ? 0 : rect.origin.x;
+  int y0 = rect.origin.y < 0 ? 0 : rect.origin.y;
+  int x1 = rect.origin.x + rect.size.w;
+  int y1 = rect.origin.y + rect.size.h;
+  x1 = x1 > PBL_DISPLAY_WIDTH ? PBL_DISPLAY_WIDTH : x1;
+  y1 = y1 > PBL_DISPLAY_HEIGHT ? PBL_DISPLAY_HEIGHT : y1;
+  return (x1 > x0 && y1 > y0) ? (uint32_t)((x1 - x0) * (y1 - y0)) : 0;
+}
+
+static inline void frame_stats_rect(GRect rect) {
+  frame_stats.draw_calls++;
+  frame_stats.pixels_written += frame_stats_clipped_area(rect);
+}
+
+static inline void frame_stats_fill_rect(GRect rect, uint16_t corner_radius,
+                                         GCornerMask corner_mask) {
+  frame_stats_rect(rect);
+}
+
+static inline void frame_stats_pixel(GPoint point) {
+  frame_stats_rect((GRect){.origin = point, .size = {1, 1}});
+}
+
+static inline void frame_stats_line(GPoint p0, GPoint p1) {
+  // Only axis-aligned lines are drawn, so the bounding box is the line
+  const int x = p0.x < p1.x ? p0.x : p1.x;
+  const int y = p0.y < p1.y ? p0.y : p1.y;
+  const int w = (p0.x < p1.x ? p1.x - p0.x : p0.x - p1.x) + 1;
+  const int h = (p0.y < p1.y ? p1.y - p0.y : p0.y - p1.y) + 1;
+  frame_stats_rect((GRect){.origin = {x, y}, .size = {w, h}});
+}
+
+// These shadow the SDK calls of the same name. A function-like macro isn't
+// re-expanded inside its own body, so the inner call still reaches the SDK.
+// Arguments are variadic because GRect/GPoint compound literals contain commas
+#define graphics_draw_bitmap_in_rect(ctx, bmp, ...)                            \
+  (frame_stats_rect(__VA_ARGS__),                                              \
+   graphics_draw_bitmap_in_rect(ctx, bmp, __VA_ARGS__))
+#define graphics_draw_pixel(ctx, ...)                                          \
+  (frame_stats_pixel(__VA_ARGS__), graphics_draw_pixel(ctx, __VA_ARGS__))
+#define graphics_draw_line(ctx, ...)                                           \
+  (frame_stats_line(__VA_ARGS__), graphics_draw_line(ctx, __VA_ARGS__))
+#define graphics_fill_rect(ctx, ...)                                           \
+  (frame_stats_fill_rect(__VA_ARGS__), graphics_fill_rect(ctx, __VA_ARGS__))
+#define graphics_context_set_compositing_mode(ctx, mode)                       \
+  (frame_stats.state_changes++,                                                \
+   graphics_context_set_compositing_mode(ctx, mode))
+#define graphics_context_set_fill_color(ctx, color)                            \
+  (frame_stats.state_changes++, graphics_context_set_fill_color(ctx, color))
+#define graphics_context_set_stroke_color(ctx, color)                          \
+  (frame_stats.state_changes++, graphics_context_set_stroke_color(ctx, color))
+#endif
+
+#ifdef REPLAY_MODE
+// Shadows like the graphics_* ones above, so the face's clock, tick, timers,
+// taps and motor all run on the replay's simulated time (replay.c). time_ms()
+// is left alone: it times frames, which are real work either way
+time_t replay_time(time_t *out);
+void replay_tick_subscribe(TimeUnits units, TickHandler handler);
+void replay_tick_unsubscribe(void);
+AppTimer *replay_timer_register(uint32_t timeout_ms, AppTimerCallback callback,
+                                void *data);
+bool replay_timer_reschedule(AppTimer *timer, uint32_t timeout_ms);
+void replay_timer_cancel(AppTimer *timer);
+void replay_tap_subscribe(AccelTapHandler handler);
+void replay_tap_unsubscribe(void);
+void replay_vibe(uint32_t ms);
+
+// Roughly how long the firmware runs the motor for a long pulse
+#define REPLAY_LONG_PULSE_MS 500
+
+#define time(out) replay_time(out)
+#define tick_timer_service_subscribe(units, handler)                           \
+  replay_tick_subscribe(units, handler)
+#define tick_timer_service_unsubscribe() replay_tick_unsubscribe()
+#define app_timer_register(timeout_ms, callback, data)                         \
+  replay_timer_register(timeout_ms, callback, data)
+#define app_timer_reschedule(timer, timeout_ms)                                \
+  replay_timer_reschedule(timer, timeout_ms)
+#define app_timer_cancel(timer) replay_timer_cancel(timer)
+#define accel_tap_service_subscribe(handler) replay_tap_subscribe(handler)
+#define accel_tap_service_unsubscribe() replay_tap_unsubscribe()
+#define vibes_long_pulse() replay_vibe(REPLAY_LONG_PULSE_MS)
+#endif
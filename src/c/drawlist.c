@@ -0,0 +1,111 @@
+// Per-layer command list for the graphics_* path; see drawlist.h
+// The direct framebuffer blitters don't go through here: they have no
+// drawing state to change
+
+#include "drawlist.h"
+
+// Enough for the busiest row: a small, single-width row on emery ghosts
+// about 14 copies, each a glyph and a smear. A fuller list is flushed early,
+// which is still correct: splitting it only keeps draws closer to the order
+// they were queued in
+#define DRAW_LIST_CAPACITY 40
+
+typedef struct DrawOp {
+  GRect rect;
+  GBitmap *bmp; // NULL for a fill
+  uint8_t pass;
+  uint8_t state; // GCompOp for a bitmap, the fill color's argb for a fill
+  uint8_t corner_radius;
+  uint8_t corner_mask;
+} DrawOp;
+
+static DrawOp ops[DRAW_LIST_CAPACITY];
+static int op_count;
+
+// Bitmaps sort ahead of fills in a pass, so the two kinds never alternate
+static uint16_t sort_key(const DrawOp *op) {
+  return ((uint16_t)op->pass << 9) | ((op->bmp ? 0 : 1) << 8) | op->state;
+}
+
+static DrawOp *append(GContext *ctx) {
+  if (op_count == DRAW_LIST_CAPACITY) {
+    VERBOSE_LOG("Draw list full, flushing early");
+    draw_list_flush(ctx);
+  }
+  return &ops[op_count++];
+}
+
+void draw_list_bitmap(GContext *ctx, DrawPass pass, GBitmap *bmp,
+                      GCompOp op, GRect rect) {
+  *append(ctx) =
+      (DrawOp){.rect = rect, .bmp = bmp, .pass = pass, .state = op};
+}
+
+void draw_list_fill_rect(GContext *ctx, DrawPass pass, GColor color,
+                         GRect rect, uint16_t corner_radius,
+                         GCornerMask corner_mask) {
+  *append(ctx) = (DrawOp){.rect = rect,
+                          .pass = pass,
+                          .state = color.argb,
+                          .corner_radius = corner_radius,
+                          .corner_mask = corner_mask};
+}
+
+void draw_bitmap_cut(GContext *ctx, GBitmap *bmp, GRect rect, int right) {
+  const int left_cut = rect.origin.x < 0 ? -rect.origin.x : 0;
+  const int rect_right = rect.origin.x + rect.size.w;
+  const int right_cut = rect_right > right ? rect_right - right : 0;
+  if (left_cut + right_cut >= rect.size.w) {
+    return;
+  }
+  if (left_cut == 0 && right_cut == 0) {
+    graphics_draw_bitmap_in_rect(ctx, bmp, rect);
+    return;
+  }
+  const GRect bounds = gbitmap_get_bounds(bmp);
+  const int width = rect.size.w - left_cut - right_cut;
+  gbitmap_set_bounds(
+      bmp, (GRect){.origin = {bounds.origin.x + left_cut, bounds.origin.y},
+                   .size = {width, bounds.size.h}});
+  graphics_draw_bitmap_in_rect(
+      ctx, bmp,
+      (GRect){.origin = {rect.origin.x + left_cut, rect.origin.y},
+              .size = {width, rect.size.h}});
+  gbitmap_set_bounds(bmp, bounds);
+}
+
+void draw_list_flush(GContext *ctx) {
+  // Insertion sort: the lists are short, mostly in order already, and it's
+  // stable, so draws that share a key keep the order they were queued in
+  for (int i = 1; i < op_count; i++) {
+    const DrawOp op = ops[i];
+    const uint16_t key = sort_key(&op);
+    int j = i;
+    for (; j > 0 && sort_key(&ops[j - 1]) > key; j--) {
+      ops[j] = ops[j - 1];
+    }
+    ops[j] = op;
+  }
+
+  int last_key = -1;
+  for (int i = 0; i < op_count; i++) {
+    const DrawOp *op = &ops[i];
+    const int key = sort_key(op) & 0x1FF; // The pass alone changes no state
+    if (key != last_key) {
+      if (op->bmp) {
+        graphics_context_set_compositing_mode(ctx, (GCompOp)op->state);
+      } else {
+        graphics_context_set_fill_color(ctx, (GColor){.argb = op->state});
+      }
+      last_key = key;
+    }
+    if (op->bmp) {
+      draw_bitmap_cut(ctx, op->bmp, op->rect,
+                      op->rect.origin.x + op->rect.size.w);
+    } else {
+      graphics_fill_rect(ctx, op->rect, op->corner_radius,
+                         (GCornerMask)op->corner_mask);
+    }
+  }
+  op_count = 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+
+// Collects a layer's graphics_* draws instead of issuing them one by one, so
+// draw_list_flush() can run them grouped by pass and then by drawing state,
+// setting each compositing mode or fill color once rather than per draw
+
+// Passes run in order; within a pass, draws that share state run together.
+// Nothing in one pass may overlap another draw in the same pass
+typedef enum DrawPass {
+  DRAW_PASS_BASE,    // Glyphs, strips and icons on the cleared background
+  DRAW_PASS_OVERLAY, // Smears, punched into what the base pass drew
+  DRAW_PASS_COUNT
+} DrawPass;
+
+void draw_list_bitmap(GContext *ctx, DrawPass pass, GBitmap *bmp,
+                      GCompOp op, GRect rect);
+void draw_list_fill_rect(GContext *ctx, DrawPass pass, GColor color,
+                         GRect rect, uint16_t corner_radius,
+                         GCornerMask corner_mask);
+
+// Draws the columns of rect from x = 0 up to right, for a layer that starts
+// at the screen's left edge, by narrowing the bitmap's bounds for the draw
+// rather than handing the SDK a draw outside the framebuffer to clip. rect
+// may be no wider than the bitmap. The list flushes through here with no
+// right cut: only ghost copies are meant to hang off an edge, and only the
+// left one
+void draw_bitmap_cut(GContext *ctx, GBitmap *bmp, GRect rect, int right);
+
+// Runs and clears everything queued; call before the layer's update returns.
+// The SDK resets drawing state between layers, so nothing carries over
+void draw_list_flush(GContext *ctx);
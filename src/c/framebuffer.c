@@ -0,0 +1,219 @@
+// Direct framebuffer blitters, used instead of graphics_* when
+// DIRECT_FRAMEBUFFER_RENDERING is on (see common.h), and to draw rows into
+// their back buffers ahead of a minute tick
+
+#include "framebuffer.h"
+
+#include <string.h>
+
+#ifdef SWEEP_MODE
+#include "harness.h"
+#endif
+
+// Widest comb row we ever draw, in bytes of a packed 1-bit row
+#define MAX_COMB_ROW_BYTES ((PBL_DISPLAY_WIDTH + 7) / 8)
+
+static bool point_at(GBitmap *bmp, GPoint origin, FramebufferTarget *target) {
+  if (gbitmap_get_format(bmp) != FRAMEBUFFER_FORMAT) {
+    VERBOSE_LOG("Unexpected bitmap format %d", gbitmap_get_format(bmp));
+    return false;
+  }
+  // Arena surfaces are sub-bitmaps, whose data is their parent's; they
+  // always start at x 0
+  const GRect bounds = gbitmap_get_bounds(bmp);
+  const int stride = gbitmap_get_bytes_per_row(bmp);
+  *target = (FramebufferTarget){.bmp = bmp,
+                                .data = (uint8_t *)gbitmap_get_data(bmp) +
+                                        (bounds.origin.y * stride),
+                                .stride = stride,
+                                .width = bounds.size.w,
+                                .height = bounds.size.h,
+                                .origin = origin};
+  return true;
+}
+
+bool framebuffer_begin(GContext *ctx, GPoint origin,
+                       FramebufferTarget *target) {
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    return false;
+  }
+  if (!point_at(fb, origin, target)) {
+    graphics_release_frame_buffer(ctx, fb);
+    return false;
+  }
+  return true;
+}
+
+void framebuffer_end(GContext *ctx, FramebufferTarget *target) {
+  graphics_release_frame_buffer(ctx, target->bmp);
+  target->bmp = NULL;
+}
+
+bool framebuffer_begin_bitmap(GBitmap *bmp, FramebufferTarget *target) {
+  return point_at(bmp, GPointZero, target);
+}
+
+void framebuffer_clear(FramebufferTarget *target, GColor color) {
+#ifdef PBL_COLOR
+  const uint8_t fill = color.argb;
+#else
+  const uint8_t fill = gcolor_equal(color, GColorWhite) ? 0xFF : 0x00;
+#endif
+  memset(target->data, fill, target->stride * target->height);
+}
+
+// Mask with the top n bits set; bit 31 is always the leftmost pixel here
+static uint32_t top_bits(int n) {
+  return n >= 32 ? 0xFFFFFFFFU : ~(0xFFFFFFFFU >> n);
+}
+
+#ifndef PBL_COLOR
+static uint32_t reverse_bits(uint32_t v) {
+  v = ((v >> 1) & 0x55555555U) | ((v & 0x55555555U) << 1);
+  v = ((v >> 2) & 0x33333333U) | ((v & 0x33333333U) << 2);
+  v = ((v >> 4) & 0x0F0F0F0FU) | ((v & 0x0F0F0F0FU) << 4);
+  v = ((v >> 8) & 0x00FF00FFU) | ((v & 0x00FF00FFU) << 8);
+  return (v >> 16) | (v << 16);
+}
+#endif
+
+// Writes one run of up to 32 pixels, bit 31 of bits landing on x
+static inline void write_row_bits(FramebufferTarget *target, int x, int y,
+                                  uint32_t bits, GColor color) {
+  uint8_t *row = target->data + (y * target->stride);
+#ifdef PBL_COLOR
+  uint8_t *dst = row + x;
+  while (bits) {
+    const int n = __builtin_clz(bits);
+    dst[n] = color.argb;
+    bits &= ~(0x80000000U >> n);
+  }
+#else
+  // Packed 1-bit keeps the leftmost pixel in the lowest bit of each byte
+  uint64_t run = (uint64_t)reverse_bits(bits) << (x & 7);
+  uint8_t *dst = row + (x >> 3);
+  if (gcolor_equal(color, GColorWhite)) {
+    for (; run; run >>= 8) {
+      *dst++ |= (uint8_t)run;
+    }
+  } else {
+    for (; run; run >>= 8) {
+      *dst++ &= (uint8_t)~run;
+    }
+  }
+#endif
+}
+
+void framebuffer_blit_1bit(FramebufferTarget *target, const GBitmap *bmp,
+                           int x, int y, int ink_index, GColor color) {
+  // Sub-bitmaps share their parent's data; bounds say where they sit in it
+  const GRect src_bounds = gbitmap_get_bounds(bmp);
+  const GSize size = src_bounds.size;
+  const int src_stride = gbitmap_get_bytes_per_row(bmp);
+  const int src_shift = src_bounds.origin.x & 7;
+  const uint8_t *src = (const uint8_t *)gbitmap_get_data(bmp) +
+                       (src_bounds.origin.y * src_stride) +
+                       (src_bounds.origin.x >> 3);
+  // 32 bits starting mid-byte can span 5 bytes; never read past the row
+  const int src_row_bytes = src_stride - (src_bounds.origin.x >> 3);
+  const int src_bytes = src_row_bytes < 5 ? src_row_bytes : 5;
+
+  // Clip horizontally once, as a mask over the (left-shifted) source bits
+  int fb_x = target->origin.x + x;
+  const int fb_y = target->origin.y + y;
+  int left_cut = 0;
+  if (fb_x < 0) {
+    left_cut = -fb_x;
+    fb_x = 0;
+  }
+#ifdef SWEEP_MODE
+  // Only ghost copies are cut, and only on the left
+  if (fb_x + size.w - left_cut > target->width || fb_y < 0 ||
+      fb_y + size.h > target->height) {
+    harness_flag_draw("blit past the edge", fb_x, fb_y);
+  }
+#endif
+  if (left_cut >= size.w || fb_x >= target->width) {
+    return;
+  }
+  uint32_t clip = top_bits(size.w) << left_cut;
+  clip &= top_bits(target->width - fb_x);
+
+  const int row_start = fb_y < 0 ? -fb_y : 0;
+  const int row_end = fb_y + size.h > target->height ? target->height - fb_y
+                                                     : size.h;
+#ifdef FRAME_STATS_ENABLED
+  frame_stats_rect((GRect){.origin = {fb_x, fb_y + row_start},
+                           .size = {size.w - left_cut, row_end - row_start}});
+#endif
+  // Palettized formats keep the leftmost pixel in the top bit
+  const uint32_t invert = ink_index == 0 ? 0xFFFFFFFFU : 0;
+  for (int row = row_start; row < row_end; row++) {
+    const uint8_t *src_row = src + (row * src_stride);
+    uint64_t run = 0;
+    for (int b = 0; b < 5; b++) {
+      run = (run << 8) | (b < src_bytes ? src_row[b] : 0);
+    }
+    uint32_t bits = (uint32_t)(run >> (8 - src_shift));
+    bits = ((bits ^ invert) << left_cut) & clip;
+    if (bits) {
+      write_row_bits(target, fb_x, fb_y + row, bits, color);
+    }
+  }
+}
+
+void framebuffer_draw_comb(FramebufferTarget *target, int x, int y, int h,
+                           int count, int pitch, GColor color) {
+  const int fb_y = target->origin.y + y;
+  const int row_start = fb_y < 0 ? 0 : fb_y;
+  const int row_end = fb_y + h > target->height ? target->height : fb_y + h;
+  int first = target->origin.x + x;
+  int last = first + ((count - 1) * pitch);
+#ifdef SWEEP_MODE
+  if (first < 0 || last >= target->width || fb_y < 0 ||
+      fb_y + h > target->height) {
+    harness_flag_draw("comb past the edge", first, fb_y);
+  }
+#endif
+  while (count > 0 && first < 0) {
+    first += pitch;
+    count--;
+  }
+  while (count > 0 && last >= target->width) {
+    last -= pitch;
+    count--;
+  }
+  if (count <= 0 || row_start >= row_end) {
+    return;
+  }
+#ifdef FRAME_STATS_ENABLED
+  frame_stats_rect((GRect){.origin = {first, row_start},
+                           .size = {last - first + 1, row_end - row_start}});
+#endif
+
+  // Build the first row, then stamp it onto the rest a row at a time
+#ifdef PBL_COLOR
+  uint8_t *first_row = target->data + (row_start * target->stride);
+  for (int px = first; px <= last; px += pitch) {
+    first_row[px] = color.argb;
+  }
+  // The comb owns its rectangle, so copying the gaps between lines is fine
+  for (int row = row_start + 1; row < row_end; row++) {
+    memcpy(target->data + (row * target->stride) + first, first_row + first,
+           last - first + 1);
+  }
+#else
+  uint8_t comb_bits[MAX_COMB_ROW_BYTES] = {0};
+  for (int px = first; px <= last; px += pitch) {
+    comb_bits[px >> 3] |= 1 << (px & 7);
+  }
+  const bool is_white = gcolor_equal(color, GColorWhite);
+  for (int row = row_start; row < row_end; row++) {
+    uint8_t *dst = target->data + (row * target->stride);
+    for (int b = first >> 3; b <= last >> 3; b++) {
+      dst[b] = is_white ? (dst[b] | comb_bits[b]) : (dst[b] & ~comb_bits[b]);
+    }
+  }
+#endif
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "common.h"
+
+// Each platform gets exactly one blitter, picked at compile time:
+// 8-bit (one GColor8 per pixel) on color, packed 1-bit on black and white
+#ifdef PBL_COLOR
+#define FRAMEBUFFER_FORMAT GBitmapFormat8Bit
+#else
+#define FRAMEBUFFER_FORMAT GBitmapFormat1Bit
+#endif
+
+// A captured framebuffer (or an offscreen bitmap laid out like one), plus
+// where the layer being drawn sits inside it.
+// Coordinates passed to the blitters are layer-relative, like graphics_*
+typedef struct FramebufferTarget {
+  GBitmap *bmp;
+  uint8_t *data;
+  int stride;
+  int width;
+  int height;
+  GPoint origin;
+} FramebufferTarget;
+
+// Fails (and leaves the framebuffer released) when the platform's framebuffer
+// isn't in the format the blitters were compiled for
+bool framebuffer_begin(GContext *ctx, GPoint origin, FramebufferTarget *target);
+void framebuffer_end(GContext *ctx, FramebufferTarget *target);
+
+// Draws into bmp instead, which must be FRAMEBUFFER_FORMAT; the SDK has no
+// offscreen GContext, so this is the only way to draw a row ahead of time.
+// There's nothing to end afterwards
+bool framebuffer_begin_bitmap(GBitmap *bmp, FramebufferTarget *target);
+
+// Fills the whole target, whatever its origin
+void framebuffer_clear(FramebufferTarget *target, GColor color);
+
+// Writes color wherever the 1-bit palettized bmp (at most 32px wide, and may
+// be a sub-bitmap) holds palette index ink_index; other pixels are left alone
+void framebuffer_blit_1bit(FramebufferTarget *target, const GBitmap *bmp,
+                           int x, int y, int ink_index, GColor color);
+
+// count vertical lines, h pixels tall and pitch pixels apart, starting at x
+void framebuffer_draw_comb(FramebufferTarget *target, int x, int y, int h,
+                           int count, int pitch, GColor color);
@@ -0,0 +1,180 @@
+// Demand-loaded glyph pages; see glyphcache.h
+
+#include "glyphcache.h"
+
+#include "memstats.h"
+
+#define GLYPH_BIG_CELL_W_PX 32
+#define GLYPH_SMALL_CELL_W_PX 16
+
+// Which modes draw from a page
+#define GLYPH_MODE_DECIMAL (1 << 0)
+#define GLYPH_MODE_HEX (1 << 1)
+
+typedef struct GlyphPage {
+  uint32_t resource_id;
+  bool is_small;
+  uint8_t first; // Glyph value of the page's first cell
+  uint8_t count;
+  uint8_t modes;
+} GlyphPage;
+
+// Must match PAGES in tools/glyph_atlas.py
+static const GlyphPage PAGES[] = {
+    {RESOURCE_ID_GLYPH_PAGE_BIG_DIGITS, false, 0, 10,
+     GLYPH_MODE_DECIMAL | GLYPH_MODE_HEX},
+    {RESOURCE_ID_GLYPH_PAGE_BIG_HEX, false, 10, 6, GLYPH_MODE_HEX},
+    {RESOURCE_ID_GLYPH_PAGE_SMALL_DIGITS, true, 0, 10,
+     GLYPH_MODE_DECIMAL | GLYPH_MODE_HEX},
+    // Decimal mode spells WE, FR and SA with the small E, F and A
+    {RESOURCE_ID_GLYPH_PAGE_SMALL_HEX, true, 10, 6,
+     GLYPH_MODE_DECIMAL | GLYPH_MODE_HEX},
+    // Only decimal mode spells out the day of the week
+    {RESOURCE_ID_GLYPH_PAGE_SMALL_LETTERS, true, 16, 8, GLYPH_MODE_DECIMAL},
+};
+#define PAGE_COUNT (int)(sizeof(PAGES) / sizeof(GlyphPage))
+
+static GBitmap *page_bmps[PAGE_COUNT];
+// Sub-bitmaps of page_bmps, so NULL whenever their page isn't loaded
+static GBitmap *big_glyphs[GLYPH_BIG_COUNT];
+static GBitmap *small_glyphs[GLYPH_SMALL_COUNT];
+static GColor *glyph_palette;
+static GlyphEvictHandler handle_evict;
+static uint8_t current_mode = GLYPH_MODE_DECIMAL;
+
+GBitmap *glyph_bitmap_create_with_resource(uint32_t resource_id) {
+  GBitmap *bmp = gbitmap_create_with_resource(resource_id);
+  if (!bmp) {
+    return NULL;
+  }
+  if (gbitmap_get_format(bmp) != GBitmapFormat1BitPalette) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Resource %d not 1BitPalette",
+            (int)resource_id);
+    gbitmap_destroy(bmp);
+    return NULL;
+  }
+  GColor *palette = gbitmap_get_palette(bmp);
+  if (!gcolor_equal(palette[0], GColorBlack)) {
+    const int bytes = gbitmap_get_bytes_per_row(bmp) *
+                      gbitmap_get_bounds(bmp).size.h;
+    uint8_t *data = gbitmap_get_data(bmp);
+    for (int i = 0; i < bytes; i++) {
+      data[i] = ~data[i];
+    }
+    palette[1] = palette[0];
+    palette[0] = GColorBlack;
+  }
+  return bmp;
+}
+
+static GBitmap **glyph_slot(bool is_small, int value) {
+  return is_small ? &small_glyphs[value] : &big_glyphs[value];
+}
+
+static int page_of(int value, bool is_small) {
+  for (int p = 0; p < PAGE_COUNT; p++) {
+    if (PAGES[p].is_small == is_small && value >= PAGES[p].first &&
+        value < PAGES[p].first + PAGES[p].count) {
+      return p;
+    }
+  }
+  return -1;
+}
+
+static void unload_page(int p) {
+  if (!page_bmps[p]) {
+    return;
+  }
+  const GlyphPage *page = &PAGES[p];
+  handle_evict(page->is_small, page->first, page->count);
+  for (int i = page->first; i < page->first + page->count; i++) {
+    GBitmap **glyph = glyph_slot(page->is_small, i);
+    if (*glyph) {
+      gbitmap_destroy(*glyph);
+      *glyph = NULL;
+    }
+  }
+  gbitmap_destroy(page_bmps[p]);
+  page_bmps[p] = NULL;
+  VERBOSE_LOG("Dropped glyph page %d", p);
+}
+
+// Drops the loaded pages the current mode doesn't draw from
+static bool unload_unused_pages(void) {
+  bool is_any_unloaded = false;
+  for (int p = 0; p < PAGE_COUNT; p++) {
+    if (page_bmps[p] && !(PAGES[p].modes & current_mode)) {
+      unload_page(p);
+      is_any_unloaded = true;
+    }
+  }
+  return is_any_unloaded;
+}
+
+static bool load_page(int p) {
+  const GlyphPage *page = &PAGES[p];
+  GBitmap *bmp = glyph_bitmap_create_with_resource(page->resource_id);
+  if (!bmp && unload_unused_pages()) {
+    bmp = glyph_bitmap_create_with_resource(page->resource_id);
+  }
+  if (!bmp) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "No heap for glyph page %d", p);
+    return false;
+  }
+  const int cell_w =
+      page->is_small ? GLYPH_SMALL_CELL_W_PX : GLYPH_BIG_CELL_W_PX;
+  const GSize size = page->is_small ? GSize(GLYPH_SMALL_W_PX, GLYPH_SMALL_H_PX)
+                                    : GSize(GLYPH_BIG_W_PX, GLYPH_BIG_H_PX);
+  for (int i = 0; i < page->count; i++) {
+    GBitmap *glyph = gbitmap_create_as_sub_bitmap(
+        bmp, (GRect){.origin = {i * cell_w, 0}, .size = size});
+    if (glyph) {
+      gbitmap_set_palette(glyph, glyph_palette, false);
+    }
+    *glyph_slot(page->is_small, page->first + i) = glyph;
+  }
+  page_bmps[p] = bmp;
+  MEMSTATS_SAMPLE("glyph_page");
+  VERBOSE_LOG("Loaded glyph page %d", p);
+  return true;
+}
+
+void glyph_cache_init(GColor *palette, GlyphEvictHandler evict_handler) {
+  glyph_palette = palette;
+  handle_evict = evict_handler;
+}
+
+void glyph_cache_deinit(void) { glyph_cache_trim(); }
+
+void glyph_cache_set_hex_mode(bool is_hex) {
+  current_mode = is_hex ? GLYPH_MODE_HEX : GLYPH_MODE_DECIMAL;
+  unload_unused_pages();
+}
+
+GBitmap *glyph_cache_get(int value, bool is_small) {
+  GBitmap *glyph = *glyph_slot(is_small, value);
+  if (glyph) {
+    return glyph;
+  }
+  // A loaded page with no glyph here only means its sub-bitmap failed
+  const int p = page_of(value, is_small);
+  if (p < 0 || page_bmps[p] || !load_page(p)) {
+    return NULL;
+  }
+  return *glyph_slot(is_small, value);
+}
+
+bool glyph_cache_warm(void) {
+  for (int p = 0; p < PAGE_COUNT; p++) {
+    if (!page_bmps[p] && (PAGES[p].modes & current_mode)) {
+      return load_page(p);
+    }
+  }
+  return false;
+}
+
+void glyph_cache_trim(void) {
+  for (int p = 0; p < PAGE_COUNT; p++) {
+    unload_page(p);
+  }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+
+// Glyphs live in pages (see PAGES in tools/glyph_atlas.py), each loaded the
+// first time a row draws from it rather than all at launch. A page the mode
+// doesn't draw from is dropped when the mode changes, and any page can be
+// when the heap runs short; idle ticks load the mode's pages ahead of use
+
+#define GLYPH_BIG_COUNT 16   // 0 - F
+#define GLYPH_SMALL_COUNT 24 // 0 - F, then the day-of-week letters
+#define GLYPH_BIG_W_PX 30
+#define GLYPH_BIG_H_PX 45
+#define GLYPH_SMALL_W_PX 12
+#define GLYPH_SMALL_H_PX 18
+
+// Runs before a page's glyphs (values first to first + count - 1) are freed.
+// Glyphs are windows onto their page's pixels, so anything made from one (a
+// tinted sub-bitmap) must be dropped here
+typedef void (*GlyphEvictHandler)(bool is_small, int first, int count);
+
+// Every glyph gets palette, which must outlive the cache; ink is index 0
+void glyph_cache_init(GColor *palette, GlyphEvictHandler evict_handler);
+void glyph_cache_deinit(void);
+
+// Drops the pages the new mode never draws from
+void glyph_cache_set_hex_mode(bool is_hex);
+
+// NULL only when the page can't be loaded, even after dropping the pages
+// the current mode doesn't use
+GBitmap *glyph_cache_get(int value, bool is_small);
+
+// Loads one page the current mode draws from, if any isn't loaded yet;
+// returns whether it did
+bool glyph_cache_warm(void);
+
+// Drops every page, for when the heap runs short. Never while a row is
+// drawing: queued draws may point into the pages
+void glyph_cache_trim(void);
+
+// A 1BitPalette bitmap resource with its ink at palette index 0, whatever
+// order the resource compiler picked
+GBitmap *glyph_bitmap_create_with_resource(uint32_t resource_id);
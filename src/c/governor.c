@@ -0,0 +1,183 @@
+// Power governor: see governor.h. Wrist flicks arrive as accel taps, which
+// the system detects without the app sampling the accelerometer
+
+#include "governor.h"
+
+static bool is_running;
+static PowerTier tier = POWER_TIER_FULL;
+static PowerTierHandler tier_handler;
+static PowerThresholds thresholds;
+static int battery_percent = 100;
+static bool is_charging;
+static bool is_sleeping;
+static AppTimer *burst_timer;
+
+// The settings sliders' step
+#define THRESHOLD_STEP_PERCENT 5
+
+void governor_clamp_thresholds(PowerThresholds *thresholds) {
+  const int low = thresholds->low_battery_percent;
+  if (thresholds->critical_battery_percent >= low) {
+    thresholds->critical_battery_percent =
+        low > THRESHOLD_STEP_PERCENT ? low - THRESHOLD_STEP_PERCENT : 0;
+  }
+}
+
+static PowerTier pick_tier(void) {
+  if (is_charging || burst_timer) {
+    return POWER_TIER_FULL;
+  }
+  if (is_sleeping || battery_percent <= thresholds.critical_battery_percent) {
+    return POWER_TIER_STATIC;
+  }
+  if (battery_percent <= thresholds.low_battery_percent) {
+    return POWER_TIER_REDUCED;
+  }
+  return POWER_TIER_FULL;
+}
+
+static void update_tier(void) {
+  const PowerTier new_tier = is_running ? pick_tier() : POWER_TIER_FULL;
+  if (new_tier == tier) {
+    return;
+  }
+  VERBOSE_LOG("Power tier %d -> %d", (int)tier, (int)new_tier);
+  tier = new_tier;
+  if (tier_handler) {
+    tier_handler(tier);
+  }
+}
+
+static void burst_timer_callback(void *context) {
+  burst_timer = NULL;
+  update_tier();
+}
+
+static void handle_tap(AccelAxisType axis, int32_t direction) {
+  TRACE_EVENT(tap, axis);
+  if (thresholds.burst_seconds == 0) {
+    return;
+  }
+  if (burst_timer) {
+    app_timer_reschedule(burst_timer, thresholds.burst_seconds * 1000);
+  } else {
+    burst_timer = app_timer_register(thresholds.burst_seconds * 1000,
+                                     burst_timer_callback, NULL);
+  }
+  update_tier();
+}
+
+#if defined(PBL_HEALTH)
+static void refresh_sleep(void) {
+  is_sleeping = health_service_peek_current_activities() &
+                (HealthActivitySleep | HealthActivityRestfulSleep);
+}
+
+static void handle_health(HealthEventType event, void *context) {
+  if (event == HealthEventSleepUpdate ||
+      event == HealthEventSignificantUpdate) {
+    refresh_sleep();
+    update_tier();
+  }
+}
+#endif
+
+void governor_start(const PowerThresholds *new_thresholds,
+                    PowerTierHandler handler) {
+  thresholds = *new_thresholds;
+  governor_clamp_thresholds(&thresholds);
+  tier_handler = handler;
+  if (!is_running) {
+    is_running = true;
+    accel_tap_service_subscribe(handle_tap);
+#if defined(PBL_HEALTH)
+    health_service_events_subscribe(handle_health, NULL);
+    refresh_sleep();
+#endif
+  }
+  update_tier();
+}
+
+void governor_stop(void) {
+  if (!is_running) {
+    return;
+  }
+  is_running = false;
+  accel_tap_service_unsubscribe();
+#if defined(PBL_HEALTH)
+  health_service_events_unsubscribe();
+  is_sleeping = false;
+#endif
+  if (burst_timer) {
+    app_timer_cancel(burst_timer);
+    burst_timer = NULL;
+  }
+  tier = POWER_TIER_FULL;
+}
+
+void governor_set_thresholds(const PowerThresholds *new_thresholds) {
+  thresholds = *new_thresholds;
+  governor_clamp_thresholds(&thresholds);
+  update_tier();
+}
+
+void governor_set_battery(int percent, bool charging) {
+  battery_percent = percent;
+  is_charging = charging;
+  update_tier();
+}
+
+PowerTier governor_tier(void) { return tier; }
+
+// Over budget steps down at once. Stepping back up waits until no frame that
+// drew trails has come within half the budget for the hold; each step up that
+// is soon over budget again doubles the hold, so the quality doesn't flap
+#define QUALITY_HOLD_FIRST_MS (60 * 1000)
+#define QUALITY_HOLD_MAX_MS (32 * 60 * 1000)
+
+static RenderQuality quality = RENDER_QUALITY_FULL;
+static uint32_t hold_ms = QUALITY_HOLD_FIRST_MS;
+static uint32_t calm_since_ms;
+// The last change was a step up that hasn't yet lasted a whole hold
+static bool is_probing;
+
+bool governor_frame_drawn(uint32_t now_ms, bool is_ghosted, uint32_t frame_ms,
+                          uint32_t budget_ms) {
+  if (is_ghosted && frame_ms > budget_ms) {
+    calm_since_ms = now_ms;
+    if (is_probing) {
+      hold_ms = hold_ms * 2 > QUALITY_HOLD_MAX_MS ? QUALITY_HOLD_MAX_MS
+                                                  : hold_ms * 2;
+      is_probing = false;
+    }
+    if (quality + 1 < RENDER_QUALITY_COUNT) {
+      quality++;
+      VERBOSE_LOG("Frame took %dms, quality down to %d", (int)frame_ms,
+                  (int)quality);
+      return true;
+    }
+    return false;
+  }
+  if (is_ghosted && frame_ms * 2 > budget_ms) {
+    calm_since_ms = now_ms;
+    return false;
+  }
+  if (now_ms - calm_since_ms < hold_ms) {
+    return false;
+  }
+  // A whole hold has gone by, so the last step up held
+  if (is_probing) {
+    hold_ms = QUALITY_HOLD_FIRST_MS;
+    is_probing = false;
+  }
+  if (quality == RENDER_QUALITY_FULL) {
+    return false;
+  }
+  is_probing = true;
+  calm_since_ms = now_ms;
+  quality--;
+  VERBOSE_LOG("Quality up to %d", (int)quality);
+  return true;
+}
+
+RenderQuality governor_quality(void) { return quality; }
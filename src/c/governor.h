@@ -0,0 +1,52 @@
+#pragma once
+
+#include "common.h"
+
+// Picks how much the face draws from battery, charging, wrist flicks and
+// (where there's Health) sleep, for the PowerGovernor setting; and how
+// detailed ghost trails are, from how long frames take to draw
+
+typedef enum PowerTier {
+  POWER_TIER_FULL,    // Everything the settings ask for
+  POWER_TIER_REDUCED, // No ghosts; the seconds comb moves every 15 seconds
+  POWER_TIER_STATIC,  // No ghosts and no seconds comb; minute ticks only
+} PowerTier;
+
+typedef struct PowerThresholds {
+  uint8_t low_battery_percent;      // At or below: POWER_TIER_REDUCED
+  uint8_t critical_battery_percent; // At or below: POWER_TIER_STATIC
+  uint8_t burst_seconds;            // POWER_TIER_FULL after a wrist flick
+} PowerThresholds;
+
+// Keeps critical_battery_percent a settings slider step (5%) below
+// low_battery_percent, or at 0, so POWER_TIER_REDUCED always has a range of
+// its own. The governor applies this to whatever thresholds it is given
+void governor_clamp_thresholds(PowerThresholds *thresholds);
+
+// Called whenever the tier changes, with the new one
+typedef void (*PowerTierHandler)(PowerTier tier);
+
+// Subscribes to taps (and Health); the tier is POWER_TIER_FULL until started
+void governor_start(const PowerThresholds *thresholds, PowerTierHandler handler);
+// Back to POWER_TIER_FULL, without calling the handler
+void governor_stop(void);
+void governor_set_thresholds(const PowerThresholds *thresholds);
+void governor_set_battery(int percent, bool is_charging);
+PowerTier governor_tier(void);
+
+// Steps from most to least detailed ghost trails
+typedef enum RenderQuality {
+  RENDER_QUALITY_FULL,
+  RENDER_QUALITY_LIGHT_SMEARS, // The lighter smear masks, half the noise
+  RENDER_QUALITY_SHORT_TRAILS, // ... at most 2 ghost copies per row, a
+                               // quarter of the noise
+  RENDER_QUALITY_MINIMAL,      // ... at most 1, and no noise
+  RENDER_QUALITY_COUNT
+} RenderQuality;
+
+// Feeds back every frame, as it ends at now_ms: whether it drew a ghost trail
+// and, if so, how long it took against its budget. Returns whether that moved
+// the quality
+bool governor_frame_drawn(uint32_t now_ms, bool is_ghosted, uint32_t frame_ms,
+                          uint32_t budget_ms);
+RenderQuality governor_quality(void);
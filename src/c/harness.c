@@ -0,0 +1,490 @@
+// Render harness: drives the real layer update code through every settings
+// combination at a few representative times and logs what each frame costs.
+// With SWEEP_MODE it instead logs a hash of every row, at enough times to show
+// every value each row has (and a few random ones besides), and with
+// SCREENSHOT_MODE it holds each store-page preset on screen in turn. Only
+// built with BENCHMARK_MODE; see common.h
+
+#include "harness.h"
+
+#ifdef PBL_HOST
+#include "pebble_host.h"
+#endif
+
+#ifdef BENCHMARK_MODE
+
+// Every setting but AnimateTransitions, whose slides only run on real ticks
+#define HARNESS_SETTINGS_COMBINATIONS 128
+#define HARNESS_CLOCK_STYLES 2            // 12h, 24h
+#if defined(SWEEP_MODE) || defined(SCREENSHOT_MODE)
+#define HARNESS_FRAMES_PER_CASE 1
+#else
+#define HARNESS_FRAMES_PER_CASE 8
+#endif
+#define HARNESS_FRAME_INTERVAL_MS 25
+// Long enough for `pebble screenshot` to grab the frame after its SHOT line
+#define HARNESS_SHOT_HOLD_MS 5000
+
+#ifdef DIRECT_FRAMEBUFFER_RENDERING
+#define HARNESS_RENDER_PATH "framebuffer"
+#else
+#define HARNESS_RENDER_PATH "sdk"
+#endif
+
+#if defined(SCREENSHOT_MODE)
+// The time every store-page shot is taken at
+static const struct tm HARNESS_TIMES[] = {
+    {.tm_hour = 10, .tm_min = 42, .tm_sec = 37, .tm_mday = 27, .tm_mon = 9,
+     .tm_wday = 5},
+};
+
+typedef struct HarnessShot {
+  // The store-page PNG it stands in for, less the _pt (basalt) or _pt2
+  // (emery) suffix of the color ones; see tools/screenshots.py
+  const char *name;
+  uint8_t settings_bits;
+} HarnessShot;
+
+// Settings bits as in watchface.c's SettingsBit: 0x1A is PowerMode and both
+// ghost trails, 0x01 adds HexMode and 0x04 ColorizeDigits
+static const HarnessShot HARNESS_SHOTS[] = {
+#ifdef PBL_COLOR
+    {"color_normal", 0x1E},
+    {"color_hex", 0x1F},
+#else
+    {"bw_normal", 0x1A},
+    {"bw_hex", 0x1B},
+#endif
+};
+#define HARNESS_SHOT_COUNT (int)(sizeof(HARNESS_SHOTS) / sizeof(HarnessShot))
+#define HARNESS_TIME_COUNT (int)(sizeof(HARNESS_TIMES) / sizeof(struct tm))
+#elif defined(SWEEP_MODE)
+// If each row's pixels depend only on its own value (and the settings), 60
+// times that between them show every minute, hour, second, weekday, month
+// and day of the month cover every frame a year of minutes could draw. The
+// random times after them are what check that premise: tools/sweep.py
+// expects each of their rows to hash as the same value did among the 60
+#define HARNESS_SWEEP_VALUE_TIMES 60
+#define HARNESS_SWEEP_RANDOM_TIMES 16
+#define HARNESS_TIME_COUNT                                                     \
+  (HARNESS_SWEEP_VALUE_TIMES + HARNESS_SWEEP_RANDOM_TIMES)
+#define HARNESS_SWEEP_RANDOM_SEED 0x5EED2026u
+#define HARNESS_SWEEP_MAX_ROWS 8
+#define HARNESS_SWEEP_LOGGED_FLAGS 16
+#else
+// Month/day values are picked so each date row hits both single and double
+// wide glyphs somewhere in the set
+static const struct tm HARNESS_TIMES[] = {
+    // Everything at the left edge: longest ghost trails are on the right rows
+    {.tm_hour = 0, .tm_min = 0, .tm_sec = 0, .tm_mday = 1, .tm_mon = 0,
+     .tm_wday = 0},
+    {.tm_hour = 9, .tm_min = 41, .tm_sec = 7, .tm_mday = 9, .tm_mon = 8,
+     .tm_wday = 2},
+    {.tm_hour = 12, .tm_min = 34, .tm_sec = 30, .tm_mday = 17, .tm_mon = 9,
+     .tm_wday = 5},
+    // Everything at the right edge: longest trails and a full seconds comb
+    {.tm_hour = 23, .tm_min = 59, .tm_sec = 59, .tm_mday = 31, .tm_mon = 11,
+     .tm_wday = 6},
+};
+#define HARNESS_TIME_COUNT (int)(sizeof(HARNESS_TIMES) / sizeof(struct tm))
+#endif
+#ifdef SCREENSHOT_MODE
+#define HARNESS_CASE_COUNT HARNESS_SHOT_COUNT
+#else
+#define HARNESS_CASE_COUNT                                                     \
+  (HARNESS_SETTINGS_COMBINATIONS * HARNESS_TIME_COUNT * HARNESS_CLOCK_STYLES)
+#endif
+
+typedef struct HarnessTally {
+  uint32_t frames;
+  uint64_t total_ns;
+  FrameStats stats;
+} HarnessTally;
+
+// The first frame of a case rebuilds every row (the face starts each case
+// with no row caches); the rest only redraw what a tick would
+typedef struct HarnessCase {
+  HarnessTally cold;
+  HarnessTally warm;
+} HarnessCase;
+
+static HarnessHandlers handlers;
+static AppTimer *frame_timer;
+static int case_idx;
+// One past the last case this run draws; see sweep_case_range()
+static int case_end;
+static struct tm case_time;
+static HarnessCase current;
+static HarnessCase overall;
+static uint64_t frame_start_ns;
+#if !defined(SWEEP_MODE) && !defined(SCREENSHOT_MODE)
+static uint64_t worst_case_ns;
+static int worst_case_idx;
+static uint64_t launch_ns;
+static bool is_launch_logged;
+#endif
+#ifdef SWEEP_MODE
+static int case_flags;
+static int total_flags;
+static int sweep_case_count;
+#endif
+
+// Host builds (host/Makefile) time frames with the monotonic clock, since
+// they take microseconds there; on the watch time_ms() is as fine as it gets
+static uint64_t now_ns(void) {
+#ifdef PBL_HOST
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return ((uint64_t)now.tv_sec * 1000000000) + now.tv_nsec;
+#else
+  time_t seconds;
+  uint16_t millis;
+  time_ms(&seconds, &millis);
+  return (((uint64_t)seconds * 1000) + millis) * 1000000;
+#endif
+}
+
+#ifdef SCREENSHOT_MODE
+static int case_settings_bits(int idx) {
+  return HARNESS_SHOTS[idx].settings_bits;
+}
+
+static int case_time_idx(int idx) { return 0; }
+
+// The store page shows the 12h clock
+static bool case_is_24h(int idx) { return false; }
+#else
+static int case_settings_bits(int idx) {
+  return idx % HARNESS_SETTINGS_COMBINATIONS;
+}
+
+static int case_time_idx(int idx) {
+  return (idx / HARNESS_SETTINGS_COMBINATIONS) % HARNESS_TIME_COUNT;
+}
+
+static bool case_is_24h(int idx) {
+  return idx / (HARNESS_SETTINGS_COMBINATIONS * HARNESS_TIME_COUNT) == 1;
+}
+#endif
+
+#ifdef SWEEP_MODE
+// Numerical Recipes' LCG; the top bits are the random ones
+static int sweep_random(uint32_t *state, int range) {
+  *state = (*state * 1664525u) + 1013904223u;
+  return (int)((*state >> 16) % (uint32_t)range);
+}
+#endif
+
+static struct tm harness_case_time(int time_idx) {
+#ifdef SWEEP_MODE
+  if (time_idx >= HARNESS_SWEEP_VALUE_TIMES) {
+    // Every row drawn at once with values no value time pairs together.
+    // Not always a real date, which the rows don't care about either
+    uint32_t state = HARNESS_SWEEP_RANDOM_SEED + (uint32_t)time_idx;
+    return (struct tm){.tm_hour = sweep_random(&state, 24),
+                       .tm_min = sweep_random(&state, 60),
+                       .tm_sec = sweep_random(&state, 60),
+                       .tm_mday = sweep_random(&state, 31) + 1,
+                       .tm_mon = sweep_random(&state, 12),
+                       .tm_wday = sweep_random(&state, 7)};
+  }
+  return (struct tm){.tm_hour = time_idx % 24,
+                     .tm_min = time_idx,
+                     .tm_sec = time_idx,
+                     .tm_mday = (time_idx % 31) + 1,
+                     .tm_mon = time_idx % 12,
+                     .tm_wday = time_idx % 7};
+#else
+  return HARNESS_TIMES[time_idx];
+#endif
+}
+
+static void load_case(int idx) {
+  case_time = harness_case_time(case_time_idx(idx));
+  current = (HarnessCase){0};
+  handlers.apply_settings(case_settings_bits(idx));
+}
+
+#if !defined(SWEEP_MODE) && !defined(SCREENSHOT_MODE)
+static void tally_add(HarnessTally *tally, const HarnessTally *other) {
+  tally->frames += other->frames;
+  tally->total_ns += other->total_ns;
+  tally->stats.draw_calls += other->stats.draw_calls;
+  tally->stats.state_changes += other->stats.state_changes;
+  tally->stats.pixels_written += other->stats.pixels_written;
+}
+
+static void log_tally(const char *label, const HarnessTally *tally) {
+  if (tally->frames == 0) {
+    return;
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO,
+          "BENCH   %s ns/frame=%d draws/frame=%d state/frame=%d px/frame=%d",
+          label, (int)(tally->total_ns / tally->frames),
+          (int)(tally->stats.draw_calls / tally->frames),
+          (int)(tally->stats.state_changes / tally->frames),
+          (int)(tally->stats.pixels_written / tally->frames));
+}
+
+static void report_case(int idx) {
+  APP_LOG(APP_LOG_LEVEL_INFO, "BENCH settings=0x%02x time=%d 24h=%d",
+          case_settings_bits(idx), case_time_idx(idx), (int)case_is_24h(idx));
+  log_tally("cold", &current.cold);
+  log_tally("warm", &current.warm);
+  if (current.cold.total_ns > worst_case_ns) {
+    worst_case_ns = current.cold.total_ns;
+    worst_case_idx = idx;
+  }
+  tally_add(&overall.cold, &current.cold);
+  tally_add(&overall.warm, &current.warm);
+}
+
+static void log_launch(bool is_snapshot) {
+  if (is_launch_logged) {
+    return;
+  }
+  is_launch_logged = true;
+  APP_LOG(APP_LOG_LEVEL_INFO, "BENCH launch first_frame_ms=%d snapshot=%d",
+          (int)((now_ns() - launch_ns) / 1000000), (int)is_snapshot);
+}
+
+void harness_launch_begin(void) {
+  launch_ns = now_ns();
+  is_launch_logged = false;
+}
+
+void harness_snapshot_frame_end(void) { log_launch(true); }
+
+static void report_summary(void) {
+  APP_LOG(APP_LOG_LEVEL_INFO,
+          "BENCH done cases=%d worst cold frame=0x%02x/%d/%d (%d ns)",
+          HARNESS_CASE_COUNT, case_settings_bits(worst_case_idx),
+          case_time_idx(worst_case_idx), (int)case_is_24h(worst_case_idx),
+          (int)worst_case_ns);
+  log_tally("cold", &overall.cold);
+  log_tally("warm", &overall.warm);
+}
+#endif
+
+#ifdef SWEEP_MODE
+// FNV-1a over the row's pixels, one display width of bytes per line
+static uint32_t hash_row(GBitmap *fb, GRect frame) {
+  const int stride = gbitmap_get_bytes_per_row(fb);
+  const int width_bytes = gbitmap_get_format(fb) == GBitmapFormat1Bit
+                              ? (PBL_DISPLAY_WIDTH + 7) / 8
+                              : PBL_DISPLAY_WIDTH;
+  const uint8_t *data = gbitmap_get_data(fb);
+  uint32_t hash = 2166136261u;
+  for (int y = frame.origin.y; y < frame.origin.y + frame.size.h; y++) {
+    const uint8_t *line = data + (y * stride);
+    for (int x = 0; x < width_bytes; x++) {
+      hash = (hash ^ line[x]) * 16777619u;
+    }
+  }
+  return hash;
+}
+
+static int sweep_row_count(void) {
+  return handlers.row_count < HARNESS_SWEEP_MAX_ROWS ? handlers.row_count
+                                                     : HARNESS_SWEEP_MAX_ROWS;
+}
+
+// One hash per row, each followed by a space
+static void format_sweep_hashes(GContext *ctx, char *out, size_t size) {
+  out[0] = '\0';
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "SWEEP no framebuffer");
+    return;
+  }
+  size_t len = 0;
+  for (int i = 0; i < sweep_row_count(); i++) {
+    GRect frame;
+    handlers.row_frame(i, &frame);
+    len += snprintf(out + len, size - len, "%08lx ",
+                    (unsigned long)hash_row(fb, frame));
+  }
+  graphics_release_frame_buffer(ctx, fb);
+}
+
+static void report_sweep_frame(GContext *ctx, int idx) {
+  char hashes[(HARNESS_SWEEP_MAX_ROWS * 9) + 1];
+  format_sweep_hashes(ctx, hashes, sizeof(hashes));
+  // Random times say what they were, for tools/sweep.py to match each row
+  // to its value time
+  char at[32] = "";
+  if (case_time_idx(idx) >= HARNESS_SWEEP_VALUE_TIMES) {
+    snprintf(at, sizeof(at), "at=%d:%d:%d,%d,%d,%d ", case_time.tm_hour,
+             case_time.tm_min, case_time.tm_sec, case_time.tm_wday,
+             case_time.tm_mon, case_time.tm_mday);
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "SWEEP s=0x%02x t=%d 24h=%d %s%sflags=%d",
+          case_settings_bits(idx), case_time_idx(idx), (int)case_is_24h(idx),
+          at, hashes, case_flags);
+  total_flags += case_flags;
+  case_flags = 0;
+}
+
+void harness_flag_draw(const char *what, int x, int y) {
+  if (case_idx >= case_end) {
+    return;
+  }
+  if (total_flags + case_flags < HARNESS_SWEEP_LOGGED_FLAGS) {
+    APP_LOG(APP_LOG_LEVEL_WARNING,
+            "SWEEP flag s=0x%02x t=%d 24h=%d %s at %d,%d",
+            case_settings_bits(case_idx), case_time_idx(case_idx),
+            (int)case_is_24h(case_idx), what, x, y);
+  }
+  case_flags++;
+}
+#endif
+
+static void frame_timer_callback(void *context) {
+  frame_timer = NULL;
+  handlers.redraw();
+}
+
+#if defined(SCREENSHOT_MODE) && defined(PBL_HOST)
+// There's no emulator to grab the screen, so the host writes it out itself,
+// into HOST_SCREENSHOT_DIR (or the working directory)
+static void save_host_shot(const char *name) {
+  const char *dir = getenv("HOST_SCREENSHOT_DIR");
+  char path[256];
+  snprintf(path, sizeof(path), "%s/%s.png", dir ? dir : ".", name);
+  if (!host_write_png(path)) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "SHOT couldn't write %s", path);
+  }
+}
+#endif
+
+#ifdef SCREENSHOT_MODE
+// Only once the last shot has had its hold; loading the case redraws nothing
+static void next_shot_timer_callback(void *context) {
+  load_case(case_idx);
+  frame_timer_callback(context);
+}
+#endif
+
+#ifdef SWEEP_MODE
+// The cases this run draws: all of them, or on the host just the slice
+// HOST_SWEEP_SLICE names, like 3/16 for the fourth of sixteen, so
+// tools/sweep.py can split a platform's cases across processes
+static void sweep_case_range(void) {
+#ifdef PBL_HOST
+  const char *slice = getenv("HOST_SWEEP_SLICE");
+  int idx;
+  int count;
+  if (slice && sscanf(slice, "%d/%d", &idx, &count) == 2 && idx >= 0 &&
+      idx < count) {
+    case_idx = HARNESS_CASE_COUNT * idx / count;
+    case_end = HARNESS_CASE_COUNT * (idx + 1) / count;
+  }
+#endif
+}
+#endif
+
+void harness_start(HarnessHandlers new_handlers) {
+  handlers = new_handlers;
+  case_idx = 0;
+  case_end = HARNESS_CASE_COUNT;
+  overall = (HarnessCase){0};
+#if defined(SCREENSHOT_MODE)
+  APP_LOG(APP_LOG_LEVEL_INFO, "SHOT start shots=%d path=%s",
+          HARNESS_CASE_COUNT, HARNESS_RENDER_PATH);
+#elif defined(SWEEP_MODE)
+  case_flags = 0;
+  total_flags = 0;
+  sweep_case_range();
+  sweep_case_count = case_end - case_idx;
+  if (handlers.row_count > HARNESS_SWEEP_MAX_ROWS) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "SWEEP only hashes the first %d of %d rows",
+            HARNESS_SWEEP_MAX_ROWS, handlers.row_count);
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO,
+          "SWEEP start cases=%d rows=%d value_times=%d path=%s",
+          sweep_case_count, sweep_row_count(), HARNESS_SWEEP_VALUE_TIMES,
+          HARNESS_RENDER_PATH);
+#else
+  worst_case_ns = 0;
+  APP_LOG(APP_LOG_LEVEL_INFO, "BENCH start cases=%d frames/case=%d path=%s",
+          HARNESS_CASE_COUNT, HARNESS_FRAMES_PER_CASE, HARNESS_RENDER_PATH);
+#endif
+  load_case(case_idx);
+#ifdef SCREENSHOT_MODE
+  // The launch frame is the first shot; a redraw on top of it would be taken
+  // for the second
+#else
+  frame_timer = app_timer_register(HARNESS_FRAME_INTERVAL_MS,
+                                   frame_timer_callback, NULL);
+#endif
+}
+
+void harness_stop(void) {
+  if (frame_timer) {
+    app_timer_cancel(frame_timer);
+    frame_timer = NULL;
+  }
+}
+
+struct tm *harness_time(void) { return &case_time; }
+
+bool harness_is_24h_style(void) { return case_is_24h(case_idx); }
+
+void harness_frame_begin(void) {
+  frame_stats = (FrameStats){0};
+  frame_start_ns = now_ns();
+}
+
+void harness_frame_end(GContext *ctx) {
+  if (case_idx >= case_end) {
+    return; // Stray redraw after the run finished
+  }
+#if defined(SCREENSHOT_MODE)
+  // Logged once the frame is drawn; it reaches the screen as this returns
+  APP_LOG(APP_LOG_LEVEL_INFO, "SHOT name=%s hold_ms=%d",
+          HARNESS_SHOTS[case_idx].name, HARNESS_SHOT_HOLD_MS);
+#ifdef PBL_HOST
+  save_host_shot(HARNESS_SHOTS[case_idx].name);
+#endif
+  case_idx++;
+  if (case_idx >= case_end) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "SHOT done shots=%d", HARNESS_CASE_COUNT);
+    return;
+  }
+  frame_timer =
+      app_timer_register(HARNESS_SHOT_HOLD_MS, next_shot_timer_callback, NULL);
+  return;
+#elif defined(SWEEP_MODE)
+  report_sweep_frame(ctx, case_idx);
+  case_idx++;
+  if (case_idx >= case_end) {
+    APP_LOG(APP_LOG_LEVEL_INFO, "SWEEP done cases=%d flags=%d",
+            sweep_case_count, total_flags);
+    return;
+  }
+  load_case(case_idx);
+#else
+  log_launch(false);
+  HarnessTally *tally =
+      current.cold.frames == 0 ? &current.cold : &current.warm;
+  tally->total_ns += now_ns() - frame_start_ns;
+  tally->frames++;
+  tally->stats.draw_calls += frame_stats.draw_calls;
+  tally->stats.state_changes += frame_stats.state_changes;
+  tally->stats.pixels_written += frame_stats.pixels_written;
+
+  if (current.cold.frames + current.warm.frames >= HARNESS_FRAMES_PER_CASE) {
+    report_case(case_idx);
+    case_idx++;
+    if (case_idx >= case_end) {
+      report_summary();
+      return;
+    }
+    load_case(case_idx);
+  }
+#endif
+  frame_timer = app_timer_register(HARNESS_FRAME_INTERVAL_MS,
+                                   frame_timer_callback, NULL);
+}
+
+#endif
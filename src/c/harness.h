@@ -0,0 +1,43 @@
+#pragma once
+
+#include "common.h"
+
+#ifdef BENCHMARK_MODE
+
+typedef struct HarnessHandlers {
+  // Packed like MESSAGE_KEY_SettingsBits (see SettingsBit in watchface.c)
+  void (*apply_settings)(uint8_t settings_bits);
+  // Must end up calling harness_frame_begin()/harness_frame_end() around
+  // the drawing it schedules
+  void (*redraw)(void);
+#ifdef SWEEP_MODE
+  // Screen area of each row the sweep hashes, top to bottom
+  int row_count;
+  void (*row_frame)(int row, GRect *frame);
+#endif
+} HarnessHandlers;
+
+void harness_start(HarnessHandlers handlers);
+void harness_stop(void);
+
+// Stand-ins for localtime()/clock_is_24h_style() while the harness runs
+struct tm *harness_time(void);
+bool harness_is_24h_style(void);
+
+#if !defined(SWEEP_MODE) && !defined(SCREENSHOT_MODE)
+// Call first thing in init(); the harness logs how long the launch took to
+// its first frame, whether the harness drew that frame or a snapshot did
+void harness_launch_begin(void);
+void harness_snapshot_frame_end(void);
+#endif
+
+void harness_frame_begin(void);
+// Called after everything else has drawn, with the frame still in ctx
+void harness_frame_end(GContext *ctx);
+
+#ifdef SWEEP_MODE
+// Records a draw that lands somewhere it never should; what says which
+void harness_flag_draw(const char *what, int x, int y);
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <stdint.h>
+
+// Where a row's display value is drawn and what it's drawn with, for every
+// value the row can show. The tables themselves are generated at build time
+// by tools/layout_tables.py, into layout_tables.auto.h
+
+#define ROW_GLYPH_NONE 0xFF
+
+typedef struct RowLayout {
+  uint8_t x;          // Left edge of the display value
+  uint8_t glyphs[2];  // Atlas cells, left to right; glyphs[1] may be NONE
+  uint8_t ghost_step; // Each ghost copy sits this far left of the last one
+} RowLayout;
+
+// Where the rows go when Timeline Quick View leaves the face less height
+typedef struct RowReflow {
+  uint8_t top;       // Where the first row starts
+  uint8_t padding;   // Below each row
+  uint8_t row_count; // Shown from the top down; the rest are hidden
+} RowReflow;
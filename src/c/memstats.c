@@ -0,0 +1,33 @@
+// Heap accounting, only built with MEMORY_REPORT; see common.h
+
+#include "memstats.h"
+
+#ifdef MEMORY_REPORT
+
+static size_t phase_start_used;
+static size_t high_water_used;
+
+void memstats_phase_begin(void) { phase_start_used = heap_bytes_used(); }
+
+void memstats_phase_end(const char *phase) {
+  const size_t used = heap_bytes_used();
+  APP_LOG(APP_LOG_LEVEL_INFO, "MEM phase=%s bytes=%d used=%d free=%d", phase,
+          (int)used - (int)phase_start_used, (int)used,
+          (int)heap_bytes_free());
+  if (used > high_water_used) {
+    high_water_used = used;
+  }
+}
+
+void memstats_sample(const char *where) {
+  const size_t used = heap_bytes_used();
+  if (used <= high_water_used) {
+    return;
+  }
+  // Only logged when it moves, so a steady face stays quiet
+  high_water_used = used;
+  APP_LOG(APP_LOG_LEVEL_INFO, "MEM high-water=%d free=%d at=%s", (int)used,
+          (int)heap_bytes_free(), where);
+}
+
+#endif
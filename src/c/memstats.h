@@ -0,0 +1,24 @@
+#pragma once
+
+#include "common.h"
+
+#ifdef MEMORY_REPORT
+
+// Heap accounting for MEMORY_REPORT; see common.h. Every line logged starts
+// with MEM so a run can be grepped out of the emulator logs
+
+// Brackets one allocation phase of init(); the end logs what it took
+void memstats_phase_begin(void);
+void memstats_phase_end(const char *phase);
+
+// Samples heap use; call after anything that may allocate while drawing
+void memstats_sample(const char *where);
+
+#define MEMSTATS_PHASE_BEGIN() memstats_phase_begin()
+#define MEMSTATS_PHASE_END(phase) memstats_phase_end(phase)
+#define MEMSTATS_SAMPLE(where) memstats_sample(where)
+#else
+#define MEMSTATS_PHASE_BEGIN()
+#define MEMSTATS_PHASE_END(phase)
+#define MEMSTATS_SAMPLE(where)
+#endif
@@ -0,0 +1,361 @@
+// Accelerated event-trace replay: the face runs as it would on a wrist, but
+// every clock, tick and timer it sees is simulated, and the simulated clock
+// skips straight to whatever is due next. Each candidate setting gets the
+// whole trace in turn, on the days after the last one's. Only built with
+// REPLAY_MODE; see common.h
+
+#include "replay.h"
+
+#ifdef REPLAY_MODE
+
+#include "replay_trace.auto.h"
+
+#define REPLAY_TIMER_COUNT 8
+#define REPLAY_DAY_S (24 * 60 * 60)
+#define REPLAY_DAY_MS (REPLAY_DAY_S * 1000LL)
+// How often to look again while the face is animating
+#define REPLAY_BUSY_POLL_MS 33
+// Enough for a dictionary of one int32 tuple
+#define REPLAY_INBOX_BYTES 16
+
+#define REPLAY_EVENT_COUNT (int)(sizeof(REPLAY_EVENTS) / sizeof(ReplayEvent))
+#define REPLAY_CANDIDATE_COUNT                                                 \
+  (int)(sizeof(REPLAY_CANDIDATES) / sizeof(uint32_t))
+
+typedef struct ReplayTimer {
+  bool is_pending;
+  int64_t due_ms;
+  AppTimerCallback callback;
+  void *data;
+} ReplayTimer;
+
+// What a simulated day cost; draw calls and pixels come from frame_stats
+typedef struct ReplayTally {
+  uint32_t wakeups; // Ticks, timers and events the face was woken for
+  uint32_t frames;
+  uint32_t vibe_ms;
+  uint32_t message_bytes;
+  FrameStats stats_at_start;
+} ReplayTally;
+
+typedef enum ReplayDue {
+  REPLAY_DUE_DAY_END,
+  REPLAY_DUE_EVENT,
+  REPLAY_DUE_TICK,
+  REPLAY_DUE_TIMER,
+} ReplayDue;
+
+static ReplayHandlers handlers;
+static bool is_running;
+static AppTimer *pump_timer;
+static int64_t now_ms = REPLAY_TRACE_START * 1000LL;
+static ReplayTimer timers[REPLAY_TIMER_COUNT];
+static TickHandler tick_handler;
+static TimeUnits tick_units;
+// Kept rather than worked out from now_ms, so a tick that ties with
+// something else still comes after it
+static int64_t tick_due_ms;
+static struct tm last_tick;
+static AccelTapHandler tap_handler;
+static int candidate_idx;
+static int day_idx;
+static int event_idx;
+static ReplayTally tally;
+
+static void pump(void *context);
+
+static void schedule_pump(uint32_t delay_ms) {
+  if (!pump_timer) {
+    // Parenthesized, so it's the SDK's timer rather than the shadow: this
+    // one runs on real time. A frame a step marks dirty is queued ahead of
+    // it, so each step's frame draws before the next step
+    pump_timer = (app_timer_register)(delay_ms, pump, NULL);
+  }
+}
+
+time_t replay_time(time_t *out) {
+  const time_t seconds = (time_t)(now_ms / 1000);
+  if (out) {
+    *out = seconds;
+  }
+  return seconds;
+}
+
+void replay_time_ms(time_t *seconds, uint16_t *millis) {
+  *seconds = (time_t)(now_ms / 1000);
+  *millis = (uint16_t)(now_ms % 1000);
+}
+
+// Like the tick service: the next boundary of the subscribed unit
+static int64_t next_tick_ms(void) {
+  int64_t period_ms = REPLAY_DAY_MS;
+  if (tick_units & SECOND_UNIT) {
+    period_ms = 1000;
+  } else if (tick_units & MINUTE_UNIT) {
+    period_ms = 60 * 1000;
+  } else if (tick_units & HOUR_UNIT) {
+    period_ms = 60 * 60 * 1000;
+  }
+  return ((now_ms / period_ms) + 1) * period_ms;
+}
+
+void replay_tick_subscribe(TimeUnits units, TickHandler handler) {
+  tick_units = units;
+  tick_handler = handler;
+  tick_due_ms = next_tick_ms();
+  const time_t seconds = replay_time(NULL);
+  last_tick = *localtime(&seconds);
+}
+
+void replay_tick_unsubscribe(void) { tick_handler = NULL; }
+
+AppTimer *replay_timer_register(uint32_t timeout_ms, AppTimerCallback callback,
+                                void *data) {
+  for (int i = 0; i < REPLAY_TIMER_COUNT; i++) {
+    if (!timers[i].is_pending) {
+      timers[i] = (ReplayTimer){.is_pending = true,
+                                .due_ms = now_ms + timeout_ms,
+                                .callback = callback,
+                                .data = data};
+      // Timers can come due before the replay starts, e.g. at launch
+      schedule_pump(0);
+      return (AppTimer *)&timers[i];
+    }
+  }
+  APP_LOG(APP_LOG_LEVEL_ERROR, "Replay out of timers");
+  return NULL;
+}
+
+bool replay_timer_reschedule(AppTimer *timer, uint32_t timeout_ms) {
+  ReplayTimer *replay_timer = (ReplayTimer *)timer;
+  if (!replay_timer || !replay_timer->is_pending) {
+    return false;
+  }
+  replay_timer->due_ms = now_ms + timeout_ms;
+  return true;
+}
+
+void replay_timer_cancel(AppTimer *timer) {
+  if (timer) {
+    ((ReplayTimer *)timer)->is_pending = false;
+  }
+}
+
+void replay_tap_subscribe(AccelTapHandler handler) { tap_handler = handler; }
+
+void replay_tap_unsubscribe(void) { tap_handler = NULL; }
+
+void replay_vibe(uint32_t ms) { tally.vibe_ms += ms; }
+
+void replay_frame_drawn(void) { tally.frames++; }
+
+static ReplayTimer *next_timer(void) {
+  ReplayTimer *next = NULL;
+  for (int i = 0; i < REPLAY_TIMER_COUNT; i++) {
+    if (timers[i].is_pending && (!next || timers[i].due_ms < next->due_ms)) {
+      next = &timers[i];
+    }
+  }
+  return next;
+}
+
+static void fire_timer(ReplayTimer *timer) {
+  // Cleared first: the callback may register its slot again
+  timer->is_pending = false;
+  timer->callback(timer->data);
+}
+
+static void deliver_tick(void) {
+  const time_t seconds = replay_time(NULL);
+  struct tm *tick_time = localtime(&seconds);
+  TimeUnits units_changed = 0;
+  if (tick_time->tm_sec != last_tick.tm_sec) {
+    units_changed |= SECOND_UNIT;
+  }
+  if (tick_time->tm_min != last_tick.tm_min) {
+    units_changed |= MINUTE_UNIT;
+  }
+  if (tick_time->tm_hour != last_tick.tm_hour) {
+    units_changed |= HOUR_UNIT;
+  }
+  if (tick_time->tm_mday != last_tick.tm_mday) {
+    units_changed |= DAY_UNIT;
+  }
+  if (tick_time->tm_mon != last_tick.tm_mon) {
+    units_changed |= MONTH_UNIT;
+  }
+  if (tick_time->tm_year != last_tick.tm_year) {
+    units_changed |= YEAR_UNIT;
+  }
+  last_tick = *tick_time;
+  // First, as the handler may subscribe again
+  tick_due_ms = next_tick_ms();
+  tick_handler(tick_time, units_changed);
+}
+
+// As the phone would send it, so the face's own inbox handler parses it
+static void deliver_inbox(uint32_t key, int32_t value) {
+  uint8_t buffer[REPLAY_INBOX_BYTES];
+  DictionaryIterator iter;
+  dict_write_begin(&iter, buffer, sizeof(buffer));
+  dict_write_int32(&iter, key, value);
+  const uint32_t bytes = dict_write_end(&iter);
+  dict_read_begin_from_buffer(&iter, buffer, bytes);
+  tally.message_bytes += bytes;
+  handlers.inbox(&iter, NULL);
+}
+
+static void deliver_event(const ReplayEvent *event) {
+  switch ((ReplayEventKind)event->kind) {
+  case REPLAY_EVENT_BATTERY:
+    handlers.battery((BatteryChargeState){
+        .charge_percent = event->value & 0xFF,
+        .is_charging = (event->value >> 8) & 1,
+        .is_plugged = (event->value >> 9) & 1});
+    break;
+  case REPLAY_EVENT_BLUETOOTH:
+    handlers.bluetooth(event->value != 0);
+    break;
+  case REPLAY_EVENT_SETTINGS:
+    deliver_inbox(MESSAGE_KEY_SettingsBits, event->value);
+    break;
+  case REPLAY_EVENT_THRESHOLDS:
+    deliver_inbox(MESSAGE_KEY_PowerThresholds, event->value);
+    break;
+  case REPLAY_EVENT_TAP:
+    if (tap_handler) {
+      tap_handler((AccelAxisType)event->value, 1);
+    }
+    break;
+  }
+}
+
+// Where the current candidate's copy of the trace starts
+static int64_t run_start_ms(void) {
+  return (REPLAY_TRACE_START +
+          ((int64_t)candidate_idx * REPLAY_TRACE_DAYS * REPLAY_DAY_S)) *
+         1000;
+}
+
+static void begin_day(void) {
+  tally = (ReplayTally){.stats_at_start = frame_stats};
+}
+
+static void end_day(void) {
+  APP_LOG(APP_LOG_LEVEL_INFO,
+          "REPLAY s=0x%03lx day=%d wakeups=%lu frames=%lu draws=%lu px=%lu "
+          "vibe_ms=%lu msg_bytes=%lu",
+          (unsigned long)REPLAY_CANDIDATES[candidate_idx], day_idx,
+          (unsigned long)tally.wakeups, (unsigned long)tally.frames,
+          (unsigned long)(frame_stats.draw_calls -
+                          tally.stats_at_start.draw_calls),
+          (unsigned long)(frame_stats.pixels_written -
+                          tally.stats_at_start.pixels_written),
+          (unsigned long)tally.vibe_ms, (unsigned long)tally.message_bytes);
+}
+
+static void begin_run(void) {
+  now_ms = run_start_ms();
+  day_idx = 0;
+  event_idx = 0;
+  deliver_inbox(MESSAGE_KEY_SettingsBits,
+                (int32_t)REPLAY_CANDIDATES[candidate_idx]);
+  // The candidate's own settings message isn't part of its day
+  begin_day();
+}
+
+// Returns whether there's anything left to replay
+static bool next_day(void) {
+  end_day();
+  if (++day_idx < REPLAY_TRACE_DAYS) {
+    begin_day();
+    return true;
+  }
+  if (++candidate_idx < REPLAY_CANDIDATE_COUNT) {
+    begin_run();
+    return true;
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "REPLAY done candidates=%d days=%d",
+          REPLAY_CANDIDATE_COUNT, REPLAY_TRACE_DAYS);
+  is_running = false;
+  return false;
+}
+
+// One step per call, so every wakeup gets its own frame: whatever is due
+// first, and on a tie the day's end, then events, ticks and timers
+static void pump(void *context) {
+  pump_timer = NULL;
+  ReplayTimer *timer = next_timer();
+  if (!is_running) {
+    if (timer && timer->due_ms <= now_ms) {
+      fire_timer(timer);
+      schedule_pump(0);
+    }
+    return;
+  }
+  if (handlers.is_busy && handlers.is_busy()) {
+    schedule_pump(REPLAY_BUSY_POLL_MS);
+    return;
+  }
+  ReplayDue due = REPLAY_DUE_DAY_END;
+  int64_t due_ms = run_start_ms() + ((day_idx + 1) * REPLAY_DAY_MS);
+  if (event_idx < REPLAY_EVENT_COUNT) {
+    const int64_t event_ms =
+        run_start_ms() + (REPLAY_EVENTS[event_idx].t * 1000LL);
+    if (event_ms < due_ms) {
+      due = REPLAY_DUE_EVENT;
+      due_ms = event_ms;
+    }
+  }
+  if (tick_handler && tick_due_ms < due_ms) {
+    due = REPLAY_DUE_TICK;
+    due_ms = tick_due_ms;
+  }
+  if (timer && timer->due_ms < due_ms) {
+    due = REPLAY_DUE_TIMER;
+    due_ms = timer->due_ms;
+  }
+  if (due_ms > now_ms) {
+    now_ms = due_ms;
+  }
+  switch (due) {
+  case REPLAY_DUE_DAY_END:
+    if (!next_day()) {
+      return;
+    }
+    break;
+  case REPLAY_DUE_EVENT:
+    tally.wakeups++;
+    deliver_event(&REPLAY_EVENTS[event_idx++]);
+    break;
+  case REPLAY_DUE_TICK:
+    tally.wakeups++;
+    deliver_tick();
+    break;
+  case REPLAY_DUE_TIMER:
+    tally.wakeups++;
+    fire_timer(timer);
+    break;
+  }
+  schedule_pump(0);
+}
+
+void replay_start(ReplayHandlers new_handlers) {
+  handlers = new_handlers;
+  is_running = true;
+  candidate_idx = 0;
+  APP_LOG(APP_LOG_LEVEL_INFO, "REPLAY start events=%d candidates=%d days=%d",
+          REPLAY_EVENT_COUNT, REPLAY_CANDIDATE_COUNT, REPLAY_TRACE_DAYS);
+  begin_run();
+  schedule_pump(0);
+}
+
+void replay_stop(void) {
+  is_running = false;
+  if (pump_timer) {
+    (app_timer_cancel)(pump_timer);
+    pump_timer = NULL;
+  }
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "common.h"
+
+#ifdef REPLAY_MODE
+
+typedef enum ReplayEventKind {
+  // Charge percent, then is_charging at bit 8 and is_plugged at bit 9
+  REPLAY_EVENT_BATTERY,
+  REPLAY_EVENT_BLUETOOTH,  // 1 if connected
+  REPLAY_EVENT_SETTINGS,   // Packed like MESSAGE_KEY_SettingsBits
+  REPLAY_EVENT_THRESHOLDS, // Packed like MESSAGE_KEY_PowerThresholds
+  REPLAY_EVENT_TAP,        // The AccelAxisType
+} ReplayEventKind;
+
+typedef struct ReplayEvent {
+  uint32_t t; // Seconds from the start of the trace
+  uint8_t kind;
+  int32_t value;
+} ReplayEvent;
+
+typedef struct ReplayHandlers {
+  void (*battery)(BatteryChargeState charge_state);
+  void (*bluetooth)(bool connected);
+  AppMessageInboxReceived inbox;
+  // While this is true the clock holds still, so a real-time animation
+  // plays out before the next event
+  bool (*is_busy)(void);
+} ReplayHandlers;
+
+// Starts the day once the face's own init is done; ticks and taps go to
+// whatever subscribed through the shadowed calls in common.h
+void replay_start(ReplayHandlers handlers);
+void replay_stop(void);
+
+// Call once per frame, from the layer that draws first
+void replay_frame_drawn(void);
+
+// The simulated clock, to the millisecond, for what schedules against it
+void replay_time_ms(time_t *seconds, uint16_t *millis);
+
+#endif
@@ -0,0 +1,251 @@
+// Persisted frame snapshots for the first paint after a relaunch; see
+// snapshot.h
+
+#include "snapshot.h"
+
+#include "framebuffer.h"
+#include "memstats.h"
+
+#include <stdlib.h>
+
+// Bump when the encoding changes; older snapshots are then never drawn
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_MAX_BYTES (SNAPSHOT_CHUNK_COUNT * PERSIST_DATA_MAX_LENGTH)
+
+// Only the display's own bytes of each line; stride padding isn't stored
+#ifdef PBL_COLOR
+#define LINE_BYTES PBL_DISPLAY_WIDTH
+#else
+#define LINE_BYTES ((PBL_DISPLAY_WIDTH + 7) / 8)
+#endif
+#define FRAME_BYTES (LINE_BYTES * PBL_DISPLAY_HEIGHT)
+
+// The frame is one stream of bytes, line after line, cut into packets. A
+// control byte with RUN_FLAG set repeats the next byte (control & ~RUN_FLAG)
+// + MIN_RUN times; otherwise control + 1 literal bytes follow
+#define RUN_FLAG 0x80
+#define MIN_RUN 3
+#define MAX_RUN (0x7F + MIN_RUN)
+#define MAX_LITERAL 0x80
+
+typedef struct SnapshotHeader {
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t data_bytes; // Of the encoded frame that follows
+  uint32_t minute;
+  uint32_t key;
+} SnapshotHeader;
+#define SNAPSHOT_MAX_DATA_BYTES                                                \
+  (SNAPSHOT_MAX_BYTES - (int)sizeof(SnapshotHeader))
+
+// A SnapshotHeader, then the encoded frame; laid out as it is persisted
+static uint8_t *blob;
+static bool is_blob_saved;
+// What the last capture (or load) was for, whether or not it fit
+static bool is_captured;
+static uint32_t captured_minute;
+static uint32_t captured_key;
+
+static inline uint8_t *frame_byte(const FramebufferTarget *fb, int i) {
+  return fb->data + ((i / LINE_BYTES) * fb->stride) + (i % LINE_BYTES);
+}
+
+static bool starts_run(const FramebufferTarget *fb, int i) {
+  if (i + MIN_RUN > FRAME_BYTES) {
+    return false;
+  }
+  const uint8_t value = *frame_byte(fb, i);
+  for (int k = 1; k < MIN_RUN; k++) {
+    if (*frame_byte(fb, i + k) != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the encoded size, or -1 past max
+static int encode(const FramebufferTarget *fb, uint8_t *out, int max) {
+  int len = 0;
+  int i = 0;
+  while (i < FRAME_BYTES) {
+    const uint8_t value = *frame_byte(fb, i);
+    int run = 1;
+    while (i + run < FRAME_BYTES && run < MAX_RUN &&
+           *frame_byte(fb, i + run) == value) {
+      run++;
+    }
+    if (run >= MIN_RUN) {
+      if (len + 2 > max) {
+        return -1;
+      }
+      out[len] = RUN_FLAG | (run - MIN_RUN);
+      out[len + 1] = value;
+      len += 2;
+      i += run;
+      continue;
+    }
+    // Up to where the next run starts
+    int literal = 1;
+    while (i + literal < FRAME_BYTES && literal < MAX_LITERAL &&
+           !starts_run(fb, i + literal)) {
+      literal++;
+    }
+    if (len + 1 + literal > max) {
+      return -1;
+    }
+    out[len] = literal - 1;
+    for (int k = 0; k < literal; k++) {
+      out[len + 1 + k] = *frame_byte(fb, i + k);
+    }
+    len += 1 + literal;
+    i += literal;
+  }
+  return len;
+}
+
+// Stops at anything that would write past the frame; a snapshot only ever
+// has to be right for one frame, so a bad one just paints garbage briefly
+static bool decode(const uint8_t *in, int in_len, const FramebufferTarget *fb) {
+  int pos = 0;
+  int i = 0;
+  while (i < in_len) {
+    const uint8_t control = in[i++];
+    if (control & RUN_FLAG) {
+      const int run = (control & ~RUN_FLAG) + MIN_RUN;
+      if (i >= in_len || pos + run > FRAME_BYTES) {
+        return false;
+      }
+      const uint8_t value = in[i++];
+      for (int k = 0; k < run; k++) {
+        *frame_byte(fb, pos++) = value;
+      }
+    } else {
+      const int literal = control + 1;
+      if (i + literal > in_len || pos + literal > FRAME_BYTES) {
+        return false;
+      }
+      for (int k = 0; k < literal; k++) {
+        *frame_byte(fb, pos++) = in[i++];
+      }
+    }
+  }
+  return pos == FRAME_BYTES;
+}
+
+static void release_blob(void) {
+  free(blob);
+  blob = NULL;
+}
+
+bool snapshot_load(uint32_t first_key, uint32_t minute, uint32_t key) {
+  SnapshotHeader header;
+  if (persist_read_data(first_key, &header, sizeof(header)) !=
+          (int)sizeof(header) ||
+      header.version != SNAPSHOT_VERSION || header.minute != minute ||
+      header.key != key || header.data_bytes == 0 ||
+      header.data_bytes > SNAPSHOT_MAX_DATA_BYTES) {
+    return false;
+  }
+  const int total = sizeof(header) + header.data_bytes;
+  blob = malloc(total);
+  if (!blob) {
+    return false;
+  }
+  for (int offset = 0; offset < total; offset += PERSIST_DATA_MAX_LENGTH) {
+    const int chunk = total - offset < PERSIST_DATA_MAX_LENGTH
+                          ? total - offset
+                          : PERSIST_DATA_MAX_LENGTH;
+    const uint32_t chunk_key = first_key + (offset / PERSIST_DATA_MAX_LENGTH);
+    if (persist_read_data(chunk_key, blob + offset, chunk) != chunk) {
+      VERBOSE_LOG("Snapshot chunk %d missing", (int)chunk_key);
+      release_blob();
+      return false;
+    }
+  }
+  is_blob_saved = true;
+  is_captured = true;
+  captured_minute = minute;
+  captured_key = key;
+  MEMSTATS_SAMPLE("snapshot");
+  return true;
+}
+
+bool snapshot_draw(GContext *ctx) {
+  FramebufferTarget fb;
+  if (!blob || !framebuffer_begin(ctx, GPointZero, &fb)) {
+    return false;
+  }
+  const bool is_drawn =
+      fb.stride >= LINE_BYTES && fb.height >= PBL_DISPLAY_HEIGHT &&
+      decode(blob + sizeof(SnapshotHeader),
+             ((const SnapshotHeader *)blob)->data_bytes, &fb);
+  framebuffer_end(ctx, &fb);
+  if (!is_drawn) {
+    APP_LOG(APP_LOG_LEVEL_WARNING, "Snapshot didn't decode");
+  }
+  return is_drawn;
+}
+
+void snapshot_release(void) { release_blob(); }
+
+void snapshot_capture(GContext *ctx, uint32_t minute, uint32_t key) {
+  if (is_captured && captured_minute == minute && captured_key == key) {
+    return;
+  }
+  FramebufferTarget fb;
+  if (!framebuffer_begin(ctx, GPointZero, &fb)) {
+    return;
+  }
+  is_captured = true;
+  captured_minute = minute;
+  captured_key = key;
+  // The old frame is stale either way; drop it before asking for more heap
+  release_blob();
+  // Room for the busiest frame that fits, so the frame is only walked once
+  if ((blob = malloc(SNAPSHOT_MAX_BYTES))) {
+    const int data_bytes =
+        encode(&fb, blob + sizeof(SnapshotHeader), SNAPSHOT_MAX_DATA_BYTES);
+    if (data_bytes < 0) {
+      VERBOSE_LOG("Frame too busy to snapshot");
+      release_blob();
+    } else {
+      *(SnapshotHeader *)blob =
+          (SnapshotHeader){.version = SNAPSHOT_VERSION,
+                           .data_bytes = data_bytes,
+                           .minute = minute,
+                           .key = key};
+      is_blob_saved = false;
+      MEMSTATS_SAMPLE("snapshot");
+    }
+  }
+  framebuffer_end(ctx, &fb);
+}
+
+void snapshot_save(uint32_t first_key) {
+  if (blob && !is_blob_saved) {
+    const int total =
+        sizeof(SnapshotHeader) + ((const SnapshotHeader *)blob)->data_bytes;
+    const int chunks =
+        (total + PERSIST_DATA_MAX_LENGTH - 1) / PERSIST_DATA_MAX_LENGTH;
+    // The header's chunk goes last, so a save cut short never loads
+    bool is_saved = true;
+    for (int c = chunks - 1; c >= 0 && is_saved; c--) {
+      const int offset = c * PERSIST_DATA_MAX_LENGTH;
+      const int chunk = total - offset < PERSIST_DATA_MAX_LENGTH
+                            ? total - offset
+                            : PERSIST_DATA_MAX_LENGTH;
+      is_saved =
+          persist_write_data(first_key + c, blob + offset, chunk) == chunk;
+    }
+    if (!is_saved) {
+      APP_LOG(APP_LOG_LEVEL_WARNING, "Snapshot didn't fit in storage");
+      persist_delete(first_key);
+    }
+    for (int c = chunks; c < SNAPSHOT_CHUNK_COUNT; c++) {
+      if (persist_exists(first_key + c)) {
+        persist_delete(first_key + c);
+      }
+    }
+  }
+  release_blob();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "common.h"
+
+// The last frame drawn, run-length encoded and persisted on exit, so a
+// relaunch can paint it before anything else is loaded. A snapshot is only
+// drawn for the minute and settings key it was captured under
+
+// Persist keys first_key to first_key + SNAPSHOT_CHUNK_COUNT - 1 are the
+// snapshot's; each holds up to PERSIST_DATA_MAX_LENGTH bytes of it
+#define SNAPSHOT_CHUNK_COUNT 10
+
+// Returns whether the stored snapshot matches, in which case it is kept for
+// snapshot_draw()
+bool snapshot_load(uint32_t first_key, uint32_t minute, uint32_t key);
+
+// Decodes the loaded snapshot over the whole framebuffer; returns whether it
+// did
+bool snapshot_draw(GContext *ctx);
+
+// Frees the loaded snapshot once the face has drawn over it
+void snapshot_release(void);
+
+// Encodes the framebuffer, unless the snapshot loaded is already for this
+// minute and key. Meant for exit, as snapshot_save() follows: it takes the
+// persist keys' worth of heap. A frame that won't fit in them isn't kept
+void snapshot_capture(GContext *ctx, uint32_t minute, uint32_t key);
+
+// Writes what was captured, if anything, and frees it
+void snapshot_save(uint32_t first_key);
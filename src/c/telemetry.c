@@ -0,0 +1,204 @@
+// Render cost counters: the frame stats behind the graphics_* wrappers, the
+// debug build's per-section profile, and the hourly batches the SendTelemetry
+// setting turns on. See common.h for the flags
+
+#include "telemetry.h"
+
+#ifdef FRAME_STATS_ENABLED
+FrameStats frame_stats;
+#endif
+
+static uint32_t now_ms(void) {
+  time_t seconds;
+  uint16_t millis;
+  time_ms(&seconds, &millis);
+  return ((uint32_t)seconds * 1000) + millis;
+}
+
+#ifdef PROFILING_ENABLED
+ProfileCounter profile_counters[PROFILE_SECTION_COUNT];
+
+static const char *const PROFILE_SECTION_NAMES[PROFILE_SECTION_COUNT] = {
+    "hex_row", "seconds_comb", "smear"};
+
+uint32_t profile_now_ms(void) { return now_ms(); }
+
+void profile_log(void) {
+  for (int i = 0; i < PROFILE_SECTION_COUNT; i++) {
+    APP_LOG(APP_LOG_LEVEL_DEBUG, "PROFILE %s calls=%d ms=%d",
+            PROFILE_SECTION_NAMES[i], (int)profile_counters[i].calls,
+            (int)profile_counters[i].total_ms);
+  }
+}
+#endif
+
+// Update times land in power of two buckets: 0ms, 1ms, 2-3ms, ... 64ms+
+#define TELEMETRY_HISTOGRAM_BUCKETS 8
+// Bumped whenever the layout written by telemetry_flush() changes;
+// index.js checks it
+#define TELEMETRY_BATCH_VERSION 2
+// Set in the batch's flags byte when it counts draw calls and state changes,
+// which only builds with FRAME_STATS_ENABLED do
+#define TELEMETRY_FLAG_DRAW_COUNTS (1 << 0)
+#define TELEMETRY_BATCH_BYTES                                                  \
+  (6 + 8 + 2 + (2 * TELEMETRY_HISTOGRAM_BUCKETS) + 4)
+
+typedef struct TelemetryBatch {
+  uint16_t updates;  // Layer update callbacks
+  uint16_t renders;  // ... of which drew their content (not a cached copy)
+  uint32_t draw_calls;
+  uint32_t state_changes;
+  uint16_t max_ms;
+  uint16_t histogram[TELEMETRY_HISTOGRAM_BUCKETS];
+  uint16_t tier_switches;
+} TelemetryBatch;
+
+static bool is_telemetry_enabled;
+static TelemetryBatch batch;
+// Sent, but not yet acknowledged by the phone
+static TelemetryBatch sent_batch;
+static bool is_batch_in_flight;
+static uint8_t current_tier;
+static uint32_t update_start_ms;
+#ifdef FRAME_STATS_ENABLED
+static uint32_t update_start_draw_calls;
+static uint32_t update_start_state_changes;
+#endif
+
+static uint16_t saturating_inc(uint16_t value) {
+  return value == UINT16_MAX ? value : value + 1;
+}
+
+static uint16_t saturating_add(uint16_t a, uint16_t b) {
+  return a > UINT16_MAX - b ? UINT16_MAX : a + b;
+}
+
+void telemetry_set_enabled(bool is_enabled) {
+  is_telemetry_enabled = is_enabled;
+  batch = (TelemetryBatch){0};
+  is_batch_in_flight = false;
+}
+
+void telemetry_update_begin(void) {
+  if (!is_telemetry_enabled) {
+    return;
+  }
+  update_start_ms = now_ms();
+#ifdef FRAME_STATS_ENABLED
+  update_start_draw_calls = frame_stats.draw_calls;
+  update_start_state_changes = frame_stats.state_changes;
+#endif
+}
+
+void telemetry_update_end(bool rendered) {
+  if (!is_telemetry_enabled) {
+    return;
+  }
+  const uint32_t elapsed_ms = now_ms() - update_start_ms;
+  int bucket = elapsed_ms == 0 ? 0 : 32 - __builtin_clz(elapsed_ms);
+  if (bucket >= TELEMETRY_HISTOGRAM_BUCKETS) {
+    bucket = TELEMETRY_HISTOGRAM_BUCKETS - 1;
+  }
+  batch.histogram[bucket] = saturating_inc(batch.histogram[bucket]);
+  batch.updates = saturating_inc(batch.updates);
+  if (rendered) {
+    batch.renders = saturating_inc(batch.renders);
+  }
+#ifdef FRAME_STATS_ENABLED
+  batch.draw_calls += frame_stats.draw_calls - update_start_draw_calls;
+  batch.state_changes += frame_stats.state_changes - update_start_state_changes;
+#endif
+  if (elapsed_ms > batch.max_ms) {
+    batch.max_ms = elapsed_ms > UINT16_MAX ? UINT16_MAX : elapsed_ms;
+  }
+}
+
+// Kept while off too, so the first batch after turning it on names the tier
+void telemetry_note_tier(int tier) {
+  current_tier = (uint8_t)tier;
+  if (!is_telemetry_enabled) {
+    return;
+  }
+  batch.tier_switches = saturating_inc(batch.tier_switches);
+}
+
+static uint8_t *put_u16(uint8_t *out, uint16_t value) {
+  out[0] = value & 0xFF;
+  out[1] = value >> 8;
+  return out + 2;
+}
+
+static uint8_t *put_u32(uint8_t *out, uint32_t value) {
+  out = put_u16(out, value & 0xFFFF);
+  return put_u16(out, value >> 16);
+}
+
+// Little endian: version, hour, updates, renders, draw calls, state changes,
+// max ms, the histogram, tier switches, then the tier it ended on and the
+// TELEMETRY_FLAG_* flags
+void telemetry_flush(void) {
+  if (!is_telemetry_enabled || batch.updates == 0) {
+    return;
+  }
+  if (is_batch_in_flight) {
+    return; // Still counting; this hour goes out once the last is answered
+  }
+  uint8_t bytes[TELEMETRY_BATCH_BYTES];
+  uint8_t *out = bytes;
+  const time_t now = time(NULL);
+  *out++ = TELEMETRY_BATCH_VERSION;
+  *out++ = (uint8_t)localtime(&now)->tm_hour;
+  out = put_u16(out, batch.updates);
+  out = put_u16(out, batch.renders);
+  out = put_u32(out, batch.draw_calls);
+  out = put_u32(out, batch.state_changes);
+  out = put_u16(out, batch.max_ms);
+  for (int i = 0; i < TELEMETRY_HISTOGRAM_BUCKETS; i++) {
+    out = put_u16(out, batch.histogram[i]);
+  }
+  out = put_u16(out, batch.tier_switches);
+  *out++ = current_tier;
+#ifdef FRAME_STATS_ENABLED
+  *out++ = TELEMETRY_FLAG_DRAW_COUNTS;
+#else
+  *out++ = 0;
+#endif
+
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    return; // Still counting; the next flush carries this hour too
+  }
+  dict_write_data(iter, MESSAGE_KEY_Telemetry, bytes, sizeof(bytes));
+  if (app_message_outbox_send() == APP_MSG_OK) {
+    sent_batch = batch;
+    is_batch_in_flight = true;
+    batch = (TelemetryBatch){0};
+  }
+}
+
+void telemetry_outbox_sent(DictionaryIterator *iterator) {
+  if (is_batch_in_flight && dict_find(iterator, MESSAGE_KEY_Telemetry)) {
+    is_batch_in_flight = false;
+  }
+}
+
+// The failed batch's counts join the hour being gathered
+void telemetry_outbox_failed(DictionaryIterator *iterator) {
+  if (!is_batch_in_flight || !dict_find(iterator, MESSAGE_KEY_Telemetry)) {
+    return;
+  }
+  is_batch_in_flight = false;
+  batch.updates = saturating_add(batch.updates, sent_batch.updates);
+  batch.renders = saturating_add(batch.renders, sent_batch.renders);
+  batch.draw_calls += sent_batch.draw_calls;
+  batch.state_changes += sent_batch.state_changes;
+  if (sent_batch.max_ms > batch.max_ms) {
+    batch.max_ms = sent_batch.max_ms;
+  }
+  for (int i = 0; i < TELEMETRY_HISTOGRAM_BUCKETS; i++) {
+    batch.histogram[i] =
+        saturating_add(batch.histogram[i], sent_batch.histogram[i]);
+  }
+  batch.tier_switches =
+      saturating_add(batch.tier_switches, sent_batch.tier_switches);
+}
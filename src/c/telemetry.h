@@ -0,0 +1,27 @@
+#pragma once
+
+#include "common.h"
+
+// Off until the SendTelemetry setting turns it on; until then the calls
+// below do nothing. Turning it either way drops the batch being gathered
+void telemetry_set_enabled(bool is_enabled);
+
+// Bracket each layer update callback; rendered says whether the update drew
+// its content rather than blitting a cached copy
+void telemetry_update_begin(void);
+void telemetry_update_end(bool rendered);
+
+// Counts a switch to a new power tier (see governor.h)
+void telemetry_note_tier(int tier);
+
+// Sends the batch gathered since the last one that went out
+void telemetry_flush(void);
+
+// Call from the AppMessage outbox handlers. A batch is only dropped once the
+// phone has it; one that fails goes out again with the next hour's
+void telemetry_outbox_sent(DictionaryIterator *iterator);
+void telemetry_outbox_failed(DictionaryIterator *iterator);
+
+#define TELEMETRY_UPDATE_BEGIN() telemetry_update_begin()
+#define TELEMETRY_UPDATE_END(rendered) telemetry_update_end(rendered)
+#define TELEMETRY_NOTE_TIER(tier) telemetry_note_tier(tier)
@@ -2,11 +2,23 @@
 // Be warned: Some questionable stuff here! Everything egregious was fixed,
 // but it still isn't exactly the height of clean code
 
+#include "arena.h"
 #include "common.h"
+#include "drawlist.h"
+#include "framebuffer.h"
+#include "glyphcache.h"
+#include "governor.h"
+#include "harness.h"
+#include "layout_tables.auto.h"
+#include "memstats.h"
 #include "pebble.h"
-#include <math.h>
+#include "replay.h"
+#include "snapshot.h"
+#include "telemetry.h"
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 // VSCode include hacks
 
@@ -16,20 +28,22 @@
 #define PLAT PlatformTypeEmery
 #endif
 
-#ifndef RESOURCE_ID_SMALL_NUMBER_F
+#ifndef RESOURCE_ID_GLYPH_ATLAS
 #include "resource_ids.auto.h"
 #endif
 
 #define BIG_DIGIT_WIDTH_PX 30
-#define BIG_DIGIT_SLIM_WIDTH_PX 6
 #define BIG_DIGIT_HEIGHT_PX 45
 #define BIG_DIGIT_NOISE_PX_COUNT 160 // ~15%
 #define SMALL_DIGIT_WIDTH_PX 12
-#define SMALL_DIGIT_SLIM_WIDTH_PX 3
 #define SMALL_DIGIT_HEIGHT_PX 18
 #define SMALL_DIGIT_NOISE_PX_COUNT 27 // ~15%
 
-#define NOISE_SRC_LEN 512
+// Smears are drawn from a small bank of masks per glyph size, each with its
+// noise dots already punched in. Must be a power of two
+#define NOISE_MASK_VARIANTS 4
+// Fixed so the noise (and so any cached row) is the same on every launch
+#define NOISE_MASK_SEED 0x2E958D67
 
 // Seconds - Connected - Battery
 #define SECONDS_BATT_CONN_ROW_TOTAL_HEIGHT_PX 8
@@ -40,12 +54,14 @@
 #define SECONDS_INDICATOR_TOTAL_WIDTH_PX                                       \
   ((SECONDS_INDICATOR_WIDTH_PX * 60) +                                         \
    (SECONDS_INDICATOR_INTERNAL_PADDING_W_PX * 59))
+#define SECONDS_INDICATOR_MAX_COUNT 59 // Second 0 shows no lines at all
 #define CONNECTED_ICON_W_H_PX 3
 #define CONN_ICON_OFFSET_INSIDE_ROW_PX                                         \
   ((SECONDS_BATT_CONN_ROW_TOTAL_HEIGHT_PX - CONNECTED_ICON_W_H_PX) / 2) + 1
 #define BATTERY_BAR_WIDTH_PX 1
 #define BATTERY_BAR_HEIGHT_PX 4
 #define BATTERY_BAR_INTERNAL_PADDING_W_PX 1
+#define BATTERY_BAR_MAX_COUNT 5 // The most BATTERY_BAR_COUNTS ever holds
 #define CHARGING_ICON_WIDTH_PX 9
 #define CHARGING_ICON_HEIGHT_PX 5
 #define BATT_OFFSET_INSIDE_ROW_PX                                              \
@@ -74,21 +90,60 @@
 // On everything else, it resolves to 2
 #define EXTRA_VERTICAL_PADDING_PX                                              \
   (PBL_PLATFORM_TYPE_CURRENT == PlatformTypeEmery ? 5 : 0)
-#define HORIZONTAL_TRACK_WIDTH_PX                                              \
-  (PBL_DISPLAY_WIDTH - (2 * EXTERNAL_ITEM_HORIZONTAL_PADDING_PX))
-#define DOUBLE_WIDE_BIG_DIGIT_MOVEMENT_WIDTH_PX                                \
-  (HORIZONTAL_TRACK_WIDTH_PX - (BIG_DIGIT_WIDTH_PX * 2) -                      \
-   INTERNAL_FONT_PADDING_PX)
-#define SINGLE_WIDE_SMALL_DIGIT_MOVEMENT_WIDTH_PX                              \
-  (HORIZONTAL_TRACK_WIDTH_PX - SMALL_DIGIT_WIDTH_PX)
-#define DOUBLE_WIDE_SMALL_DIGIT_MOVEMENT_WIDTH_PX                              \
-  (HORIZONTAL_TRACK_WIDTH_PX - (SMALL_DIGIT_WIDTH_PX * 2) -                    \
-   INTERNAL_FONT_PADDING_PX)
-
-#define BIG_HEX_DIGIT_COUNT 16
-#define SMALL_HEX_DIGIT_COUNT 24
-
-#define SETTINGS_KEY 1
+// Where each row's value sits along the track, and the slim/double wide
+// glyph rules, live in tools/layout_tables.py
+
+// The layout tables were generated for the same geometry as everything else
+_Static_assert(LAYOUT_TABLES_DISPLAY_WIDTH_PX == PBL_DISPLAY_WIDTH &&
+                   LAYOUT_TABLES_HORIZONTAL_PADDING_PX ==
+                       EXTERNAL_ITEM_HORIZONTAL_PADDING_PX &&
+                   LAYOUT_TABLES_BIG_DIGIT_WIDTH_PX == BIG_DIGIT_WIDTH_PX &&
+                   LAYOUT_TABLES_SMALL_DIGIT_WIDTH_PX == SMALL_DIGIT_WIDTH_PX &&
+                   LAYOUT_TABLES_FONT_PADDING_PX == INTERNAL_FONT_PADDING_PX,
+               "Stale layout_tables.auto.h; see tools/layout_tables.py");
+_Static_assert(LAYOUT_TABLES_DISPLAY_HEIGHT_PX == PBL_DISPLAY_HEIGHT &&
+                   LAYOUT_TABLES_VERTICAL_PADDING_PX ==
+                       EXTERNAL_ITEM_VERTICAL_PADDING_PX &&
+                   LAYOUT_TABLES_EXTRA_VERTICAL_PADDING_PX ==
+                       EXTRA_VERTICAL_PADDING_PX &&
+                   LAYOUT_TABLES_BIG_DIGIT_HEIGHT_PX == BIG_DIGIT_HEIGHT_PX &&
+                   LAYOUT_TABLES_SMALL_DIGIT_HEIGHT_PX ==
+                       SMALL_DIGIT_HEIGHT_PX &&
+                   LAYOUT_TABLES_SECONDS_ROW_HEIGHT_PX ==
+                       SECONDS_BATT_CONN_ROW_TOTAL_HEIGHT_PX,
+               "Stale layout_tables.auto.h; see tools/layout_tables.py");
+
+#define BIG_HEX_DIGIT_COUNT GLYPH_BIG_COUNT
+#define SMALL_HEX_DIGIT_COUNT GLYPH_SMALL_COUNT
+_Static_assert(GLYPH_BIG_W_PX == BIG_DIGIT_WIDTH_PX &&
+                   GLYPH_BIG_H_PX == BIG_DIGIT_HEIGHT_PX &&
+                   GLYPH_SMALL_W_PX == SMALL_DIGIT_WIDTH_PX &&
+                   GLYPH_SMALL_H_PX == SMALL_DIGIT_HEIGHT_PX,
+               "Glyph pages out of step with the digit sizes");
+
+// Smears and charging icons live in one atlas resource, packed at build time
+// by tools/glyph_atlas.py (whose LAYOUT these must match); the glyphs are in
+// pages of their own (see glyphcache.h)
+// Every cell starts on a byte boundary; each row's smears go lighter first
+#define ATLAS_BIG_CELL_W_PX 32
+#define ATLAS_SMALL_CELL_W_PX 16
+#define ATLAS_ICON_CELL_W_PX 16
+#define ATLAS_BIG_ROW_Y_PX 0
+#define ATLAS_SMALL_ROW_Y_PX BIG_DIGIT_HEIGHT_PX
+#define ATLAS_ICON_ROW_Y_PX (ATLAS_SMALL_ROW_Y_PX + SMALL_DIGIT_HEIGHT_PX)
+#define ATLAS_BIG_SMEAR_CELL 0
+#define ATLAS_SMALL_SMEAR_CELL 0
+
+// Raw LegacyClaySettings struct, as the first releases persisted it; only
+// read to migrate it to SETTINGS_RECORD_KEY
+#define LEGACY_SETTINGS_KEY 1
+#define SETTINGS_RECORD_KEY 2
+// Through SNAPSHOT_FIRST_KEY + SNAPSHOT_CHUNK_COUNT - 1; see snapshot.h
+#define SNAPSHOT_FIRST_KEY 3
+
+// Snapshot keys are the render settings bits, plus these
+#define SNAPSHOT_KEY_24H (1 << 16)
+#define SNAPSHOT_KEY_HARNESS (1 << 17)
 
 const GColor FOREGROUND_COLOR = GColorWhite;
 const GColor BACKGROUND_COLOR = GColorBlack;
@@ -97,6 +152,12 @@ const GColor CONNECTED_INDICATOR_COLOR =
 const GColor BATTERY_COLOR =
     PBL_IF_COLOR_ELSE(GColorMintGreen, FOREGROUND_COLOR);
 
+// Each row tints its glyphs with a 3 step saccade: the display value, then
+// the ghost copies in turn. A tint is a row's first step plus the step
+// Big and small glyphs number their tints separately; no row mixes the two
+#define GLYPH_SACCADE_STEPS 3
+
+#ifdef PBL_COLOR
 // R G B
 GColor MINUTES_SACCADE[] = {GColorRed, GColorFolly, GColorDarkCandyAppleRed};
 GColor HOURS_SACCADE[] = {GColorElectricBlue, GColorVividCerulean,
@@ -107,33 +168,28 @@ GColor MONTH_OF_YEAR_SACCADE[] = {GColorScreaminGreen, GColorIslamicGreen,
 GColor DAY_OF_MONTH_SACCADE[] = {GColorSunsetOrange, GColorOrange,
                                  GColorDarkCandyAppleRed};
 
-const int BIG_NUMBER_RESOURCE_IDS[] = {
-    RESOURCE_ID_NUMBER_0, RESOURCE_ID_NUMBER_1, RESOURCE_ID_NUMBER_2,
-    RESOURCE_ID_NUMBER_3, RESOURCE_ID_NUMBER_4, RESOURCE_ID_NUMBER_5,
-    RESOURCE_ID_NUMBER_6, RESOURCE_ID_NUMBER_7, RESOURCE_ID_NUMBER_8,
-    RESOURCE_ID_NUMBER_9, RESOURCE_ID_NUMBER_A, RESOURCE_ID_NUMBER_B,
-    RESOURCE_ID_NUMBER_C, RESOURCE_ID_NUMBER_D, RESOURCE_ID_NUMBER_E,
-    RESOURCE_ID_NUMBER_F};
-const int SMALL_NUMBER_RESOURCE_IDS[] = {
-    RESOURCE_ID_SMALL_NUMBER_0, RESOURCE_ID_SMALL_NUMBER_1,   // 0 1
-    RESOURCE_ID_SMALL_NUMBER_2, RESOURCE_ID_SMALL_NUMBER_3,   // 2 3
-    RESOURCE_ID_SMALL_NUMBER_4, RESOURCE_ID_SMALL_NUMBER_5,   // 4 5
-    RESOURCE_ID_SMALL_NUMBER_6, RESOURCE_ID_SMALL_NUMBER_7,   // 6 7
-    RESOURCE_ID_SMALL_NUMBER_8, RESOURCE_ID_SMALL_NUMBER_9,   // 8 9
-    RESOURCE_ID_SMALL_NUMBER_A, RESOURCE_ID_SMALL_NUMBER_B,   // 10 11
-    RESOURCE_ID_SMALL_NUMBER_C, RESOURCE_ID_SMALL_NUMBER_D,   // 12 13
-    RESOURCE_ID_SMALL_NUMBER_E, RESOURCE_ID_SMALL_NUMBER_F,   // 14 15
-    RESOURCE_ID_SMALL_NUMBER_H, RESOURCE_ID_SMALL_NUMBER_M,   // 16 17
-    RESOURCE_ID_SMALL_NUMBER_O, RESOURCE_ID_SMALL_NUMBER_R,   // 18 19
-    RESOURCE_ID_SMALL_NUMBER_S, RESOURCE_ID_SMALL_NUMBER_T,   // 20 21
-    RESOURCE_ID_SMALL_NUMBER_U, RESOURCE_ID_SMALL_NUMBER_W};  // 22 23
-const int DAYS_OF_WEEK_RESOURCE_ID_INDICES[][7] = {{20, 22},  // SU
-                                                   {17, 18},  // MO
-                                                   {21, 22},  // TU
-                                                   {23, 14},  // WE
-                                                   {21, 16},  // TH
-                                                   {15, 19},  // FR
-                                                   {20, 10}}; // SA
+// In glyph_tint_base() order
+GColor *const BIG_GLYPH_SACCADES[] = {HOURS_SACCADE, MINUTES_SACCADE};
+GColor *const SMALL_GLYPH_SACCADES[] = {
+    DAY_OF_WEEK_SACCADE, MONTH_OF_YEAR_SACCADE, DAY_OF_MONTH_SACCADE};
+#define BIG_GLYPH_TINT_COUNT (2 * GLYPH_SACCADE_STEPS)
+#define SMALL_GLYPH_TINT_COUNT (3 * GLYPH_SACCADE_STEPS)
+#endif
+
+
+// ClaySettings as the first releases had it, and so the exact layout (7
+// bytes) they wrote to LEGACY_SETTINGS_KEY. Frozen: never add fields here
+typedef struct LegacyClaySettings {
+  bool HexMode;
+  bool PowerMode;
+  bool ColorizeDigits;
+  bool GhostTime;
+  bool GhostDate;
+  bool HourlyVibrate;
+  bool DisconnectVibrate;
+} LegacyClaySettings;
+_Static_assert(sizeof(LegacyClaySettings) == 7,
+               "LegacyClaySettings must match what old releases persisted");
 
 typedef struct ClaySettings {
   bool HexMode;
@@ -143,8 +199,78 @@ typedef struct ClaySettings {
   bool GhostDate;
   bool HourlyVibrate;
   bool DisconnectVibrate;
+  bool AnimateTransitions;
+  bool PowerGovernor;
+  bool SendTelemetry;
 } ClaySettings;
 
+// ClaySettings packed one bit per field, in declaration order. This is what
+// the phone sends (MESSAGE_KEY_SettingsBits) and what is persisted, so bits
+// may only ever be added, never reordered
+typedef enum SettingsBit {
+  SETTING_HEX_MODE = 1 << 0,
+  SETTING_POWER_MODE = 1 << 1,
+  SETTING_COLORIZE_DIGITS = 1 << 2,
+  SETTING_GHOST_TIME = 1 << 3,
+  SETTING_GHOST_DATE = 1 << 4,
+  SETTING_HOURLY_VIBRATE = 1 << 5,
+  SETTING_DISCONNECT_VIBRATE = 1 << 6,
+  SETTING_ANIMATE_TRANSITIONS = 1 << 7,
+  SETTING_POWER_GOVERNOR = 1 << 8,
+  SETTING_SEND_TELEMETRY = 1 << 9,
+} SettingsBit;
+
+// Defaults, matching config.js
+#define SETTINGS_DEFAULT_BITS                                                  \
+  (SETTING_HEX_MODE | SETTING_POWER_MODE | SETTING_GHOST_TIME |                \
+   SETTING_DISCONNECT_VIBRATE)
+// Settings that change what is drawn; the rest only change behaviour
+#define SETTINGS_RENDER_BITS                                                   \
+  (SETTING_HEX_MODE | SETTING_POWER_MODE | SETTING_COLORIZE_DIGITS |           \
+   SETTING_GHOST_TIME | SETTING_GHOST_DATE)
+
+// Bump SETTINGS_RECORD_VERSION when adding a bit, and add the new version's
+// bits to SETTINGS_VERSION_BITS; anything a stored record predates takes its
+// default
+#define SETTINGS_RECORD_VERSION 4
+static const uint32_t SETTINGS_VERSION_BITS[SETTINGS_RECORD_VERSION + 1] = {
+    0, // No version 0; LEGACY_SETTINGS_KEY holds what came before
+    SETTING_HEX_MODE | SETTING_POWER_MODE | SETTING_COLORIZE_DIGITS |
+        SETTING_GHOST_TIME | SETTING_GHOST_DATE | SETTING_HOURLY_VIBRATE |
+        SETTING_DISCONNECT_VIBRATE,
+    SETTING_ANIMATE_TRANSITIONS,
+    SETTING_POWER_GOVERNOR,
+    SETTING_SEND_TELEMETRY,
+};
+
+// Defaults, matching config.js
+#define POWER_THRESHOLDS_DEFAULT                                               \
+  ((PowerThresholds){.low_battery_percent = 30,                                \
+                     .critical_battery_percent = 10,                           \
+                     .burst_seconds = 5})
+
+// Records only ever grow; fields past what an older release wrote take
+// their defaults
+typedef struct SettingsRecord {
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t bits;
+  // Version 3 on
+  PowerThresholds power_thresholds;
+} SettingsRecord;
+#define SETTINGS_RECORD_V1_BYTES offsetof(SettingsRecord, power_thresholds)
+
+// The watch tells the phone what settings it runs, so the phone's record of
+// what it last sent can't outlive a reinstall; see send_settings_report()
+// The harness and the replay have no phone to tell
+#if !defined(BENCHMARK_MODE) && !defined(REPLAY_MODE)
+#define SETTINGS_REPORT_ENABLED
+#endif
+// A report the phone doesn't take (its JS may still be starting) is resent
+// this many times, waiting twice as long before each one
+#define SETTINGS_REPORT_RETRIES 3
+#define SETTINGS_REPORT_RETRY_FIRST_MS 2000
+
 typedef enum RowType {
   HOUR_OF_DAY,
   MINUTE_OF_HOUR,
@@ -153,228 +279,450 @@ typedef enum RowType {
   MONTH_OF_YEAR
 } RowType;
 
+// On-screen rows, top to bottom
+typedef enum RowSlot {
+  ROW_SLOT_HOURS,
+  ROW_SLOT_MINUTES,
+  ROW_SLOT_SECONDS_CONN_BATT,
+  ROW_SLOT_DAY_OF_WEEK,
+  ROW_SLOT_MONTH,
+  ROW_SLOT_DAY_OF_MONTH,
+  ROW_SLOT_COUNT
+} RowSlot;
+
+const int ROW_HEIGHTS_PX[ROW_SLOT_COUNT] = {
+    BIG_DIGIT_HEIGHT_PX,                   // Hours
+    BIG_DIGIT_HEIGHT_PX,                   // Minutes
+    SECONDS_BATT_CONN_ROW_TOTAL_HEIGHT_PX, // Seconds - Connected - Battery
+    SMALL_DIGIT_HEIGHT_PX,                 // Day of week
+    SMALL_DIGIT_HEIGHT_PX,                 // Month
+    SMALL_DIGIT_HEIGHT_PX};                // Day of month
+
+// The row surfaces' arena, in display lines: a cache and a back buffer for
+// every digit row, except where the heap is smallest for the pixel depth.
+// There only the time rows' fit, and date rows past that go uncached
+#if defined(PBL_PLATFORM_APLITE) || defined(PBL_PLATFORM_BASALT)
+#define ROW_ARENA_LINES (2 * 2 * BIG_DIGIT_HEIGHT_PX)
+#else
+#define ROW_ARENA_LINES                                                        \
+  (2 * ((2 * BIG_DIGIT_HEIGHT_PX) + (3 * SMALL_DIGIT_HEIGHT_PX)))
+#endif
+
+// Everything that changes a row's pixels is folded into its key, so a tick
+// only dirties the rows whose key moved since they were last drawn
+#define ROW_KEY_INVALID UINT32_MAX
+
+// A digit row whose value moves slides its cached pixels from the old x to
+// the new one over ROW_SLIDE_DURATION_MS, at most one frame per
+// ROW_SLIDE_FRAME_MS; no frame of the slide renders glyphs
+#define ROW_SLIDE_DURATION_MS 300
+#define ROW_SLIDE_FRAME_MS 33
+
+// A row changing at the next minute is drawn into its back buffer this long
+// after an idle tick, once that tick's own frame is on screen; one row per
+// tick, so no tick does more than a row's worth of extra drawing
+#define PRECOMPUTE_DELAY_MS 100
+
+// How long a frame that draws ghost trails may take before the quality
+// governor (see governor.h) trims them; aplite's slower CPU gets more slack
+#ifdef PBL_PLATFORM_APLITE
+#define FRAME_BUDGET_MS 50
+#else
+#define FRAME_BUDGET_MS 33
+#endif
+
+// Trail copies per row at each RenderQuality; 0 is uncapped
+static const int TRAIL_COPY_LIMITS[RENDER_QUALITY_COUNT] = {0, 0, 2, 1};
+// How many of each smear's noise dots it keeps at each RenderQuality, in %
+static const int NOISE_DOT_PERCENTS[RENDER_QUALITY_COUNT] = {100, 50, 25, 0};
+
+typedef struct RowState {
+  Layer *layer;
+  uint32_t rendered_key;
+  // Set for a redraw the key doesn't show, like a slide's next step; rows
+  // otherwise only draw when their key moves (see row_layer_update_callback)
+  bool is_dirty;
+  // Ghosted (or sliding) rows keep a copy of their finished pixels, valid
+  // for cached_key. Carved from the arena, like next_cache
+  GBitmap *cache;
+  uint32_t cached_key;
+  // Where the value was last drawn; digit rows only
+  int16_t rendered_x;
+  // While sliding: how far from rendered_x the cache started, and is now
+  int16_t slide_from_dx;
+  int16_t slide_dx;
+  // Back buffer: the row as the next minute will show it, drawn during the
+  // idle ticks before it and swapped in for cache when its key comes up
+  GBitmap *next_cache;
+  uint32_t next_key;
+  // Its layer moved since it last drew, so its padding may still show what
+  // was there; see reflow_rows()
+  bool is_moved;
+} RowState;
+
+typedef struct DisplayTime {
+  int hours;              // 0 - 23
+  int hour_display_value; // hours, adjusted for 12h style
+  bool is_24h_style;
+  int minutes;            // 0 - 59
+  int seconds;            // 0 - 59
+  int month;              // 1 - 12
+  int day_of_month;       // 1 - 31
+  int day_of_week;        // 1 - 7
+} DisplayTime;
+
 static Window *window;
-static Layer *layer;
+static Layer *background_layer;
+// The framebuffer keeps the last frame, so only rows that changed draw. Set
+// when that frame can't be trusted (layers moved, or something else drew
+// over them) to clear the whole screen and redraw every row
+static bool is_repaint_pending = true;
+static bool is_frame_repainting;
+static RowState rows[ROW_SLOT_COUNT];
+#ifdef BENCHMARK_MODE
+static Layer *frame_end_layer;
+#endif
 static Layer *window_layer;
 ClaySettings settings;
+static PowerThresholds power_thresholds;
 static GRect bounds;
 
-static GBitmap *big_numerals_bmps[BIG_HEX_DIGIT_COUNT];
-static GBitmap *small_numerals_bmps[SMALL_HEX_DIGIT_COUNT];
-static GBitmap *fades_htl_sz_amnt_bmps[2][2];
+static GBitmap *glyph_atlas_bmp;
+// Every glyph's palette (see glyphcache.h); ink is index 0
+static GColor glyph_palette[2];
+#ifdef PBL_COLOR
+// Pre-tinted copies of the glyphs for ColorizeDigits: sub-bitmaps of the same
+// atlas cells, one per tint, each pointing at its tint's palette. Filled in
+// as rows first draw them, and dropped again when colorizing turns off
+static GBitmap *big_glyph_variants[BIG_HEX_DIGIT_COUNT][BIG_GLYPH_TINT_COUNT];
+static GBitmap
+    *small_glyph_variants[SMALL_HEX_DIGIT_COUNT][SMALL_GLYPH_TINT_COUNT];
+static GColor big_glyph_tint_palettes[BIG_GLYPH_TINT_COUNT][2];
+static GColor small_glyph_tint_palettes[SMALL_GLYPH_TINT_COUNT][2];
+#endif
+// [is_small][is_more_smeared][variant]
+static GBitmap *noise_mask_bmps[2][2][NOISE_MASK_VARIANTS];
+static GColor noise_mask_palette[2];
 static GBitmap *charging_icon_bmp;
 static GBitmap *charging_icon_low_bmp;
-
-int rand_noise_src[NOISE_SRC_LEN]; // 16 bits * 512 = ~8KB
-
-long time_running = 0L;
+static GColor charging_icon_palette[2];
+// The seconds comb and battery bars at their fullest, drawn cut to width
+static GBitmap *seconds_strip_bmp;
+static GBitmap *battery_strip_bmp;
+static GColor seconds_strip_palette[2];
+static GColor battery_strip_palette[2];
+
+static DisplayTime display_time;
+
+// Set while a row is being drawn straight into the framebuffer (or into its
+// back buffer; see precompute_row())
+static FramebufferTarget direct_fb;
+static bool is_direct_fb_active;
+
+// Where the rows are for the height Timeline Quick View leaves the face, and
+// whether that height is changing; see reflow_rows()
+static const RowReflow *row_reflow;
+static bool is_reflowing;
+// The band the rows covered before any reflow since the last frame; the
+// background clears what of it they've moved off
+static int vacated_top;
+static int vacated_bottom;
+
+static time_t launch_time;
+#ifndef BENCHMARK_MODE
+// Fires on the quarter minutes in between minute ticks; see schedule_ticks()
+static AppTimer *quarter_timer;
+// Slides rows to their new x on a tick; see start_row_slides()
+static Animation *row_slide_animation;
+static uint32_t row_slide_frame_ms;
+// When the current frame started, and whether it has drawn a ghost trail
+static uint32_t frame_start_ms;
+static bool is_frame_ghosted;
+// Draws the next row ahead of the minute; see precompute_row()
+static AppTimer *precompute_timer;
+// The minute a precompute step last got nowhere for; see schedule_precompute()
+static time_t precompute_stalled_minute;
+#endif
+#ifdef SETTINGS_REPORT_ENABLED
+// Resends a report the phone didn't take; see send_settings_report()
+static AppTimer *settings_report_timer;
+static int settings_report_retries;
+#endif
+#ifdef SNAPSHOT_ENABLED
+// Up for the first frame of a launch that had a snapshot to show, until
+// launch_timer finishes the launch; see init()
+static Layer *snapshot_layer;
+static AppTimer *launch_timer;
+#endif
+// Whether finish_init() has run; a launch cut short while the snapshot is up
+// has none of what it allocates to free
+static bool is_init_finished;
 int is_charging = 0;
 bool is_connected = true;
 int battery_percent = 0;
 
+static int glyph_tint_base(RowType row_type) {
+  switch (row_type) {
+  case MINUTE_OF_HOUR:
+  case MONTH_OF_YEAR:
+    return GLYPH_SACCADE_STEPS;
+  case DAY_OF_MONTH:
+    return 2 * GLYPH_SACCADE_STEPS;
+  default: // HOUR_OF_DAY, DAY_OF_WEEK
+    return 0;
+  }
+}
+
+#ifdef PBL_COLOR
+static void init_glyph_tint_palettes(void) {
+  for (int t = 0; t < BIG_GLYPH_TINT_COUNT; t++) {
+    big_glyph_tint_palettes[t][0] =
+        BIG_GLYPH_SACCADES[t / GLYPH_SACCADE_STEPS][t % GLYPH_SACCADE_STEPS];
+    big_glyph_tint_palettes[t][1] = GColorClear;
+  }
+  for (int t = 0; t < SMALL_GLYPH_TINT_COUNT; t++) {
+    small_glyph_tint_palettes[t][0] =
+        SMALL_GLYPH_SACCADES[t / GLYPH_SACCADE_STEPS][t % GLYPH_SACCADE_STEPS];
+    small_glyph_tint_palettes[t][1] = GColorClear;
+  }
+}
+
+static GBitmap *glyph_variant(int value, bool is_small, int tint) {
+  GBitmap **variant = is_small ? &small_glyph_variants[value][tint]
+                               : &big_glyph_variants[value][tint];
+  if (!*variant) {
+    GBitmap *base = glyph_cache_get(value, is_small);
+    if (!base) {
+      return NULL;
+    }
+    *variant = gbitmap_create_as_sub_bitmap(base, gbitmap_get_bounds(base));
+    if (!*variant) {
+      return base; // Out of heap: draw it untinted rather than not at all
+    }
+    gbitmap_set_palette(*variant, is_small ? small_glyph_tint_palettes[tint]
+                                           : big_glyph_tint_palettes[tint],
+                        false);
+  }
+  return *variant;
+}
+
+static void release_glyph_variant_range(bool is_small, int first, int count) {
+  const int tints = is_small ? SMALL_GLYPH_TINT_COUNT : BIG_GLYPH_TINT_COUNT;
+  for (int i = first; i < first + count; i++) {
+    for (int t = 0; t < tints; t++) {
+      GBitmap **variant = is_small ? &small_glyph_variants[i][t]
+                                   : &big_glyph_variants[i][t];
+      if (*variant) {
+        gbitmap_destroy(*variant);
+        *variant = NULL;
+      }
+    }
+  }
+}
+
+static void release_glyph_variants(void) {
+  release_glyph_variant_range(false, 0, BIG_HEX_DIGIT_COUNT);
+  release_glyph_variant_range(true, 0, SMALL_HEX_DIGIT_COUNT);
+}
+#endif
+
+// Tinted variants point into their glyph's page, so they go with it
+static void handle_glyph_evict(bool is_small, int first, int count) {
+#ifdef PBL_COLOR
+  release_glyph_variant_range(is_small, first, count);
+#endif
+}
+
+static void release_unused_glyph_variants(void) {
+#ifdef PBL_COLOR
+  if (!settings.ColorizeDigits) {
+    release_glyph_variants();
+  }
+#endif
+}
+
+// Nothing here writes to a palette: every (glyph, tint) already has a bitmap
+// that draws in the right color
 static void draw_hex_char(GContext *ctx, int value, int x, int y, int w, int h,
-                          bool is_small, GColor color) {
-  const GBitmap *bmp =
-      is_small ? small_numerals_bmps[value] : big_numerals_bmps[value];
-  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
-  GColor *palette = gbitmap_get_palette(bmp);
-  palette[0] = settings.ColorizeDigits
-                   ? PBL_IF_COLOR_ELSE(color, FOREGROUND_COLOR)
-                   : FOREGROUND_COLOR;
-  palette[1] = GColorClear;
-  graphics_draw_bitmap_in_rect(ctx, bmp,
-                               (GRect){.origin = {x, y}, .size = {w, h}});
+                          bool is_small, int tint) {
+  if (x + w <= 0 || x >= PBL_DISPLAY_WIDTH) {
+    return; // Trail copy (or half of one) that is entirely off-screen
+  }
+#ifdef PBL_COLOR
+  GBitmap *bmp = settings.ColorizeDigits
+                     ? glyph_variant(value, is_small, tint)
+                     : glyph_cache_get(value, is_small);
+#else
+  GBitmap *bmp = glyph_cache_get(value, is_small);
+#endif
+  if (!bmp) {
+    return; // Its page couldn't be loaded; the rest of the row still draws
+  }
+  if (is_direct_fb_active) {
+    // Glyph ink is palette index 0, already holding the glyph's color
+    framebuffer_blit_1bit(&direct_fb, bmp, x, y, 0,
+                          gbitmap_get_palette(bmp)[0]);
+    return;
+  }
+  draw_list_bitmap(ctx, DRAW_PASS_BASE, bmp, GCompOpAssign,
+                   (GRect){.origin = {x, y}, .size = {w, h}});
+}
+
+// Picks a noise mask from where the smear sits in its row, so a given row
+// always gets the same noise (no shimmer, and the row cache stays valid)
+static int noise_mask_variant(RowType row_type, int trail_idx, int glyph_idx) {
+  return ((int)row_type * 3 + trail_idx * 2 + glyph_idx) &
+         (NOISE_MASK_VARIANTS - 1);
 }
 
 static void smear_character_at_position(GContext *ctx, int x, int y,
-                                        bool is_small, bool is_more_smeared) {
+                                        bool is_small, bool is_more_smeared,
+                                        int noise_variant) {
   const int char_w = is_small ? SMALL_DIGIT_WIDTH_PX : BIG_DIGIT_WIDTH_PX;
   const int char_h = is_small ? SMALL_DIGIT_HEIGHT_PX : BIG_DIGIT_HEIGHT_PX;
+  if (x + char_w <= 0) {
+    return;
+  }
+  PROFILE_BEGIN(PROFILE_SMEAR);
   GBitmap *smear_bmp =
-      fades_htl_sz_amnt_bmps[is_small ? 1 : 0][is_more_smeared ? 1 : 0];
-  // smear_bmp is a palettized 1 bit BMP
-  graphics_context_set_compositing_mode(ctx, GCompOpSet);
-  graphics_draw_bitmap_in_rect(
-      ctx, smear_bmp, (GRect){.origin = {x, y}, .size = {char_w, char_h}});
-
-  // So the smear isn't uniform, draw some BACKGROUND_COLOR dots
-  // on top of it
-  int noise_dots =
-      is_small ? SMALL_DIGIT_NOISE_PX_COUNT : BIG_DIGIT_NOISE_PX_COUNT;
-  int noise_src_idx = rand();
-  graphics_context_set_stroke_color(ctx, BACKGROUND_COLOR);
-  while (noise_dots > 0) {
-    const int x_dot =
-        x + ((rand_noise_src[noise_src_idx % NOISE_SRC_LEN]) % char_w);
-    noise_src_idx++;
-    const int y_dot =
-        y + ((rand_noise_src[noise_src_idx % NOISE_SRC_LEN]) % char_h);
-    graphics_draw_pixel(ctx, (GPoint){.x = x_dot, .y = y_dot});
-    noise_src_idx++;
-    noise_dots--;
-  }
-}
-
-static void render_hex_value(GContext *ctx, int value, int x, int y,
-                             bool use_small_font, bool is_double_wide,
-                             GColor color) {
-  bool is_rendering_as_hexadecimal = settings.HexMode;
-  const int char_w = use_small_font ? SMALL_DIGIT_WIDTH_PX : BIG_DIGIT_WIDTH_PX;
-  const int char_h =
-      use_small_font ? SMALL_DIGIT_HEIGHT_PX : BIG_DIGIT_HEIGHT_PX;
-  const int break_digit = is_rendering_as_hexadecimal ? 16 : 10;
-  if (is_double_wide) {
-    draw_hex_char(ctx, value / break_digit, x, y, char_w, char_h,
-                  use_small_font, color);
-    draw_hex_char(ctx, value % break_digit,
-                  x + char_w + INTERNAL_FONT_PADDING_PX, y, char_w, char_h,
-                  use_small_font, color);
+      noise_mask_bmps[is_small ? 1 : 0][is_more_smeared ? 1 : 0][noise_variant];
+  if (is_direct_fb_active) {
+    framebuffer_blit_1bit(&direct_fb, smear_bmp, x, y, 1, BACKGROUND_COLOR);
   } else {
-    draw_hex_char(ctx, value, x, y, char_w, char_h, use_small_font, color);
+    // smear_bmp is a palettized 1 bit BMP; set pixels punch BACKGROUND_COLOR
+    draw_list_bitmap(ctx, DRAW_PASS_OVERLAY, smear_bmp, GCompOpSet,
+                     (GRect){.origin = {x, y}, .size = {char_w, char_h}});
   }
+  PROFILE_END(PROFILE_SMEAR);
 }
 
-static void render_day_of_week_non_hex(GContext *ctx, int day_of_week, int x,
-                                       int y, GColor color) {
-  const int *id_indices = DAYS_OF_WEEK_RESOURCE_ID_INDICES[day_of_week - 1];
-  const int left_idx = id_indices[0];
-  const int right_idx = id_indices[1];
-  draw_hex_char(ctx, left_idx, x, y, SMALL_DIGIT_WIDTH_PX,
-                SMALL_DIGIT_HEIGHT_PX, true, color);
-  draw_hex_char(ctx, right_idx,
-                x + SMALL_DIGIT_WIDTH_PX + INTERNAL_FONT_PADDING_PX, y,
-                SMALL_DIGIT_WIDTH_PX, SMALL_DIGIT_HEIGHT_PX, true, color);
+// The settings, as far as the power governor currently allows them
+static bool is_ghosting(bool is_date_row) {
+  return (is_date_row ? settings.GhostDate : settings.GhostTime) &&
+         governor_tier() == POWER_TIER_FULL;
 }
 
-static void render_hex_row(GContext *ctx, int value, int x, int y,
-                           bool use_small_font, RowType row_type) {
+static bool is_live_seconds(void) {
+  return settings.PowerMode && governor_tier() == POWER_TIER_FULL;
+}
 
-  GColor(*color_saccade)[3];
-  switch (row_type) {
-  case HOUR_OF_DAY:
-    color_saccade = &HOURS_SACCADE;
-    break;
-  case MINUTE_OF_HOUR:
-    color_saccade = &MINUTES_SACCADE;
-    break;
-  case DAY_OF_WEEK:
-    color_saccade = &DAY_OF_WEEK_SACCADE;
-    break;
-  case DAY_OF_MONTH:
-    color_saccade = &DAY_OF_MONTH_SACCADE;
-    break;
-  case MONTH_OF_YEAR:
-    color_saccade = &MONTH_OF_YEAR_SACCADE;
-    break;
-  }
+// The harness keeps full quality, so its frames stay comparable run to run
+static RenderQuality render_quality(void) {
+#ifdef BENCHMARK_MODE
+  return RENDER_QUALITY_FULL;
+#else
+  return governor_quality();
+#endif
+}
 
-  bool is_rendering_as_hexadecimal = settings.HexMode;
-  bool is_special_case_day_of_week_render =
-      row_type == DAY_OF_WEEK && !is_rendering_as_hexadecimal;
+static void render_row_glyphs(GContext *ctx, const RowLayout *layout, int x,
+                              int y, bool use_small_font, int tint) {
   const int char_w = use_small_font ? SMALL_DIGIT_WIDTH_PX : BIG_DIGIT_WIDTH_PX;
-  const int slim_char_w =
-      use_small_font ? SMALL_DIGIT_SLIM_WIDTH_PX : BIG_DIGIT_SLIM_WIDTH_PX;
-  const bool is_double_wide =
-      (is_rendering_as_hexadecimal
-           ? value >= 16
-           : (value >= 10 || row_type == MINUTE_OF_HOUR)) ||
-      is_special_case_day_of_week_render;
-  const int total_block_w = (char_w * (is_double_wide ? 2 : 1)) +
-                            (is_double_wide ? INTERNAL_FONT_PADDING_PX : 0);
-
-  // If we're not "double wide" but the row is sometimes double wide (which is
-  // true for everything *but* day of week (not-special case) and month of year
-  // (not-hex), then we actually want to push ourselves forward +1 character
-  // Otherwise, we don't seem to make enough "progress" until we get into the
-  // double-character items because our eyes visually measure from dist-to-edge
-  bool is_single_char_only_row =
-      (row_type == DAY_OF_WEEK && is_rendering_as_hexadecimal) ||
-      (row_type == MONTH_OF_YEAR && is_rendering_as_hexadecimal);
-  bool is_double_row_with_only_slim_first_digit =
-      row_type == HOUR_OF_DAY ||
-      (row_type == DAY_OF_MONTH && is_rendering_as_hexadecimal);
-  if (!is_double_wide && !is_single_char_only_row) {
-    VERBOSE_LOG("Adjusting single character in row_type=%d forward",
-                (int)row_type);
-    const int char_padding =
-        is_double_row_with_only_slim_first_digit ? slim_char_w : char_w;
-    x += (char_padding + INTERNAL_FONT_PADDING_PX);
+  const int char_h =
+      use_small_font ? SMALL_DIGIT_HEIGHT_PX : BIG_DIGIT_HEIGHT_PX;
+#ifdef SWEEP_MODE
+  const int glyph_count =
+      use_small_font ? SMALL_HEX_DIGIT_COUNT : BIG_HEX_DIGIT_COUNT;
+  if (layout->glyphs[0] >= glyph_count ||
+      (layout->glyphs[1] != ROW_GLYPH_NONE &&
+       layout->glyphs[1] >= glyph_count)) {
+    harness_flag_draw("glyph index", x, y);
+  }
+#endif
+  draw_hex_char(ctx, layout->glyphs[0], x, y, char_w, char_h, use_small_font,
+                tint);
+  if (layout->glyphs[1] != ROW_GLYPH_NONE) {
+    draw_hex_char(ctx, layout->glyphs[1],
+                  x + char_w + INTERNAL_FONT_PADDING_PX, y, char_w, char_h,
+                  use_small_font, tint);
   }
+}
+
+// Where the value goes, and which glyphs make it up, was all worked out at
+// build time (see layout_tables.auto.h); this only draws it and its ghosts
+static void render_hex_row(GContext *ctx, const RowLayout *layout, int y,
+                           bool use_small_font, RowType row_type) {
+  PROFILE_BEGIN(PROFILE_HEX_ROW);
+  const int tint_base = glyph_tint_base(row_type);
+  const int char_w = use_small_font ? SMALL_DIGIT_WIDTH_PX : BIG_DIGIT_WIDTH_PX;
+  const bool is_double_wide = layout->glyphs[1] != ROW_GLYPH_NONE;
+  int x = layout->x;
 
   // First pass: the actual display value
-  if (!is_special_case_day_of_week_render) {
-    render_hex_value(ctx, value, x, y, use_small_font, is_double_wide,
-                     (*color_saccade)[0]);
-  } else {
-    render_day_of_week_non_hex(ctx, value, x, y, (*color_saccade)[0]);
+#ifdef SWEEP_MODE
+  // Only its ghost copies may be cut, and only by the left edge
+  const int block_w = layout->ghost_step - INTERNAL_FONT_PADDING_PX;
+  if (x < 0 || x + block_w > PBL_DISPLAY_WIDTH) {
+    harness_flag_draw("value off-screen", x, y);
   }
+#endif
+  render_row_glyphs(ctx, layout, x, y, use_small_font, tint_base);
 
-  bool should_ghost = (settings.GhostDate && use_small_font) ||
-                      (settings.GhostTime && !use_small_font);
-  if (!should_ghost) {
+  if (!is_ghosting(use_small_font)) {
+    PROFILE_END(PROFILE_HEX_ROW);
     return;
   }
 
-  const int jump_left_amount = total_block_w + INTERNAL_FONT_PADDING_PX;
+  const RenderQuality quality = render_quality();
+  const bool is_more_smeared = quality == RENDER_QUALITY_FULL;
+  const int trail_limit = TRAIL_COPY_LIMITS[quality];
+  const int total_block_w = layout->ghost_step - INTERNAL_FONT_PADDING_PX;
   int i = 1;
-  x -= jump_left_amount;
-  while (x >= -total_block_w) {
-    if (!is_special_case_day_of_week_render) {
-      render_hex_value(ctx, value, x, y, use_small_font, is_double_wide,
-                       (*color_saccade)[i]);
-    } else {
-      render_day_of_week_non_hex(ctx, value, x, y, (*color_saccade)[i]);
-    }
-    smear_character_at_position(ctx, x, y, use_small_font, true);
+  int trail_idx = 0;
+  x -= layout->ghost_step;
+  // A copy at exactly -total_block_w would end at x = 0, fully off-screen
+  while (x > -total_block_w && (!trail_limit || trail_idx < trail_limit)) {
+    render_row_glyphs(ctx, layout, x, y, use_small_font, tint_base + i);
+    smear_character_at_position(ctx, x, y, use_small_font, is_more_smeared,
+                                noise_mask_variant(row_type, trail_idx, 0));
     if (is_double_wide) {
       smear_character_at_position(ctx, x + INTERNAL_FONT_PADDING_PX + char_w, y,
-                                  use_small_font, true);
+                                  use_small_font, is_more_smeared,
+                                  noise_mask_variant(row_type, trail_idx, 1));
     }
-    x -= jump_left_amount;
+    x -= layout->ghost_step;
+    trail_idx++;
     i++;
     if (i > 2) {
       i = 0;
     }
   }
+  PROFILE_END(PROFILE_HEX_ROW);
 }
 
-static void layer_update_callback(Layer *me, GContext *ctx) {
-  VERBOSE_LOG("layer_update_callback()");
-
+static struct tm *get_display_time(void) {
+#ifdef BENCHMARK_MODE
+  return harness_time();
+#else
   time_t in_time_units;
   time(&in_time_units);
-  struct tm *curr_time = localtime(&in_time_units);
+  return localtime(&in_time_units);
+#endif
+}
 
+static bool get_is_24h_style(void) {
+#ifdef BENCHMARK_MODE
+  return harness_is_24h_style();
+#else
+  return clock_is_24h_style();
+#endif
+}
+
+static void fill_display_time(DisplayTime *out, const struct tm *curr_time) {
   // Time values are 0 aligned
-  int hours = curr_time->tm_hour;  // 0 - 23
-  int minutes = curr_time->tm_min; // 0 - 59
-  int seconds = curr_time->tm_sec; // 0 - 59
+  out->hours = curr_time->tm_hour;  // 0 - 23
+  out->minutes = curr_time->tm_min; // 0 - 59
+  out->seconds = curr_time->tm_sec; // 0 - 59
   // Date values are 1 aligned
-  int month = curr_time->tm_mon + 1;        // 1 - 12
-  int day_of_month = curr_time->tm_mday;    // 1 - 31
-  int day_of_week = curr_time->tm_wday + 1; // 1 - 7
-  bool is_24_hour_style = clock_is_24h_style();
-
-  VERBOSE_LOG("Time is: %d:%d:%d", hours, minutes, seconds);
+  out->month = curr_time->tm_mon + 1;        // 1 - 12
+  out->day_of_month = curr_time->tm_mday;    // 1 - 31
+  out->day_of_week = curr_time->tm_wday + 1; // 1 - 7
 
-  if (settings.HourlyVibrate && minutes == 0 && seconds == 0) {
-    vibes_long_pulse();
-  }
-
-  // Watchface is white-on-black
-  graphics_context_set_fill_color(ctx, BACKGROUND_COLOR);
-  graphics_fill_rect(ctx,
-                     (GRect){.origin = {0, 0},
-                             .size = {PBL_DISPLAY_WIDTH, PBL_DISPLAY_HEIGHT}},
-                     0, GCornerNone);
-
-  graphics_context_set_fill_color(ctx, FOREGROUND_COLOR);
+  VERBOSE_LOG("Time is: %d:%d:%d", out->hours, out->minutes, out->seconds);
 
-  int y_offset = EXTERNAL_ITEM_VERTICAL_PADDING_PX + EXTRA_VERTICAL_PADDING_PX;
-
-  // Draw hours in hex
-  int hour_display_value = hours;
-  if (!is_24_hour_style) {
+  out->is_24h_style = get_is_24h_style();
+  int hour_display_value = out->hours;
+  if (!out->is_24h_style) {
     if (hour_display_value > 11) {
       VERBOSE_LOG("Removing 12 from hours (12h style)");
       hour_display_value -= 12;
@@ -384,282 +732,1594 @@ static void layer_update_callback(Layer *me, GContext *ctx) {
       hour_display_value = 12;
     }
   }
-  float hour_pct_across_screen = (float)hours / 23.0F;
-  int hour_x_position =
-      EXTERNAL_ITEM_HORIZONTAL_PADDING_PX +
-      (hour_pct_across_screen * DOUBLE_WIDE_BIG_DIGIT_MOVEMENT_WIDTH_PX);
-  render_hex_row(ctx, hour_display_value, hour_x_position, y_offset, false,
-                 HOUR_OF_DAY);
-  y_offset += BIG_DIGIT_HEIGHT_PX + EXTERNAL_ITEM_VERTICAL_PADDING_PX;
-
-  // Draw the minutes in hex
-  float min_pct_across_screen = (float)minutes / 59.0F;
-  int min_x_position =
-      EXTERNAL_ITEM_HORIZONTAL_PADDING_PX +
-      (min_pct_across_screen * DOUBLE_WIDE_BIG_DIGIT_MOVEMENT_WIDTH_PX);
-  render_hex_row(ctx, minutes, min_x_position, y_offset, false, MINUTE_OF_HOUR);
-  y_offset += BIG_DIGIT_HEIGHT_PX + EXTERNAL_ITEM_VERTICAL_PADDING_PX;
-
-  // Draw the seconds with lines
-  graphics_context_set_stroke_color(ctx, FOREGROUND_COLOR);
-  int x_pos = SECONDS_BATT_CONN_ROW_LEFT_OFFSET_PX;
-  int seconds_dup = seconds;
-  while (seconds_dup > 0) {
-    graphics_draw_line(ctx, GPoint(x_pos, y_offset),
-                       GPoint(x_pos, y_offset + SECONDS_INDICATOR_HEIGHT_PX));
-    x_pos +=
-        (SECONDS_INDICATOR_WIDTH_PX + SECONDS_INDICATOR_INTERNAL_PADDING_W_PX);
-    seconds_dup--;
-  }
+  out->hour_display_value = hour_display_value;
+}
 
-  // Draw dot between seconds/battery (only if connected)
-  x_pos = SECONDS_BATT_CONN_ROW_LEFT_OFFSET_PX +
-          SECONDS_INDICATOR_TOTAL_WIDTH_PX + INTERNAL_ITEM_PADDING_PX;
-  if (is_connected) {
-    graphics_context_set_fill_color(ctx, CONNECTED_INDICATOR_COLOR);
-    graphics_fill_rect(
-        ctx,
-        (GRect){.origin = {x_pos, y_offset + CONN_ICON_OFFSET_INSIDE_ROW_PX},
-                .size = {CONNECTED_ICON_W_H_PX, CONNECTED_ICON_W_H_PX}},
-        1, GCornersAll);
+static void refresh_display_time(void) {
+  fill_display_time(&display_time, get_display_time());
+}
+
+static int displayed_seconds(void) {
+  if (governor_tier() == POWER_TIER_STATIC) {
+    return 0; // Nothing may move between minute ticks
   }
-  graphics_context_set_fill_color(ctx, FOREGROUND_COLOR);
-  x_pos += (CONNECTED_ICON_W_H_PX + INTERNAL_ITEM_PADDING_PX);
+  // Low power mode only moves the seconds comb every 15 seconds
+  return is_live_seconds()
+             ? display_time.seconds
+             : display_time.seconds - (display_time.seconds % 15);
+}
 
-  // Draw battery with lines
-  graphics_context_set_stroke_color(ctx, BATTERY_COLOR);
-  if (!is_charging) {
-    float batt_pct_across_section = (float)battery_percent / 100.0F;
-    int battery_lines = (int)round(batt_pct_across_section * 5.0F);
-    int battery_x_pos = x_pos;
-    while (battery_lines > 0) {
-      graphics_draw_line(
-          ctx, GPoint(battery_x_pos, y_offset + BATT_OFFSET_INSIDE_ROW_PX),
-          GPoint(battery_x_pos,
-                 y_offset + BATT_OFFSET_INSIDE_ROW_PX + BATTERY_BAR_HEIGHT_PX));
-      battery_x_pos +=
-          (BATTERY_BAR_WIDTH_PX + BATTERY_BAR_INTERNAL_PADDING_W_PX);
-      battery_lines--;
-    }
-  } else { // Draw charging image
-    graphics_context_set_compositing_mode(ctx, GCompOpAssignInverted);
-    if (seconds % 2) {
-      graphics_draw_bitmap_in_rect(
-          ctx, charging_icon_low_bmp,
-          (GRect){.origin = {x_pos, y_offset + BATT_OFFSET_INSIDE_ROW_PX},
-                  .size = {CHARGING_ICON_WIDTH_PX, CHARGING_ICON_HEIGHT_PX}});
-    } else {
-      graphics_draw_bitmap_in_rect(
-          ctx, charging_icon_bmp,
-          (GRect){.origin = {x_pos, y_offset + BATT_OFFSET_INSIDE_ROW_PX},
-                  .size = {CHARGING_ICON_WIDTH_PX, CHARGING_ICON_HEIGHT_PX}});
-    }
+static int battery_bar_count(void) {
+  const int percent =
+      battery_percent < 0 ? 0 : (battery_percent > 100 ? 100 : battery_percent);
+  return BATTERY_BAR_COUNTS[percent];
+}
+
+// Quality only changes ghost trails, so it only moves ghosted rows' keys
+static uint32_t digit_row_key(int value, int position, bool is_ghosted) {
+  return (uint32_t)value | ((uint32_t)position << 8) |
+         ((uint32_t)settings.HexMode << 16) |
+         ((uint32_t)settings.ColorizeDigits << 17) |
+         ((uint32_t)is_ghosted << 18) |
+         (is_ghosted ? (uint32_t)render_quality() << 19 : 0);
+}
+
+static uint32_t compute_row_key(RowSlot slot) {
+  switch (slot) {
+  case ROW_SLOT_HOURS:
+    return digit_row_key(display_time.hour_display_value, display_time.hours,
+                         is_ghosting(false));
+  case ROW_SLOT_MINUTES:
+    return digit_row_key(display_time.minutes, display_time.minutes,
+                         is_ghosting(false));
+  case ROW_SLOT_SECONDS_CONN_BATT:
+    // Seconds also cover the charging icon's blink phase
+    return (uint32_t)displayed_seconds() | ((uint32_t)is_connected << 8) |
+           ((uint32_t)(is_charging != 0) << 9) |
+           ((uint32_t)battery_bar_count() << 10);
+  case ROW_SLOT_DAY_OF_WEEK:
+    return digit_row_key(display_time.day_of_week, display_time.day_of_week,
+                         is_ghosting(true));
+  case ROW_SLOT_MONTH:
+    return digit_row_key(display_time.month, display_time.month,
+                         is_ghosting(true));
+  case ROW_SLOT_DAY_OF_MONTH:
+    return digit_row_key(display_time.day_of_month, display_time.day_of_month,
+                         is_ghosting(true));
+  default:
+    return ROW_KEY_INVALID;
   }
-  graphics_context_set_stroke_color(ctx, FOREGROUND_COLOR);
+}
 
-  y_offset +=
-      SECONDS_BATT_CONN_ROW_TOTAL_HEIGHT_PX + EXTERNAL_ITEM_VERTICAL_PADDING_PX;
+static void mark_row_dirty(RowState *row) {
+  row->is_dirty = true;
+  layer_mark_dirty(row->layer);
+}
 
-  // Draw day of week (1 - 7)
-  float dow_pct_across_screen = (float)(day_of_week - 1) / 6.0F;
-  int dow_x_position =
-      EXTERNAL_ITEM_HORIZONTAL_PADDING_PX +
-      (dow_pct_across_screen *
-       (settings.HexMode ? SINGLE_WIDE_SMALL_DIGIT_MOVEMENT_WIDTH_PX
-                         : DOUBLE_WIDE_SMALL_DIGIT_MOVEMENT_WIDTH_PX));
-  render_hex_row(ctx, day_of_week, dow_x_position, y_offset, true, DAY_OF_WEEK);
-  y_offset += SMALL_DIGIT_HEIGHT_PX + EXTERNAL_ITEM_VERTICAL_PADDING_PX;
+static void request_full_repaint(void) {
+  is_repaint_pending = true;
+  layer_mark_dirty(background_layer);
+}
 
-  // Draw month (1 - 12)
-  float month_pct_across_screen = (float)month / 12.0F;
-  int month_x_position =
-      EXTERNAL_ITEM_HORIZONTAL_PADDING_PX +
-      (month_pct_across_screen * SINGLE_WIDE_SMALL_DIGIT_MOVEMENT_WIDTH_PX);
-  render_hex_row(ctx, month, month_x_position, y_offset, true, MONTH_OF_YEAR);
-  y_offset += SMALL_DIGIT_HEIGHT_PX + EXTERNAL_ITEM_VERTICAL_PADDING_PX;
+// Marks only the rows whose key moved since they were last drawn
+static void refresh_rows(void) {
+  refresh_display_time();
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    if (compute_row_key(i) != rows[i].rendered_key) {
+      VERBOSE_LOG("Row %d changed", i);
+      layer_mark_dirty(rows[i].layer);
+    }
+  }
+}
 
-  // Draw day of month (1 - 31)
-  float dom_pct_across_screen = (float)day_of_month / 31.0F;
-  int dom_x_position =
-      EXTERNAL_ITEM_HORIZONTAL_PADDING_PX +
-      (dom_pct_across_screen * DOUBLE_WIDE_SMALL_DIGIT_MOVEMENT_WIDTH_PX);
-  render_hex_row(ctx, day_of_month, dom_x_position, y_offset, true,
-                 DAY_OF_MONTH);
+// Heights below the table's only clip the rows it has for its lowest
+static const RowReflow *reflow_for_height(int height) {
+  if (height > PBL_DISPLAY_HEIGHT) {
+    height = PBL_DISPLAY_HEIGHT;
+  } else if (height < LAYOUT_TABLES_REFLOW_MIN_HEIGHT_PX) {
+    height = LAYOUT_TABLES_REFLOW_MIN_HEIGHT_PX;
+  }
+  return &ROW_REFLOWS[height - LAYOUT_TABLES_REFLOW_MIN_HEIGHT_PX];
+}
 
-  VERBOSE_LOG("layer_update_callback() complete");
+static void invalidate_rows(void) {
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    rows[i].rendered_key = ROW_KEY_INVALID;
+  }
+  refresh_rows();
 }
 
-static void handle_bluetooth(bool connected) {
-  is_connected = connected;
-  if (settings.DisconnectVibrate && time_running > 5) {
-    vibes_long_pulse();
+static void end_direct_rendering(GContext *ctx) {
+  if (is_direct_fb_active) {
+    framebuffer_end(ctx, &direct_fb);
+    is_direct_fb_active = false;
   }
 }
 
-static void handle_battery(BatteryChargeState charge_state) {
-  is_charging = charge_state.is_charging;
-  battery_percent = charge_state.charge_percent;
+// The first count lines of a comb strip: one blit, cut to width, in place of
+// a graphics_draw_line per line
+static void draw_strip(GContext *ctx, GBitmap *strip, int x, int y,
+                       int count, int pitch) {
+  if (!strip) {
+    return; // Out of heap at init
+  }
+  GRect rect = gbitmap_get_bounds(strip);
+  rect.origin = GPoint(x, y);
+  rect.size.w = ((count - 1) * pitch) + 1;
+  draw_list_bitmap(ctx, DRAW_PASS_BASE, strip, GCompOpSet, rect);
 }
 
-static void handle_second_tick(struct tm *tick_time, TimeUnits units_changed) {
-  time_running++;
-  if (settings.PowerMode || tick_time->tm_sec % 15 == 0) {
-    layer_mark_dirty(layer);
+static void render_seconds_comb(GContext *ctx, int x_pos, int y_offset) {
+  PROFILE_BEGIN(PROFILE_SECONDS_COMB);
+  int seconds_dup = displayed_seconds();
+  if (is_direct_fb_active) {
+    // graphics_draw_line includes both end points, hence the + 1
+    framebuffer_draw_comb(
+        &direct_fb, x_pos, y_offset, SECONDS_INDICATOR_HEIGHT_PX + 1,
+        seconds_dup,
+        SECONDS_INDICATOR_WIDTH_PX + SECONDS_INDICATOR_INTERNAL_PADDING_W_PX,
+        FOREGROUND_COLOR);
+  } else if (seconds_dup > 0) {
+    draw_strip(ctx, seconds_strip_bmp, x_pos, y_offset, seconds_dup,
+               SECONDS_INDICATOR_WIDTH_PX +
+                   SECONDS_INDICATOR_INTERNAL_PADDING_W_PX);
   }
+  PROFILE_END(PROFILE_SECONDS_COMB);
 }
 
-static void inbox_received_callback(DictionaryIterator *iterator,
-                                    void *context) {
-  VERBOSE_LOG("Inbox message received");
-  Tuple *hex_mode_tuple = dict_find(iterator, MESSAGE_KEY_HexMode);
-  Tuple *power_mode_tuple = dict_find(iterator, MESSAGE_KEY_PowerMode);
-  Tuple *colorize_digits_tuple =
-      dict_find(iterator, MESSAGE_KEY_ColorizeDigits);
-  Tuple *ghost_time_tuple = dict_find(iterator, MESSAGE_KEY_GhostTime);
-  Tuple *ghost_date_tuple = dict_find(iterator, MESSAGE_KEY_GhostDate);
-  Tuple *hourly_vibrate_tuple = dict_find(iterator, MESSAGE_KEY_HourlyVibrate);
-  Tuple *disconnect_vibrate_tuple =
-      dict_find(iterator, MESSAGE_KEY_DisconnectVibrate);
-  if (hex_mode_tuple) {
-    settings.HexMode = hex_mode_tuple->value->int32 == 1;
+static void render_battery_bars(GContext *ctx, int x_pos, int y_offset) {
+  int battery_lines = battery_bar_count();
+  if (is_direct_fb_active) {
+    framebuffer_draw_comb(&direct_fb, x_pos,
+                          y_offset + BATT_OFFSET_INSIDE_ROW_PX,
+                          BATTERY_BAR_HEIGHT_PX + 1, battery_lines,
+                          BATTERY_BAR_WIDTH_PX +
+                              BATTERY_BAR_INTERNAL_PADDING_W_PX,
+                          BATTERY_COLOR);
+    return;
   }
-  if (power_mode_tuple) {
-    settings.PowerMode = power_mode_tuple->value->int32 == 1;
+  if (battery_lines > 0) {
+    draw_strip(ctx, battery_strip_bmp, x_pos,
+               y_offset + BATT_OFFSET_INSIDE_ROW_PX, battery_lines,
+               BATTERY_BAR_WIDTH_PX + BATTERY_BAR_INTERNAL_PADDING_W_PX);
+  }
+}
+
+static void render_seconds_conn_batt_row(GContext *ctx, int y_offset) {
+  const int seconds_x_pos = SECONDS_BATT_CONN_ROW_LEFT_OFFSET_PX;
+  const int conn_x_pos = SECONDS_BATT_CONN_ROW_LEFT_OFFSET_PX +
+                         SECONDS_INDICATOR_TOTAL_WIDTH_PX +
+                         INTERNAL_ITEM_PADDING_PX;
+  const int batt_x_pos =
+      conn_x_pos + CONNECTED_ICON_W_H_PX + INTERNAL_ITEM_PADDING_PX;
+
+  // Draw the seconds and battery with lines
+  render_seconds_comb(ctx, seconds_x_pos, y_offset);
+  if (!is_charging) {
+    render_battery_bars(ctx, batt_x_pos, y_offset);
   }
-  if (colorize_digits_tuple) {
-    settings.ColorizeDigits = colorize_digits_tuple->value->int32 == 1;
+
+  // The connection dot and charging icon always go through the SDK
+  // Draw dot between seconds/battery (only if connected)
+  if (is_connected) {
+    draw_list_fill_rect(
+        ctx, DRAW_PASS_BASE, CONNECTED_INDICATOR_COLOR,
+        (GRect){.origin = {conn_x_pos,
+                           y_offset + CONN_ICON_OFFSET_INSIDE_ROW_PX},
+                .size = {CONNECTED_ICON_W_H_PX, CONNECTED_ICON_W_H_PX}},
+        1, GCornersAll);
   }
-  if (ghost_time_tuple) {
-    settings.GhostTime = ghost_time_tuple->value->int32 == 1;
+
+  if (is_charging) { // Draw charging image
+    draw_list_bitmap(
+        ctx, DRAW_PASS_BASE,
+        displayed_seconds() % 2 ? charging_icon_low_bmp : charging_icon_bmp,
+        GCompOpAssign,
+        (GRect){.origin = {batt_x_pos, y_offset + BATT_OFFSET_INSIDE_ROW_PX},
+                .size = {CHARGING_ICON_WIDTH_PX, CHARGING_ICON_HEIGHT_PX}});
   }
-  if (ghost_date_tuple) {
-    settings.GhostDate = ghost_date_tuple->value->int32 == 1;
+}
+
+#ifndef BENCHMARK_MODE
+static uint32_t now_ms(void) {
+  time_t seconds;
+  uint16_t millis;
+  time_ms(&seconds, &millis);
+  return ((uint32_t)seconds * 1000) + millis;
+}
+#endif
+
+// Below the last row the reflow shows, padding included
+static int reflow_bottom(const RowReflow *reflow) {
+  int y = reflow->top;
+  for (int i = 0; i < reflow->row_count; i++) {
+    y += ROW_HEIGHTS_PX[i] + reflow->padding;
   }
-  if (hourly_vibrate_tuple) {
-    settings.HourlyVibrate = hourly_vibrate_tuple->value->int32 == 1;
+  return y;
+}
+
+static void clear_band(GContext *ctx, int top, int bottom) {
+  if (top < bottom) {
+    graphics_fill_rect(ctx,
+                       (GRect){.origin = {0, top},
+                               .size = {PBL_DISPLAY_WIDTH, bottom - top}},
+                       0, GCornerNone);
   }
-  if (disconnect_vibrate_tuple) {
-    settings.DisconnectVibrate = disconnect_vibrate_tuple->value->int32 == 1;
+}
+
+// The background draws first in every frame, and the date's last row last.
+// It only clears the screen for a full repaint; rows clear their own area
+static void background_layer_update_callback(Layer *me, GContext *ctx) {
+  VERBOSE_LOG("background_layer_update_callback()");
+#ifdef BENCHMARK_MODE
+  harness_frame_begin();
+#else
+  frame_start_ms = now_ms();
+  is_frame_ghosted = false;
+#endif
+#ifdef REPLAY_MODE
+  replay_frame_drawn();
+#endif
+  is_frame_repainting = is_repaint_pending;
+  is_repaint_pending = false;
+  const bool is_vacated = vacated_top < vacated_bottom;
+  if (!is_frame_repainting && !is_vacated) {
+    return;
   }
-  if (hex_mode_tuple || power_mode_tuple || colorize_digits_tuple ||
-      ghost_time_tuple || ghost_date_tuple || hourly_vibrate_tuple ||
-      disconnect_vibrate_tuple) {
-    persist_write_data(SETTINGS_KEY, &settings, sizeof(ClaySettings));
-    layer_mark_dirty(layer);
+  TELEMETRY_UPDATE_BEGIN();
+
+  // Watchface is white-on-black
+  graphics_context_set_fill_color(ctx, BACKGROUND_COLOR);
+  if (is_frame_repainting) {
+    clear_band(ctx, 0, PBL_DISPLAY_HEIGHT);
+  } else {
+    // The rows draw over the rest of the band themselves
+    clear_band(ctx, vacated_top, row_reflow->top);
+    clear_band(ctx, reflow_bottom(row_reflow), vacated_bottom);
   }
+  vacated_top = vacated_bottom = 0;
+  TELEMETRY_UPDATE_END(true);
 }
 
-static void inbox_dropped_callback(AppMessageResult reason, void *context) {
-  APP_LOG(APP_LOG_LEVEL_ERROR, "Inbox message dropped: %d", (int)reason);
+// What a digit row shows right now; NULL for the seconds row
+static const RowLayout *current_row_layout(RowSlot slot) {
+  const int is_hex = settings.HexMode ? 1 : 0;
+  switch (slot) {
+  case ROW_SLOT_HOURS:
+    return &HOURS_LAYOUT[is_hex][display_time.is_24h_style ? 0 : 1]
+                        [display_time.hours];
+  case ROW_SLOT_MINUTES:
+    return &MINUTES_LAYOUT[is_hex][display_time.minutes];
+  case ROW_SLOT_DAY_OF_WEEK:
+    return &DAY_OF_WEEK_LAYOUT[is_hex][display_time.day_of_week - 1];
+  case ROW_SLOT_MONTH:
+    return &MONTH_LAYOUT[is_hex][display_time.month - 1];
+  case ROW_SLOT_DAY_OF_MONTH:
+    return &DAY_OF_MONTH_LAYOUT[is_hex][display_time.day_of_month - 1];
+  default:
+    return NULL;
+  }
 }
 
-static GBitmap *load_resource_with_fg_color(int res_id, GColor color) {
-  GBitmap *res_bmp = gbitmap_create_with_resource(res_id);
-  GBitmap *bmp_copy = gbitmap_create_palettized_from_1bit(res_bmp);
-  GColor *palette = gbitmap_get_palette(bmp_copy);
-  palette[0] = GColorClear;
-  palette[1] = color;
-  gbitmap_destroy(res_bmp);
-  return bmp_copy;
+static void render_digit_row(GContext *ctx, RowSlot slot) {
+  switch (slot) {
+  case ROW_SLOT_HOURS:
+    render_hex_row(ctx, current_row_layout(slot), 0, false, HOUR_OF_DAY);
+    break;
+  case ROW_SLOT_MINUTES:
+    render_hex_row(ctx, current_row_layout(slot), 0, false, MINUTE_OF_HOUR);
+    break;
+  case ROW_SLOT_DAY_OF_WEEK:
+    render_hex_row(ctx, current_row_layout(slot), 0, true, DAY_OF_WEEK);
+    break;
+  case ROW_SLOT_MONTH:
+    render_hex_row(ctx, current_row_layout(slot), 0, true, MONTH_OF_YEAR);
+    break;
+  case ROW_SLOT_DAY_OF_MONTH:
+    render_hex_row(ctx, current_row_layout(slot), 0, true, DAY_OF_MONTH);
+    break;
+  default:
+    break;
+  }
 }
 
-void init() {
-  VERBOSE_LOG("Init'ing");
+// Row layers draw at y = 0; each one's frame starts at the row's top edge
+static void render_row(GContext *ctx, Layer *me, RowSlot slot) {
+#ifdef DIRECT_FRAMEBUFFER_RENDERING
+  // Falls back to graphics_* if the framebuffer isn't in the expected format
+  is_direct_fb_active =
+      framebuffer_begin(ctx, layer_get_frame(me).origin, &direct_fb);
+#endif
 
-  window = window_create();
-  window_stack_push(window, true);
+  if (slot == ROW_SLOT_SECONDS_CONN_BATT) {
+    render_seconds_conn_batt_row(ctx, 0);
+  } else {
+    render_digit_row(ctx, slot);
+  }
+  end_direct_rendering(ctx);
+  draw_list_flush(ctx);
+}
 
-  app_message_register_inbox_received(inbox_received_callback);
-  app_message_register_inbox_dropped(inbox_dropped_callback);
+static bool is_row_ghosted(RowSlot slot) {
+  switch (slot) {
+  case ROW_SLOT_HOURS:
+  case ROW_SLOT_MINUTES:
+    return is_ghosting(false);
+  case ROW_SLOT_DAY_OF_WEEK:
+  case ROW_SLOT_MONTH:
+  case ROW_SLOT_DAY_OF_MONTH:
+    return is_ghosting(true);
+  default:
+    return false;
+  }
+}
 
-  const int inbox_size = 256;
-  const int outbox_size = 128;
-  app_message_open(inbox_size, outbox_size);
+// Slides blit the cache, so every digit row keeps one while they're enabled
+// So do reflows, so each frame of the system's animation only moves layers
+static bool is_row_cached(RowSlot slot) {
+  return is_row_ghosted(slot) ||
+         ((settings.AnimateTransitions || is_reflowing) &&
+          slot != ROW_SLOT_SECONDS_CONN_BATT);
+}
 
-  // Defaults, matching config.js
-  settings.HexMode = true;
-  settings.PowerMode = true;
-  settings.ColorizeDigits = false;
-  settings.GhostTime = true;
-  settings.GhostDate = false;
-  settings.HourlyVibrate = false;
-  settings.DisconnectVibrate = true;
-  // If more keys were added post-release, this would need to be updated
-  if (persist_read_data(SETTINGS_KEY, &settings, sizeof(settings)) ==
-      E_DOES_NOT_EXIST) {
-    APP_LOG(APP_LOG_LEVEL_ERROR, "Failed to read settings! Writing defaults");
-    persist_write_data(SETTINGS_KEY, &settings, sizeof(settings));
-  }
-
-  // Init the layer for display the image
-  window_layer = window_get_root_layer(window);
-  bounds = layer_get_frame(window_layer);
-  layer = layer_create(bounds);
-  layer_set_update_proc(layer, layer_update_callback);
-  layer_add_child(window_layer, layer);
-
-  for (int i = 0; i < BIG_HEX_DIGIT_COUNT; i++) {
-    big_numerals_bmps[i] = load_resource_with_fg_color(
-        BIG_NUMBER_RESOURCE_IDS[i], FOREGROUND_COLOR);
-  }
-  for (int i = 0; i < SMALL_HEX_DIGIT_COUNT; i++) {
-    small_numerals_bmps[i] = load_resource_with_fg_color(
-        SMALL_NUMBER_RESOURCE_IDS[i], FOREGROUND_COLOR);
-  }
-  charging_icon_bmp = gbitmap_create_with_resource(RESOURCE_ID_CHARGING_ICON);
-  charging_icon_low_bmp =
-      gbitmap_create_with_resource(RESOURCE_ID_CHARGING_ICON_LOW);
-  fades_htl_sz_amnt_bmps[0][0] =
-      load_resource_with_fg_color(RESOURCE_ID_SMEAR_25, BACKGROUND_COLOR);
-  fades_htl_sz_amnt_bmps[0][1] =
-      load_resource_with_fg_color(RESOURCE_ID_SMEAR_125, BACKGROUND_COLOR);
-  fades_htl_sz_amnt_bmps[1][0] =
-      load_resource_with_fg_color(RESOURCE_ID_SMEAR_SMALL_25, BACKGROUND_COLOR);
-  fades_htl_sz_amnt_bmps[1][1] = load_resource_with_fg_color(
-      RESOURCE_ID_SMEAR_SMALL_125, BACKGROUND_COLOR);
-
-  for (int i = 0; i < NOISE_SRC_LEN; i++) {
-    rand_noise_src[i] = rand();
+// The row was just drawn into the framebuffer, so copy it out from there;
+// the SDK has no way to point a GContext at an offscreen bitmap
+static void store_row_cache(GContext *ctx, Layer *me, RowSlot slot,
+                            uint32_t key) {
+  RowState *row = &rows[slot];
+  GBitmap *fb = graphics_capture_frame_buffer(ctx);
+  if (!fb) {
+    return;
+  }
+  if (!row->cache) {
+    row->cache = arena_carve(ROW_HEIGHTS_PX[slot]);
+    if (!row->cache && arena_lines_free() >= ROW_HEIGHTS_PX[slot]) {
+      // The lines are there but not the heap for the sub-bitmap. The row is
+      // drawn and flushed, so no queued draw needs a glyph page; whatever
+      // draws next loads its pages again
+      glyph_cache_trim();
+      row->cache = arena_carve(ROW_HEIGHTS_PX[slot]);
+    }
+    if (!row->cache) {
+      VERBOSE_LOG("No room for row %d cache", (int)slot);
+      graphics_release_frame_buffer(ctx, fb);
+      return;
+    }
   }
 
-  VERBOSE_LOG("Init'd all resources");
+  const int fb_y = layer_get_frame(me).origin.y;
+  const int fb_stride = gbitmap_get_bytes_per_row(fb);
+  const int cache_stride = gbitmap_get_bytes_per_row(row->cache);
+  const int row_bytes = fb_stride < cache_stride ? fb_stride : cache_stride;
+  const uint8_t *fb_data = gbitmap_get_data(fb);
+  uint8_t *cache_data = arena_surface_data(row->cache);
+  for (int y = 0; y < ROW_HEIGHTS_PX[slot]; y++) {
+    memcpy(cache_data + (y * cache_stride), fb_data + ((fb_y + y) * fb_stride),
+           row_bytes);
+  }
+  graphics_release_frame_buffer(ctx, fb);
+  row->cached_key = key;
+}
 
-  srand(time(NULL));
+// Only forgets them: the arena takes every surface back at once
+static void release_row_cache(RowSlot slot) {
+  rows[slot].cache = NULL;
+  rows[slot].cached_key = ROW_KEY_INVALID;
+  rows[slot].next_cache = NULL;
+  rows[slot].next_key = ROW_KEY_INVALID;
+}
 
-  tick_timer_service_subscribe(SECOND_UNIT, &handle_second_tick);
-  battery_state_service_subscribe(&handle_battery);
-  bluetooth_connection_service_subscribe(&handle_bluetooth);
-  handle_bluetooth(bluetooth_connection_service_peek());
-  handle_battery(battery_state_service_peek());
+static void release_row_surfaces(void) {
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    release_row_cache(i);
+  }
+  arena_reset();
+}
 
-  layer_mark_dirty(layer);
+// When the row was drawn ahead of this key, its back buffer becomes the cache
+// (and the old cache the next back buffer), so the frame is only a blit
+static void swap_in_next_cache(RowState *row, uint32_t key) {
+  if (!row->next_cache || row->next_key != key || row->cached_key == key) {
+    return;
+  }
+  GBitmap *old_cache = row->cache;
+  row->cache = row->next_cache;
+  row->cached_key = key;
+  row->next_cache = old_cache;
+  row->next_key = ROW_KEY_INVALID;
+}
 
-  VERBOSE_LOG("Done init'ing");
+// Caches of rows that stopped ghosting (and sliding) would never be read.
+// The arena can't take back one row's surfaces alone, so they all go, and
+// the rows still cached carve theirs again as they next draw
+static void release_unused_row_caches(void) {
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    if (!is_row_cached(i) && (rows[i].cache || rows[i].next_cache)) {
+      release_row_surfaces();
+      return;
+    }
+  }
 }
 
-void deinit() {
-  VERBOSE_LOG("Deinit'ing");
+// The cache's own size, at the row layer's origin; its bounds are where it
+// sits in the arena
+static GRect row_cache_rect(const RowState *row) {
+  return (GRect){.size = gbitmap_get_bounds(row->cache).size};
+}
 
-  tick_timer_service_unsubscribe();
-  battery_state_service_unsubscribe();
-  bluetooth_connection_service_unsubscribe();
+// At slide_dx, cut to the row; the caller clears whatever that uncovers
+static void draw_row_cache(GContext *ctx, const RowState *row) {
+  GRect frame = row_cache_rect(row);
+  const int right = frame.size.w;
+  frame.origin.x += row->slide_dx;
+  graphics_context_set_compositing_mode(ctx, GCompOpAssign);
+  draw_bitmap_cut(ctx, row->cache, frame, right);
+}
+
+#ifdef SNAPSHOT_ENABLED
+static uint32_t settings_to_bits(const ClaySettings *from);
+
+static uint32_t snapshot_minute(void) {
+#ifdef BENCHMARK_MODE
+  return 0; // Harness frames show made-up times
+#else
+  return (uint32_t)(time(NULL) / 60);
+#endif
+}
+
+// Everything but the time that decides what a frame shows
+static uint32_t snapshot_key(void) {
+#ifdef BENCHMARK_MODE
+  // Only another harness run may show a harness frame
+  return SNAPSHOT_KEY_HARNESS;
+#else
+  return (settings_to_bits(&settings) & SETTINGS_RENDER_BITS) |
+         (clock_is_24h_style() ? SNAPSHOT_KEY_24H : 0);
+#endif
+}
 
-  for (int i = 0; i < BIG_HEX_DIGIT_COUNT; i++) {
-    gbitmap_destroy(big_numerals_bmps[i]);
+// The context the last whole frame drew into, while that frame is one a
+// relaunch would show. Nothing is encoded until deinit(): the framebuffer
+// still holds that frame then
+static GContext *snapshot_ctx;
+static uint32_t snapshot_frame_minute;
+static uint32_t snapshot_frame_key;
+
+static void note_snapshot_frame(GContext *ctx) {
+  snapshot_ctx = NULL;
+  if (row_reflow != reflow_for_height(PBL_DISPLAY_HEIGHT)) {
+    return; // A relaunch lays the rows out unobstructed
   }
-  for (int i = 0; i < SMALL_HEX_DIGIT_COUNT; i++) {
-    gbitmap_destroy(small_numerals_bmps[i]);
+#ifndef BENCHMARK_MODE
+  if (row_slide_animation) {
+    return; // Mid-slide rows aren't where the minute leaves them
   }
-  for (int i = 0; i < 2; i++) {
-    for (int j = 0; j < 2; j++) {
-      gbitmap_destroy(fades_htl_sz_amnt_bmps[i][j]);
+#endif
+  snapshot_ctx = ctx;
+  snapshot_frame_minute = snapshot_minute();
+  snapshot_frame_key = snapshot_key();
+}
+#endif
+
+static void clear_row(GContext *ctx, Layer *me) {
+  graphics_context_set_fill_color(ctx, BACKGROUND_COLOR);
+  graphics_fill_rect(ctx, layer_get_bounds(me), 0, GCornerNone);
+}
+
+static void draw_row(GContext *ctx, Layer *me, RowSlot slot, uint32_t key) {
+  TELEMETRY_UPDATE_BEGIN();
+  RowState *row = &rows[slot];
+  row->is_dirty = false;
+  swap_in_next_cache(row, key);
+  const bool is_cache_hit = row->cache && row->cached_key == key;
+  // A cache covers its row's full width, so only a slide (or the padding of
+  // a moved row) needs the clear
+  if (!is_frame_repainting &&
+      (!is_cache_hit || row->slide_dx != 0 || row->is_moved)) {
+    clear_row(ctx, me);
+  }
+  row->is_moved = false;
+  if (is_cache_hit) {
+    draw_row_cache(ctx, row);
+  } else {
+    render_row(ctx, me, slot);
+#ifndef BENCHMARK_MODE
+    is_frame_ghosted |= is_row_ghosted(slot);
+#endif
+    // Ghost trails only change with the key, and are the expensive part
+    if (is_row_cached(slot)) {
+      store_row_cache(ctx, me, slot, key);
+    }
+    if (row->slide_dx != 0) {
+      if (row->cached_key == key) {
+        // The value just went in at its new x; start it from the old one
+        graphics_context_set_fill_color(ctx, BACKGROUND_COLOR);
+        graphics_fill_rect(ctx, row_cache_rect(row), 0, GCornerNone);
+        draw_row_cache(ctx, row);
+      } else {
+        // No room for a cache: jump, like without slides
+        row->slide_from_dx = 0;
+        row->slide_dx = 0;
+      }
     }
+    // Row surfaces and glyph variants are only allocated on this path
+    MEMSTATS_SAMPLE("row_layer_update");
   }
-  gbitmap_destroy(charging_icon_bmp);
-  gbitmap_destroy(charging_icon_low_bmp);
+  const RowLayout *layout = current_row_layout(slot);
+  row->rendered_x = layout ? layout->x : 0;
+  row->rendered_key = key;
+  TELEMETRY_UPDATE_END(!is_cache_hit);
+}
 
-  layer_remove_child_layers(window_layer);
-  layer_destroy(layer);
+#ifndef BENCHMARK_MODE
+static void refill_noise_masks(RenderQuality quality);
+#endif
+
+static void row_layer_update_callback(Layer *me, GContext *ctx) {
+  const RowSlot slot = *(RowSlot *)layer_get_data(me);
+  VERBOSE_LOG("row_layer_update_callback(%d)", (int)slot);
+  const uint32_t key = compute_row_key(slot);
+  // Whatever else is redrawing, a row that hasn't changed is still there
+  if (rows[slot].is_dirty || is_frame_repainting ||
+      key != rows[slot].rendered_key) {
+    draw_row(ctx, me, slot, key);
+  }
+#ifndef BENCHMARK_MODE
+  // Every frame counts towards stepping back up, but only those that drew
+  // trails say what trails cost. A quality change takes effect as the next
+  // tick redraws the ghosted rows
+  if (slot == ROW_SLOT_DAY_OF_MONTH) {
+    const uint32_t end_ms = now_ms();
+    if (governor_frame_drawn(end_ms, is_frame_ghosted, end_ms - frame_start_ms,
+                             FRAME_BUDGET_MS)) {
+      refill_noise_masks(governor_quality());
+    }
+  }
+#endif
+#if defined(SNAPSHOT_ENABLED) && !defined(BENCHMARK_MODE)
+  if (slot == ROW_SLOT_DAY_OF_MONTH) {
+    note_snapshot_frame(ctx); // The last row, so the whole frame is drawn
+  }
+#endif
+}
+
+#ifdef BENCHMARK_MODE
+// Added last, so its update proc runs once every row has drawn
+static void frame_end_layer_update_callback(Layer *me, GContext *ctx) {
+  harness_frame_end(ctx);
+#ifdef SNAPSHOT_ENABLED
+  note_snapshot_frame(ctx);
+#endif
+}
+#endif
+
+static int unobstructed_height(void) {
+#if PBL_API_EXISTS(layer_get_unobstructed_bounds)
+  return layer_get_unobstructed_bounds(window_layer).size.h;
+#else
+  return PBL_DISPLAY_HEIGHT;
+#endif
+}
+
+// Only moves (and hides) row layers; each row still draws at y = 0 and owns
+// the padding below it (the seconds comb draws 1px into it). Only the rows
+// that moved redraw, and the background clears the strip they moved off
+static void reflow_rows(void) {
+  const RowReflow *reflow = reflow_for_height(unobstructed_height());
+  const RowReflow *old_reflow = row_reflow;
+  if (reflow == old_reflow) {
+    return;
+  }
+  row_reflow = reflow;
+  if (!old_reflow) {
+    request_full_repaint(); // Nothing was laid out to move
+  } else {
+    const int old_bottom = reflow_bottom(old_reflow);
+    if (vacated_top >= vacated_bottom) {
+      vacated_top = old_reflow->top;
+      vacated_bottom = old_bottom;
+    } else {
+      vacated_top = old_reflow->top < vacated_top ? old_reflow->top
+                                                  : vacated_top;
+      vacated_bottom = old_bottom > vacated_bottom ? old_bottom
+                                                   : vacated_bottom;
+    }
+    layer_mark_dirty(background_layer);
+  }
+  int y_offset = reflow->top;
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    const bool is_shown = i < reflow->row_count;
+    layer_set_hidden(rows[i].layer, !is_shown);
+    if (is_shown) {
+      const GRect row_frame = {
+          .origin = {0, y_offset},
+          .size = {PBL_DISPLAY_WIDTH, ROW_HEIGHTS_PX[i] + reflow->padding}};
+      const GRect old_frame = layer_get_frame(rows[i].layer);
+      if (old_reflow &&
+          (i >= old_reflow->row_count || old_frame.origin.y != y_offset ||
+           old_frame.size.h != row_frame.size.h)) {
+        rows[i].is_moved = true;
+        mark_row_dirty(&rows[i]);
+      }
+      layer_set_frame(rows[i].layer, row_frame);
+      y_offset += row_frame.size.h;
+    }
+  }
+}
+
+#if PBL_API_EXISTS(unobstructed_area_service_subscribe)
+// Timeline Quick View sliding in or out: every frame of the animation moves
+// the rows to their place in the table, and blits their caches there
+static void handle_unobstructed_will_change(GRect final_area, void *context) {
+  is_reflowing = true;
+}
+
+static void handle_unobstructed_change(AnimationProgress progress,
+                                       void *context) {
+  reflow_rows();
+}
+
+static void handle_unobstructed_did_change(void *context) {
+  is_reflowing = false;
+  reflow_rows();
+  release_unused_row_caches();
+}
+#endif
+
+#ifdef SETTINGS_REPORT_ENABLED
+static void send_settings_report(void);
+#endif
+
+static void handle_bluetooth(bool connected) {
+  TRACE_EVENT(bluetooth, connected);
+  is_connected = connected;
+  if (settings.DisconnectVibrate && time(NULL) - launch_time > 5) {
+    vibes_long_pulse();
+  }
+#ifdef SETTINGS_REPORT_ENABLED
+  // Called once on launch too, so this covers both
+  if (connected) {
+    send_settings_report();
+  }
+#endif
+  refresh_rows();
+}
+
+static void handle_battery(BatteryChargeState charge_state) {
+  // Packed as REPLAY_EVENT_BATTERY is
+  TRACE_EVENT(battery, charge_state.charge_percent |
+                           (charge_state.is_charging << 8) |
+                           (charge_state.is_plugged << 9));
+  is_charging = charge_state.is_charging;
+  battery_percent = charge_state.charge_percent;
+  governor_set_battery(battery_percent, is_charging);
+  refresh_rows();
+}
+
+#ifndef BENCHMARK_MODE
+static void quarter_timer_callback(void *context);
+
+// The top of the minute is left to the minute tick
+static void schedule_quarter_timer(void) {
+  time_t seconds;
+  uint16_t millis;
+#ifdef REPLAY_MODE
+  replay_time_ms(&seconds, &millis);
+#else
+  time_ms(&seconds, &millis);
+#endif
+  const int ms_into_minute = (localtime(&seconds)->tm_sec * 1000) + millis;
+  const int next_quarter_ms = ((ms_into_minute / 15000) + 1) * 15000;
+  quarter_timer =
+      next_quarter_ms < 60000
+          ? app_timer_register(next_quarter_ms - ms_into_minute,
+                               quarter_timer_callback, NULL)
+          : NULL;
+}
+
+static void cancel_quarter_timer(void) {
+  if (quarter_timer) {
+    app_timer_cancel(quarter_timer);
+    quarter_timer = NULL;
+  }
+}
+
+static void row_slide_update(Animation *animation,
+                             const AnimationProgress progress) {
+  const uint32_t now = now_ms();
+  const bool is_last_frame = progress >= ANIMATION_NORMALIZED_MAX;
+  // The framework may run faster than the budget; only the end must land
+  if (!is_last_frame && now - row_slide_frame_ms < ROW_SLIDE_FRAME_MS) {
+    return;
+  }
+  row_slide_frame_ms = now;
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    RowState *row = &rows[i];
+    if (row->slide_from_dx == 0) {
+      continue;
+    }
+    const int dx = (int)row->slide_from_dx *
+                   (int)(ANIMATION_NORMALIZED_MAX - progress) /
+                   ANIMATION_NORMALIZED_MAX;
+    if (dx != row->slide_dx) {
+      row->slide_dx = dx;
+      mark_row_dirty(row);
+    }
+  }
+}
+
+static void row_slide_stopped(Animation *animation, bool finished,
+                              void *context) {
+  row_slide_animation = NULL;
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    if (rows[i].slide_from_dx != 0) {
+      rows[i].slide_from_dx = 0;
+      rows[i].slide_dx = 0;
+      mark_row_dirty(&rows[i]);
+    }
+  }
+}
+
+static const AnimationImplementation ROW_SLIDE_IMPLEMENTATION = {
+    .update = row_slide_update};
+
+// Call right after refresh_rows(), while the rows it dirtied still hold the
+// old value's rendered_x
+static void start_row_slides(void) {
+  if (row_slide_animation) {
+    animation_unschedule(row_slide_animation);
+  }
+  bool is_sliding = false;
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    RowState *row = &rows[i];
+    const RowLayout *layout = current_row_layout(i);
+    if (!layout || row->rendered_key == ROW_KEY_INVALID ||
+        compute_row_key(i) == row->rendered_key) {
+      continue;
+    }
+    const int from_dx = row->rendered_x + row->slide_dx - layout->x;
+    row->slide_from_dx = from_dx;
+    row->slide_dx = from_dx;
+    is_sliding |= from_dx != 0;
+  }
+  if (!is_sliding) {
+    return;
+  }
+  row_slide_animation = animation_create();
+  if (!row_slide_animation) {
+    row_slide_stopped(NULL, false, NULL);
+    return;
+  }
+  animation_set_duration(row_slide_animation, ROW_SLIDE_DURATION_MS);
+  animation_set_curve(row_slide_animation, AnimationCurveEaseOut);
+  animation_set_implementation(row_slide_animation,
+                               &ROW_SLIDE_IMPLEMENTATION);
+  animation_set_handlers(row_slide_animation,
+                         (AnimationHandlers){.stopped = row_slide_stopped},
+                         NULL);
+  row_slide_frame_ms = 0;
+  animation_schedule(row_slide_animation);
+}
+
+// Whether the row, as display_time shows it, needs no drawing ahead: it's
+// uncached, or its cache or back buffer already holds that
+static bool is_row_precomputed(RowSlot slot) {
+  if (slot == ROW_SLOT_SECONDS_CONN_BATT || !is_row_cached(slot)) {
+    return true; // Uncached rows draw from scratch every time anyway
+  }
+  const uint32_t key = compute_row_key(slot);
+  return key == rows[slot].cached_key || key == rows[slot].next_key;
+}
+
+// Draws the row, as display_time shows it, into its back buffer. The SDK has
+// no offscreen GContext, so this goes through the framebuffer blitters
+static bool precompute_row(RowSlot slot) {
+  RowState *row = &rows[slot];
+  if (is_row_precomputed(slot)) {
+    return false;
+  }
+  if (!row->next_cache) {
+    row->next_cache = arena_carve(ROW_HEIGHTS_PX[slot]);
+  }
+  if (!row->next_cache ||
+      !framebuffer_begin_bitmap(row->next_cache, &direct_fb)) {
+    return false;
+  }
+  framebuffer_clear(&direct_fb, BACKGROUND_COLOR);
+  is_direct_fb_active = true;
+  render_digit_row(NULL, slot);
+  is_direct_fb_active = false;
+  row->next_key = compute_row_key(slot);
+  MEMSTATS_SAMPLE("precompute_row");
+  return true;
+}
+
+static time_t next_minute_start(void) {
+  const time_t now = time(NULL);
+  return now + 60 - (now % 60);
+}
+
+// Points display_time at the coming minute; returns what it showed before
+static DisplayTime show_next_minute(void) {
+  const DisplayTime now = display_time;
+  const time_t next_minute = next_minute_start();
+  fill_display_time(&display_time, localtime(&next_minute));
+  return now;
+}
+
+static bool has_rows_to_precompute(void) {
+  const DisplayTime now = show_next_minute();
+  bool has_rows = false;
+  for (int i = 0; i < ROW_SLOT_COUNT && !has_rows; i++) {
+    has_rows = !is_row_precomputed(i);
+  }
+  display_time = now;
+  return has_rows;
+}
+
+static void schedule_precompute(void);
+
+// One step per timer: a glyph page the mode will draw from, or else the
+// first row (top to bottom) that the next minute changes and that isn't drawn
+// ahead yet. A step that got nowhere (the arena or heap ran short) leaves the
+// rest of the minute alone
+static void precompute_timer_callback(void *context) {
+  precompute_timer = NULL;
+  bool has_stepped = glyph_cache_warm();
+  if (!has_stepped) {
+    const DisplayTime now = show_next_minute();
+    for (int i = 0; i < ROW_SLOT_COUNT && !has_stepped; i++) {
+      has_stepped = precompute_row(i);
+      if (has_stepped) {
+        VERBOSE_LOG("Drew row %d ahead", i);
+      }
+    }
+    display_time = now;
+  }
+  if (has_stepped) {
+    schedule_precompute();
+  } else {
+    precompute_stalled_minute = next_minute_start();
+  }
+}
+
+// Between minute ticks, and only while a row has yet to be drawn ahead; the
+// tick itself is the frame this saves work for
+static void schedule_precompute(void) {
+  if (!precompute_timer && precompute_stalled_minute != next_minute_start() &&
+      has_rows_to_precompute()) {
+    precompute_timer = app_timer_register(PRECOMPUTE_DELAY_MS,
+                                          precompute_timer_callback, NULL);
+  }
+}
+
+static void quarter_timer_callback(void *context) {
+  quarter_timer = NULL;
+  refresh_rows();
+  schedule_quarter_timer();
+  schedule_precompute();
+}
+
+static void handle_tick(struct tm *tick_time, TimeUnits units_changed) {
+  // Whatever the tick unit, HOUR_UNIT is set on the first tick of the hour
+  if (settings.HourlyVibrate && (units_changed & HOUR_UNIT)) {
+    vibes_long_pulse();
+  }
+  if (units_changed & HOUR_UNIT) {
+    telemetry_flush();
+  }
+#ifdef PROFILING_ENABLED
+  if (units_changed & MINUTE_UNIT) {
+    profile_log();
+  }
+#endif
+  refresh_rows();
+  if (settings.AnimateTransitions) {
+    start_row_slides();
+  }
+  if (!is_live_seconds() && governor_tier() != POWER_TIER_STATIC) {
+    cancel_quarter_timer();
+    schedule_quarter_timer();
+  }
+  if (!(units_changed & MINUTE_UNIT)) {
+    schedule_precompute();
+  }
+}
+
+// Subscribes to the coarsest tick that still moves everything on screen:
+// live seconds need SECOND_UNIT, but the low power comb only moves every 15
+// seconds, which a minute tick plus a timer per quarter covers
+// Call again whenever PowerMode or the power tier may have changed
+static void schedule_ticks(void) {
+  cancel_quarter_timer();
+  if (is_live_seconds()) {
+    tick_timer_service_subscribe(SECOND_UNIT, handle_tick);
+  } else {
+    tick_timer_service_subscribe(MINUTE_UNIT, handle_tick);
+    if (governor_tier() != POWER_TIER_STATIC) {
+      schedule_quarter_timer();
+    }
+  }
+}
+
+static void handle_power_tier(PowerTier tier) {
+  TELEMETRY_NOTE_TIER(tier);
+  release_unused_row_caches();
+  schedule_ticks();
+  refresh_rows();
+}
+
+static void update_power_governor(void) {
+  if (settings.PowerGovernor) {
+    governor_start(&power_thresholds, handle_power_tier);
+  } else if (governor_tier() != POWER_TIER_FULL) {
+    governor_stop();
+    handle_power_tier(POWER_TIER_FULL);
+  } else {
+    governor_stop();
+  }
+}
+#endif
+
+static uint32_t settings_to_bits(const ClaySettings *from) {
+  return (from->HexMode ? SETTING_HEX_MODE : 0) |
+         (from->PowerMode ? SETTING_POWER_MODE : 0) |
+         (from->ColorizeDigits ? SETTING_COLORIZE_DIGITS : 0) |
+         (from->GhostTime ? SETTING_GHOST_TIME : 0) |
+         (from->GhostDate ? SETTING_GHOST_DATE : 0) |
+         (from->HourlyVibrate ? SETTING_HOURLY_VIBRATE : 0) |
+         (from->DisconnectVibrate ? SETTING_DISCONNECT_VIBRATE : 0) |
+         (from->AnimateTransitions ? SETTING_ANIMATE_TRANSITIONS : 0) |
+         (from->PowerGovernor ? SETTING_POWER_GOVERNOR : 0) |
+         (from->SendTelemetry ? SETTING_SEND_TELEMETRY : 0);
+}
+
+static void settings_from_bits(ClaySettings *to, uint32_t bits) {
+  to->HexMode = bits & SETTING_HEX_MODE;
+  to->PowerMode = bits & SETTING_POWER_MODE;
+  to->ColorizeDigits = bits & SETTING_COLORIZE_DIGITS;
+  to->GhostTime = bits & SETTING_GHOST_TIME;
+  to->GhostDate = bits & SETTING_GHOST_DATE;
+  to->HourlyVibrate = bits & SETTING_HOURLY_VIBRATE;
+  to->DisconnectVibrate = bits & SETTING_DISCONNECT_VIBRATE;
+  to->AnimateTransitions = bits & SETTING_ANIMATE_TRANSITIONS;
+  to->PowerGovernor = bits & SETTING_POWER_GOVERNOR;
+  to->SendTelemetry = bits & SETTING_SEND_TELEMETRY;
+}
+
+// Anything added since takes its default
+static uint32_t legacy_settings_to_bits(const LegacyClaySettings *from) {
+  return (SETTINGS_DEFAULT_BITS & ~SETTINGS_VERSION_BITS[1]) |
+         (from->HexMode ? SETTING_HEX_MODE : 0) |
+         (from->PowerMode ? SETTING_POWER_MODE : 0) |
+         (from->ColorizeDigits ? SETTING_COLORIZE_DIGITS : 0) |
+         (from->GhostTime ? SETTING_GHOST_TIME : 0) |
+         (from->GhostDate ? SETTING_GHOST_DATE : 0) |
+         (from->HourlyVibrate ? SETTING_HOURLY_VIBRATE : 0) |
+         (from->DisconnectVibrate ? SETTING_DISCONNECT_VIBRATE : 0);
+}
+
+static void persist_settings(void) {
+  const SettingsRecord record = {.version = SETTINGS_RECORD_VERSION,
+                                 .bits = settings_to_bits(&settings),
+                                 .power_thresholds = power_thresholds};
+  persist_write_data(SETTINGS_RECORD_KEY, &record, sizeof(record));
+}
+
+// Falls back to the raw struct older releases wrote, then to the defaults
+static void load_settings(void) {
+  uint32_t bits = SETTINGS_DEFAULT_BITS;
+  power_thresholds = POWER_THRESHOLDS_DEFAULT;
+  SettingsRecord record;
+  LegacyClaySettings legacy;
+  const int record_bytes =
+      persist_read_data(SETTINGS_RECORD_KEY, &record, sizeof(record));
+  if (record_bytes >= (int)SETTINGS_RECORD_V1_BYTES) {
+    // A record from a newer release keeps the bits this one knows about
+    const int version = record.version > SETTINGS_RECORD_VERSION
+                            ? SETTINGS_RECORD_VERSION
+                            : record.version;
+    uint32_t known = 0;
+    for (int v = 1; v <= version; v++) {
+      known |= SETTINGS_VERSION_BITS[v];
+    }
+    bits = (bits & ~known) | (record.bits & known);
+    if (version >= 3 && record_bytes >= (int)(SETTINGS_RECORD_V1_BYTES +
+                                              sizeof(PowerThresholds))) {
+      power_thresholds = record.power_thresholds;
+      governor_clamp_thresholds(&power_thresholds);
+    }
+  } else if (persist_get_size(LEGACY_SETTINGS_KEY) == (int)sizeof(legacy) &&
+             persist_read_data(LEGACY_SETTINGS_KEY, &legacy, sizeof(legacy)) ==
+                 (int)sizeof(legacy)) {
+    VERBOSE_LOG("Migrating legacy settings");
+    bits = legacy_settings_to_bits(&legacy);
+    persist_delete(LEGACY_SETTINGS_KEY);
+  } else {
+    VERBOSE_LOG("No stored settings, using defaults");
+  }
+  settings_from_bits(&settings, bits);
+  persist_settings();
+}
+
+// Only what the changed bits affect is redone; row keys already cover every
+// render setting, so refresh_rows() redraws just the rows that look different
+static void apply_settings_bits(uint32_t bits) {
+  const uint32_t changed = settings_to_bits(&settings) ^ bits;
+  if (!changed) {
+    return;
+  }
+  settings_from_bits(&settings, bits);
+  persist_settings();
+  if (changed & (SETTING_GHOST_TIME | SETTING_GHOST_DATE |
+                 SETTING_ANIMATE_TRANSITIONS)) {
+    release_unused_row_caches();
+  }
+  if (changed & SETTING_COLORIZE_DIGITS) {
+    release_unused_glyph_variants();
+  }
+  if (changed & SETTING_HEX_MODE) {
+    glyph_cache_set_hex_mode(settings.HexMode);
+  }
+#ifndef BENCHMARK_MODE
+  if (changed & SETTING_POWER_MODE) {
+    schedule_ticks();
+  }
+  if (changed & SETTING_POWER_GOVERNOR) {
+    update_power_governor();
+  }
+  if (changed & SETTING_SEND_TELEMETRY) {
+    telemetry_set_enabled(settings.SendTelemetry);
+  }
+#endif
+  if (changed & SETTINGS_RENDER_BITS) {
+    refresh_rows();
+  }
+}
+
+// Packed by index.js: low battery percent, critical battery percent and
+// burst seconds, a byte each from the bottom. The sliders let critical go
+// above low; what's kept (and reported back) is what the governor uses
+static void apply_power_thresholds(uint32_t packed) {
+  PowerThresholds new_thresholds = {
+      .low_battery_percent = packed & 0xFF,
+      .critical_battery_percent = (packed >> 8) & 0xFF,
+      .burst_seconds = (packed >> 16) & 0xFF};
+  governor_clamp_thresholds(&new_thresholds);
+  if (memcmp(&new_thresholds, &power_thresholds, sizeof(PowerThresholds)) ==
+      0) {
+    return;
+  }
+  power_thresholds = new_thresholds;
+  persist_settings();
+#ifndef BENCHMARK_MODE
+  governor_set_thresholds(&power_thresholds);
+#endif
+}
+
+#ifdef SETTINGS_REPORT_ENABLED
+static void settings_report_timer_callback(void *context);
+
+static void retry_settings_report(void) {
+  if (settings_report_timer ||
+      settings_report_retries >= SETTINGS_REPORT_RETRIES) {
+    return;
+  }
+  settings_report_timer = app_timer_register(
+      SETTINGS_REPORT_RETRY_FIRST_MS << settings_report_retries,
+      settings_report_timer_callback, NULL);
+  settings_report_retries++;
+}
+
+// The same keys the phone sends, packed the same way, so index.js can
+// compare them with what it last had acknowledged
+static void write_settings_report(void) {
+  DictionaryIterator *iter;
+  if (app_message_outbox_begin(&iter) != APP_MSG_OK) {
+    retry_settings_report(); // Busy with telemetry, most likely
+    return;
+  }
+  dict_write_int32(iter, MESSAGE_KEY_SettingsBits,
+                   (int32_t)settings_to_bits(&settings));
+  dict_write_int32(iter, MESSAGE_KEY_PowerThresholds,
+                   power_thresholds.low_battery_percent |
+                       (power_thresholds.critical_battery_percent << 8) |
+                       (power_thresholds.burst_seconds << 16));
+  if (app_message_outbox_send() != APP_MSG_OK) {
+    retry_settings_report();
+  }
+}
+
+static void settings_report_timer_callback(void *context) {
+  settings_report_timer = NULL;
+  write_settings_report();
+}
+
+static void send_settings_report(void) {
+  if (settings_report_timer) {
+    app_timer_cancel(settings_report_timer);
+    settings_report_timer = NULL;
+  }
+  settings_report_retries = 0;
+  write_settings_report();
+}
+
+#endif
+
+static void outbox_sent_callback(DictionaryIterator *iterator,
+                                 void *context) {
+  telemetry_outbox_sent(iterator);
+}
+
+static void outbox_failed_callback(DictionaryIterator *iterator,
+                                   AppMessageResult reason, void *context) {
+#ifdef SETTINGS_REPORT_ENABLED
+  if (dict_find(iterator, MESSAGE_KEY_SettingsBits)) {
+    retry_settings_report();
+  }
+#endif
+  telemetry_outbox_failed(iterator);
+}
+
+static void inbox_received_callback(DictionaryIterator *iterator,
+                                    void *context) {
+  VERBOSE_LOG("Inbox message received");
+  Tuple *settings_bits_tuple = dict_find(iterator, MESSAGE_KEY_SettingsBits);
+  if (settings_bits_tuple) {
+    TRACE_EVENT(settings, settings_bits_tuple->value->int32);
+    apply_settings_bits((uint32_t)settings_bits_tuple->value->int32);
+  }
+  Tuple *thresholds_tuple = dict_find(iterator, MESSAGE_KEY_PowerThresholds);
+  if (thresholds_tuple) {
+    TRACE_EVENT(thresholds, thresholds_tuple->value->int32);
+    apply_power_thresholds((uint32_t)thresholds_tuple->value->int32);
+  }
+}
+
+#ifdef BENCHMARK_MODE
+static void harness_apply_settings(uint8_t settings_bits) {
+  settings_from_bits(&settings, settings_bits);
+  // Start every case cold so its first frame measures a full rebuild
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    rows[i].cached_key = ROW_KEY_INVALID;
+  }
+  release_unused_row_caches();
+  release_unused_glyph_variants();
+  glyph_cache_set_hex_mode(settings.HexMode);
+  request_full_repaint();
+}
+
+#ifdef SWEEP_MODE
+static void harness_row_frame(int row, GRect *frame) {
+  *frame = layer_get_frame(rows[row].layer);
+  frame->size.h = ROW_HEIGHTS_PX[row];
+}
+#endif
+
+static void harness_redraw(void) {
+  refresh_rows();
+  // Like a PowerMode tick: the rest of the frame is whatever is still valid
+  mark_row_dirty(&rows[ROW_SLOT_SECONDS_CONN_BATT]);
+}
+#endif
+
+#ifdef REPLAY_MODE
+// Slides animate in real time, so the replay holds its clock until they end
+static bool replay_is_busy(void) { return row_slide_animation != NULL; }
+#endif
+
+static void inbox_dropped_callback(AppMessageResult reason, void *context) {
+  APP_LOG(APP_LOG_LEVEL_ERROR, "Inbox message dropped: %d", (int)reason);
+}
+
+static GBitmap *create_atlas_cell(int cell, int cell_w, int row_y, int w,
+                                  int h, GColor *palette) {
+  GBitmap *bmp = gbitmap_create_as_sub_bitmap(
+      glyph_atlas_bmp,
+      (GRect){.origin = {cell * cell_w, row_y}, .size = {w, h}});
+  gbitmap_set_palette(bmp, palette, false);
+  return bmp;
+}
+
+// The atlas is loaded once, already palettized, and every glyph and icon is a
+// window onto it. The resource compiler picks the palette order, though, and
+// everything here expects ink (black in the PNGs) at index 0
+static bool load_glyph_atlas(void) {
+  glyph_atlas_bmp = glyph_bitmap_create_with_resource(RESOURCE_ID_GLYPH_ATLAS);
+  if (!glyph_atlas_bmp) {
+    APP_LOG(APP_LOG_LEVEL_ERROR, "Glyph atlas missing or not 1BitPalette");
+    return false;
+  }
+  // The icons are drawn light-on-dark, the inverse of their PNGs
+  charging_icon_palette[0] = FOREGROUND_COLOR;
+  charging_icon_palette[1] = BACKGROUND_COLOR;
+  charging_icon_bmp = create_atlas_cell(
+      0, ATLAS_ICON_CELL_W_PX, ATLAS_ICON_ROW_Y_PX, CHARGING_ICON_WIDTH_PX,
+      CHARGING_ICON_HEIGHT_PX, charging_icon_palette);
+  charging_icon_low_bmp = create_atlas_cell(
+      1, ATLAS_ICON_CELL_W_PX, ATLAS_ICON_ROW_Y_PX, CHARGING_ICON_WIDTH_PX,
+      CHARGING_ICON_HEIGHT_PX, charging_icon_palette);
+  return true;
+}
+
+static uint32_t noise_state;
+
+static int next_noise(int bound) {
+  noise_state = (noise_state * 1664525U) + 1013904223U;
+  return (int)((noise_state >> 16) % bound);
+}
+
+// Fills every variant for one smear: the smear itself plus, so it isn't
+// uniform, some extra BACKGROUND_COLOR dots on top of it
+// A smear's set pixels (index 1, white in its PNG) are the ones that punch
+// Every density walks the same dots, so a lower one keeps the first of them
+static void fill_noise_masks(bool is_small, bool is_more_smeared,
+                             int dot_percent) {
+  const int char_w = is_small ? SMALL_DIGIT_WIDTH_PX : BIG_DIGIT_WIDTH_PX;
+  const int char_h = is_small ? SMALL_DIGIT_HEIGHT_PX : BIG_DIGIT_HEIGHT_PX;
+  const int noise_dots =
+      is_small ? SMALL_DIGIT_NOISE_PX_COUNT : BIG_DIGIT_NOISE_PX_COUNT;
+  const int kept_dots = (noise_dots * dot_percent) / 100;
+  const int cell = (is_small ? ATLAS_SMALL_SMEAR_CELL : ATLAS_BIG_SMEAR_CELL) +
+                   (is_more_smeared ? 1 : 0);
+  const int cell_w = is_small ? ATLAS_SMALL_CELL_W_PX : ATLAS_BIG_CELL_W_PX;
+  const int row_y = is_small ? ATLAS_SMALL_ROW_Y_PX : ATLAS_BIG_ROW_Y_PX;
+  const int smear_stride = gbitmap_get_bytes_per_row(glyph_atlas_bmp);
+  // Cells start on byte boundaries, so the smear's rows copy across as-is
+  const uint8_t *smear_data = (const uint8_t *)gbitmap_get_data(
+                                  glyph_atlas_bmp) +
+                              (row_y * smear_stride) + ((cell * cell_w) / 8);
+
+  for (int v = 0; v < NOISE_MASK_VARIANTS; v++) {
+    GBitmap *mask =
+        noise_mask_bmps[is_small ? 1 : 0][is_more_smeared ? 1 : 0][v];
+    const int mask_stride = gbitmap_get_bytes_per_row(mask);
+    uint8_t *mask_data = gbitmap_get_data(mask);
+    for (int y = 0; y < char_h; y++) {
+      memcpy(mask_data + (y * mask_stride), smear_data + (y * smear_stride),
+             mask_stride < smear_stride ? mask_stride : smear_stride);
+    }
+    // Palettized formats keep the leftmost pixel in the top bit
+    for (int i = 0; i < noise_dots; i++) {
+      const int x_dot = next_noise(char_w);
+      const int y_dot = next_noise(char_h);
+      if (i < kept_dots) {
+        mask_data[(y_dot * mask_stride) + (x_dot / 8)] |= 0x80 >> (x_dot % 8);
+      }
+    }
+  }
+}
+
+// Rows cached at another quality have other keys, so they redraw with these
+static void refill_noise_masks(RenderQuality quality) {
+  noise_state = NOISE_MASK_SEED;
+  for (int i = 0; i < 2; i++) {
+    for (int j = 0; j < 2; j++) {
+      fill_noise_masks(i == 1, j == 1, NOISE_DOT_PERCENTS[quality]);
+    }
+  }
+}
+
+// count lines, each height pixels tall and pitch pixels apart, in palette
+// index 1; the rest is index 0, which draw_strip's GCompOpSet leaves alone
+static GBitmap *create_comb_strip(int count, int height, int pitch,
+                                  GColor *palette) {
+  GBitmap *strip = gbitmap_create_blank_with_palette(
+      GSize(((count - 1) * pitch) + 1, height), GBitmapFormat1BitPalette,
+      palette, false);
+  if (!strip) {
+    return NULL;
+  }
+  const int stride = gbitmap_get_bytes_per_row(strip);
+  uint8_t *data = gbitmap_get_data(strip);
+  for (int y = 0; y < height; y++) {
+    for (int x = 0; x < count * pitch; x += pitch) {
+      data[(y * stride) + (x / 8)] |= 0x80 >> (x % 8);
+    }
+  }
+  return strip;
+}
+
+// Everything a frame of the face itself needs, which a launch with a snapshot
+// to show leaves until that has drawn
+static void finish_init(void) {
+  reflow_rows();
+#if PBL_API_EXISTS(unobstructed_area_service_subscribe)
+  unobstructed_area_service_subscribe(
+      (UnobstructedAreaHandlers){.will_change = handle_unobstructed_will_change,
+                                 .change = handle_unobstructed_change,
+                                 .did_change = handle_unobstructed_did_change},
+      NULL);
+#endif
+
+  MEMSTATS_PHASE_BEGIN();
+  if (!load_glyph_atlas()) {
+    return;
+  }
+  // Pages load as rows first draw from them
+  glyph_palette[0] = FOREGROUND_COLOR;
+  glyph_palette[1] = GColorClear;
+  glyph_cache_init(glyph_palette, handle_glyph_evict);
+  glyph_cache_set_hex_mode(settings.HexMode);
+#ifdef PBL_COLOR
+  init_glyph_tint_palettes();
+#endif
+  MEMSTATS_PHASE_END("glyph_atlas");
+
+  MEMSTATS_PHASE_BEGIN();
+  noise_mask_palette[0] = GColorClear;
+  noise_mask_palette[1] = BACKGROUND_COLOR;
+  for (int i = 0; i < 2; i++) {
+    const GSize size =
+        i == 1 ? GSize(SMALL_DIGIT_WIDTH_PX, SMALL_DIGIT_HEIGHT_PX)
+               : GSize(BIG_DIGIT_WIDTH_PX, BIG_DIGIT_HEIGHT_PX);
+    for (int j = 0; j < 2; j++) {
+      for (int v = 0; v < NOISE_MASK_VARIANTS; v++) {
+        noise_mask_bmps[i][j][v] = gbitmap_create_blank_with_palette(
+            size, GBitmapFormat1BitPalette, noise_mask_palette, false);
+      }
+    }
+  }
+  refill_noise_masks(render_quality());
+  MEMSTATS_PHASE_END("noise_masks");
+
+  MEMSTATS_PHASE_BEGIN();
+  seconds_strip_palette[0] = GColorClear;
+  seconds_strip_palette[1] = FOREGROUND_COLOR;
+  battery_strip_palette[0] = GColorClear;
+  battery_strip_palette[1] = BATTERY_COLOR;
+  // graphics_draw_line included both end points, hence the + 1s
+  seconds_strip_bmp = create_comb_strip(
+      SECONDS_INDICATOR_MAX_COUNT, SECONDS_INDICATOR_HEIGHT_PX + 1,
+      SECONDS_INDICATOR_WIDTH_PX + SECONDS_INDICATOR_INTERNAL_PADDING_W_PX,
+      seconds_strip_palette);
+  battery_strip_bmp = create_comb_strip(
+      BATTERY_BAR_MAX_COUNT, BATTERY_BAR_HEIGHT_PX + 1,
+      BATTERY_BAR_WIDTH_PX + BATTERY_BAR_INTERNAL_PADDING_W_PX,
+      battery_strip_palette);
+  MEMSTATS_PHASE_END("comb_strips");
+
+  MEMSTATS_PHASE_BEGIN();
+  arena_init(ROW_ARENA_LINES);
+  MEMSTATS_PHASE_END("arena");
+
+  VERBOSE_LOG("Init'd all resources");
+
+#ifdef BENCHMARK_MODE
+  harness_start((HarnessHandlers){
+    .apply_settings = harness_apply_settings, .redraw = harness_redraw,
+#ifdef SWEEP_MODE
+    .row_count = ROW_SLOT_COUNT, .row_frame = harness_row_frame,
+#endif
+  });
+#else
+  telemetry_set_enabled(settings.SendTelemetry);
+  update_power_governor();
+  schedule_ticks();
+#endif
+#ifndef REPLAY_MODE
+  // In a replay the trace is the only source of events
+  battery_state_service_subscribe(&handle_battery);
+  bluetooth_connection_service_subscribe(&handle_bluetooth);
+#endif
+  handle_bluetooth(bluetooth_connection_service_peek());
+  handle_battery(battery_state_service_peek());
+
+  invalidate_rows();
+  is_init_finished = true;
+#ifdef REPLAY_MODE
+  replay_start((ReplayHandlers){.battery = handle_battery,
+                                .bluetooth = handle_bluetooth,
+                                .inbox = inbox_received_callback,
+                                .is_busy = replay_is_busy});
+#endif
+
+  VERBOSE_LOG("Done init'ing");
+}
+
+#ifdef SNAPSHOT_ENABLED
+static void set_face_layers_hidden(bool is_hidden) {
+  layer_set_hidden(background_layer, is_hidden);
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    layer_set_hidden(rows[i].layer, is_hidden);
+  }
+#ifdef BENCHMARK_MODE
+  layer_set_hidden(frame_end_layer, is_hidden);
+#endif
+}
+
+static void release_snapshot_layer(void) {
+  if (snapshot_layer) {
+    layer_remove_from_parent(snapshot_layer);
+    layer_destroy(snapshot_layer);
+    snapshot_layer = NULL;
+  }
+}
+
+// The snapshot stays on screen until the rows first draw over it
+static void launch_timer_callback(void *context) {
+  launch_timer = NULL;
+  release_snapshot_layer();
+  snapshot_release();
+  set_face_layers_hidden(false);
+  request_full_repaint();
+  finish_init();
+}
+
+static void snapshot_layer_update_callback(Layer *me, GContext *ctx) {
+  snapshot_draw(ctx);
+#if defined(BENCHMARK_MODE) && !defined(SWEEP_MODE) &&                        \
+    !defined(SCREENSHOT_MODE)
+  harness_snapshot_frame_end();
+#endif
+  // A timer, so the rest of the launch runs once this frame is out
+  if (!launch_timer) {
+    launch_timer = app_timer_register(0, launch_timer_callback, NULL);
+  }
+}
+#endif
+
+// Whatever covered the face may have drawn over its framebuffer. The window
+// redraws as it appears anyway, so there's nothing to mark dirty
+static void window_appear(Window *window) { is_repaint_pending = true; }
+
+void init() {
+  VERBOSE_LOG("Init'ing");
+#if defined(BENCHMARK_MODE) && !defined(SWEEP_MODE) &&                        \
+    !defined(SCREENSHOT_MODE)
+  harness_launch_begin();
+#endif
+  launch_time = time(NULL);
+
+  window = window_create();
+  // The background layer clears the screen itself, and only when it must
+  window_set_background_color(window, GColorClear);
+  window_set_window_handlers(window,
+                             (WindowHandlers){.appear = window_appear});
+  window_stack_push(window, true);
+
+  app_message_register_inbox_received(inbox_received_callback);
+  app_message_register_inbox_dropped(inbox_dropped_callback);
+  app_message_register_outbox_sent(outbox_sent_callback);
+  app_message_register_outbox_failed(outbox_failed_callback);
+
+  // The phone only ever sends the packed settings and power thresholds
+  const int inbox_size =
+      dict_calc_buffer_size(2, sizeof(int32_t), sizeof(int32_t));
+  const int outbox_size = 128;
+  MEMSTATS_PHASE_BEGIN();
+  app_message_open(inbox_size, outbox_size);
+  MEMSTATS_PHASE_END("app_message");
+
+  load_settings();
+
+  // Init the layers for display the image
+  MEMSTATS_PHASE_BEGIN();
+  window_layer = window_get_root_layer(window);
+  bounds = layer_get_frame(window_layer);
+  background_layer = layer_create(bounds);
+  layer_set_update_proc(background_layer, background_layer_update_callback);
+  layer_add_child(window_layer, background_layer);
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    // Placed by reflow_rows()
+    rows[i].layer = layer_create_with_data(GRectZero, sizeof(RowSlot));
+    *(RowSlot *)layer_get_data(rows[i].layer) = (RowSlot)i;
+    rows[i].rendered_key = ROW_KEY_INVALID;
+    rows[i].cache = NULL;
+    rows[i].cached_key = ROW_KEY_INVALID;
+    rows[i].next_cache = NULL;
+    rows[i].next_key = ROW_KEY_INVALID;
+    rows[i].is_moved = false;
+    layer_set_update_proc(rows[i].layer, row_layer_update_callback);
+    layer_add_child(window_layer, rows[i].layer);
+  }
+#ifdef BENCHMARK_MODE
+  frame_end_layer = layer_create(bounds);
+  layer_set_update_proc(frame_end_layer, frame_end_layer_update_callback);
+  layer_add_child(window_layer, frame_end_layer);
+#endif
+  MEMSTATS_PHASE_END("layers");
+
+#ifdef SNAPSHOT_ENABLED
+  MEMSTATS_PHASE_BEGIN();
+  // Snapshots are of the unobstructed face
+  const bool has_snapshot =
+      unobstructed_height() == PBL_DISPLAY_HEIGHT &&
+      snapshot_load(SNAPSHOT_FIRST_KEY, snapshot_minute(), snapshot_key());
+  MEMSTATS_PHASE_END("snapshot");
+  if (has_snapshot) {
+    snapshot_layer = layer_create(bounds);
+    layer_set_update_proc(snapshot_layer, snapshot_layer_update_callback);
+    layer_add_child(window_layer, snapshot_layer);
+    set_face_layers_hidden(true);
+    return; // Its first frame finishes the launch
+  }
+#endif
+  finish_init();
+}
+
+void deinit() {
+  VERBOSE_LOG("Deinit'ing");
+
+#ifdef SNAPSHOT_ENABLED
+  if (launch_timer) {
+    app_timer_cancel(launch_timer);
+  }
+  release_snapshot_layer();
+#endif
+
+#ifdef BENCHMARK_MODE
+  harness_stop();
+#endif
+#ifdef REPLAY_MODE
+  replay_stop();
+#endif
+
+#ifndef BENCHMARK_MODE
+  governor_stop();
+  cancel_quarter_timer();
+  if (row_slide_animation) {
+    animation_unschedule(row_slide_animation);
+  }
+  if (precompute_timer) {
+    app_timer_cancel(precompute_timer);
+  }
+#endif
+#ifdef SETTINGS_REPORT_ENABLED
+  if (settings_report_timer) {
+    app_timer_cancel(settings_report_timer);
+    settings_report_timer = NULL;
+  }
+#endif
+  tick_timer_service_unsubscribe();
+#if PBL_API_EXISTS(unobstructed_area_service_subscribe)
+  unobstructed_area_service_unsubscribe();
+#endif
+  battery_state_service_unsubscribe();
+  bluetooth_connection_service_unsubscribe();
+
+  if (is_init_finished) {
+#ifdef PBL_COLOR
+    release_glyph_variants();
+#endif
+    glyph_cache_deinit();
+    for (int i = 0; i < 2; i++) {
+      for (int j = 0; j < 2; j++) {
+        for (int v = 0; v < NOISE_MASK_VARIANTS; v++) {
+          gbitmap_destroy(noise_mask_bmps[i][j][v]);
+        }
+      }
+    }
+    gbitmap_destroy(charging_icon_bmp);
+    gbitmap_destroy(charging_icon_low_bmp);
+    gbitmap_destroy(seconds_strip_bmp);
+    gbitmap_destroy(battery_strip_bmp);
+    // Only once every sub-bitmap of it is gone
+    gbitmap_destroy(glyph_atlas_bmp);
+  }
+
+  layer_remove_child_layers(window_layer);
+  layer_destroy(background_layer);
+  if (is_init_finished) {
+    release_row_surfaces();
+    arena_deinit();
+    is_init_finished = false;
+  }
+#ifdef SNAPSHOT_ENABLED
+  // The face's own heap is back, so there's room to encode the last frame
+  if (snapshot_ctx) {
+    snapshot_capture(snapshot_ctx, snapshot_frame_minute, snapshot_frame_key);
+    snapshot_ctx = NULL;
+  }
+  snapshot_save(SNAPSHOT_FIRST_KEY);
+#endif
+  for (int i = 0; i < ROW_SLOT_COUNT; i++) {
+    layer_destroy(rows[i].layer);
+  }
+  row_reflow = NULL; // A relaunch lays them out afresh
+#ifdef BENCHMARK_MODE
+  layer_destroy(frame_end_layer);
+#endif
   window_destroy(window);
 }
 
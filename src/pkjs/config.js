@@ -56,6 +56,70 @@ module.exports = [
                 "label": "Vibrate on disconnected from phone",
                 "defaultValue": true
             },
+            {
+                "type": "toggle",
+                "messageKey": "AnimateTransitions",
+                "label": "Slide rows to their new position when they change (uses more memory)",
+                "defaultValue": false
+            },
+        ]
+    },
+    {
+        "type": "section",
+        "items": [
+            {
+                "type": "heading",
+                "defaultValue": "Power"
+            },
+            {
+                "type": "toggle",
+                "messageKey": "PowerGovernor",
+                "label": "Draw less on low battery or while asleep; a flick of the wrist brings everything back for a moment",
+                "defaultValue": false
+            },
+            {
+                "type": "slider",
+                "messageKey": "LowBatteryPercent",
+                "label": "Drop ghosts and live seconds at or below (%)",
+                "defaultValue": 30,
+                "min": 0,
+                "max": 100,
+                "step": 5
+            },
+            {
+                "type": "slider",
+                "messageKey": "CriticalBatteryPercent",
+                "label": "Only update every minute at or below (%)",
+                "description": "Kept at least 5% below the level above",
+                "defaultValue": 10,
+                "min": 0,
+                "max": 100,
+                "step": 5
+            },
+            {
+                "type": "slider",
+                "messageKey": "BurstSeconds",
+                "label": "Seconds of full detail after a wrist flick",
+                "defaultValue": 5,
+                "min": 0,
+                "max": 30,
+                "step": 1
+            },
+        ]
+    },
+    {
+        "type": "section",
+        "items": [
+            {
+                "type": "heading",
+                "defaultValue": "Diagnostics"
+            },
+            {
+                "type": "toggle",
+                "messageKey": "SendTelemetry",
+                "label": "Send an hourly summary of drawing times to the phone's log",
+                "defaultValue": false
+            },
         ]
     },
     {
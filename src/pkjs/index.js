@@ -1,6 +1,254 @@
 // Mostly copied from the (re)Pebble tutorial
 // https://github.com/coredevices/c-watchface-tutorial/blob/f02c1ccf919960144d11eab2e4446d5ac14f0e8e/part6/src/pkjs/index.js
 
-var Clay = require('@rebble/clay');
 var clayConfig = require('./config');
-var clay = new Clay(clayConfig);
\ No newline at end of file
+
+// Clay is only needed while the config page is up, so it isn't loaded (and
+// doesn't parse its bundle) until the page is first opened
+var clay = null;
+
+function getClay() {
+    if (!clay) {
+        var Clay = require('@rebble/clay');
+        clay = new Clay(clayConfig, null, { autoHandleEvents: false });
+    }
+    return clay;
+}
+
+// The watch takes every toggle as one packed integer, bit i being the i-th
+// entry here (see SettingsBit in src/c/watchface.c); only ever append
+var SETTINGS_BITS_ORDER = ['HexMode', 'PowerMode', 'ColorizeDigits',
+    'GhostTime', 'GhostDate', 'HourlyVibrate', 'DisconnectVibrate',
+    'AnimateTransitions', 'PowerGovernor', 'SendTelemetry'];
+
+// Sends that the watch NACKs (or never answers) are retried this many times,
+// waiting twice as long before each one
+var SETTINGS_RETRIES = 5;
+var SETTINGS_RETRY_FIRST_MS = 1000;
+
+// What the watch last acknowledged for each key, so a save only sends the
+// keys it changed, and one that changes nothing doesn't wake the radio or
+// make the watch redraw
+var ACKED_SETTINGS_KEY = 'acked-settings';
+var pendingSettings = null;
+
+function settingValue(settings, key) {
+    var value = settings[key];
+    if (value !== null && typeof value === 'object') {
+        value = value.value;
+    }
+    return value;
+}
+
+function packSettings(settings) {
+    var bits = 0;
+    SETTINGS_BITS_ORDER.forEach(function(key, i) {
+        var value = settingValue(settings, key);
+        if (value === true || value === 1 || value === '1') {
+            bits |= 1 << i;
+        }
+    });
+    return bits;
+}
+
+// A byte each, from the bottom (see apply_power_thresholds() in watchface.c)
+// Missing values take the defaults from config.js
+var POWER_THRESHOLDS_ORDER = ['LowBatteryPercent', 'CriticalBatteryPercent',
+    'BurstSeconds'];
+var POWER_THRESHOLDS_DEFAULTS = [30, 10, 5];
+
+function packPowerThresholds(settings) {
+    var packed = 0;
+    POWER_THRESHOLDS_ORDER.forEach(function(key, i) {
+        var value = parseInt(settingValue(settings, key), 10);
+        if (isNaN(value)) {
+            value = POWER_THRESHOLDS_DEFAULTS[i];
+        }
+        packed += Math.max(0, Math.min(255, value)) * Math.pow(256, i);
+    });
+    return packed;
+}
+
+function ackedSettings() {
+    var stored = localStorage.getItem(ACKED_SETTINGS_KEY);
+    return stored === null ? {} : JSON.parse(stored);
+}
+
+function sendSettings(message) {
+    if (pendingSettings && pendingSettings.timer) {
+        clearTimeout(pendingSettings.timer);
+    }
+    var acked = ackedSettings();
+    var delta = {};
+    var isChanged = false;
+    Object.keys(message).forEach(function(key) {
+        if (acked[key] !== message[key]) {
+            delta[key] = message[key];
+            isChanged = true;
+        }
+    });
+    if (!isChanged) {
+        pendingSettings = null;
+        return;
+    }
+    var pending = { attempt: 0, timer: null };
+    pendingSettings = pending;
+
+    function attempt() {
+        pending.timer = null;
+        Pebble.sendAppMessage(delta, function() {
+            if (pendingSettings === pending) {
+                pendingSettings = null;
+            }
+            var nowAcked = ackedSettings();
+            Object.keys(delta).forEach(function(key) {
+                nowAcked[key] = delta[key];
+            });
+            localStorage.setItem(ACKED_SETTINGS_KEY, JSON.stringify(nowAcked));
+        }, function() {
+            // A newer save has taken over; let it do the sending
+            if (pendingSettings !== pending) {
+                return;
+            }
+            if (pending.attempt >= SETTINGS_RETRIES) {
+                console.log('Failed to send settings, giving up');
+                pendingSettings = null;
+                return;
+            }
+            var delay = SETTINGS_RETRY_FIRST_MS * Math.pow(2, pending.attempt);
+            pending.attempt++;
+            console.log('Failed to send settings, retrying in ' + delay +
+                'ms');
+            pending.timer = setTimeout(attempt, delay);
+        });
+    }
+    attempt();
+}
+
+Pebble.addEventListener('showConfiguration', function() {
+    Pebble.openURL(getClay().generateUrl());
+});
+
+Pebble.addEventListener('webviewclosed', function(e) {
+    if (!e || !e.response) {
+        return;
+    }
+    var settings = getClay().getSettings(e.response, false);
+    sendSettings({
+        SettingsBits: packSettings(settings),
+        PowerThresholds: packPowerThresholds(settings)
+    });
+});
+
+// Hourly render telemetry from watches with the SendTelemetry setting on (see
+// src/c/telemetry.c for the layout). Totals are kept across launches
+var TELEMETRY_VERSION = 2;
+var POWER_TIERS = ['full', 'reduced', 'static'];
+var TELEMETRY_BUCKETS = ['0ms', '1ms', '2-3ms', '4-7ms', '8-15ms', '16-31ms',
+    '32-63ms', '64ms+'];
+
+function readU16(bytes, at) {
+    return bytes[at] | (bytes[at + 1] << 8);
+}
+
+function readU32(bytes, at) {
+    return (readU16(bytes, at) + (readU16(bytes, at + 2) * 65536));
+}
+
+function decodeTelemetry(bytes) {
+    if (bytes.length < 36 || bytes[0] !== TELEMETRY_VERSION) {
+        return null;
+    }
+    var histogram = [];
+    for (var i = 0; i < TELEMETRY_BUCKETS.length; i++) {
+        histogram.push(readU16(bytes, 16 + (i * 2)));
+    }
+    return {
+        hour: bytes[1],
+        updates: readU16(bytes, 2),
+        renders: readU16(bytes, 4),
+        drawCalls: readU32(bytes, 6),
+        stateChanges: readU32(bytes, 10),
+        maxMs: readU16(bytes, 14),
+        histogram: histogram,
+        tierSwitches: readU16(bytes, 32),
+        tier: POWER_TIERS[bytes[34]] || String(bytes[34]),
+        // Release builds don't count draws; see TELEMETRY_FLAG_DRAW_COUNTS
+        hasDrawCounts: (bytes[35] & 1) !== 0
+    };
+}
+
+function addTelemetry(batch) {
+    var totals = JSON.parse(localStorage.getItem('telemetry') || 'null') || {
+        batches: 0, updates: 0, renders: 0, drawCalls: 0, stateChanges: 0,
+        maxMs: 0, histogram: [0, 0, 0, 0, 0, 0, 0, 0]
+    };
+    totals.batches++;
+    totals.updates += batch.updates;
+    totals.renders += batch.renders;
+    if (batch.hasDrawCounts) {
+        // Totals from before draw counts were optional count every update
+        totals.drawUpdates = (totals.drawUpdates === undefined ?
+            totals.updates - batch.updates : totals.drawUpdates) +
+            batch.updates;
+        totals.drawCalls += batch.drawCalls;
+        totals.stateChanges += batch.stateChanges;
+    }
+    totals.maxMs = Math.max(totals.maxMs, batch.maxMs);
+    for (var i = 0; i < batch.histogram.length; i++) {
+        totals.histogram[i] += batch.histogram[i];
+    }
+    localStorage.setItem('telemetry', JSON.stringify(totals));
+    return totals;
+}
+
+// The watch reports the settings it runs on launch and on reconnect (see
+// send_settings_report() in watchface.c). If that isn't what was last
+// acknowledged, say after a reinstall, the record is stale: the report
+// replaces it, so the next save sends whatever differs from the watch
+function checkSettingsReport(payload) {
+    var acked = ackedSettings();
+    var isStale = false;
+    var report = {};
+    ['SettingsBits', 'PowerThresholds'].forEach(function(key) {
+        report[key] = payload[key];
+        if (acked[key] !== payload[key]) {
+            isStale = true;
+        }
+    });
+    if (isStale) {
+        console.log('Watch settings differ from the last acknowledged, ' +
+            'dropping those');
+        localStorage.setItem(ACKED_SETTINGS_KEY, JSON.stringify(report));
+    }
+}
+
+Pebble.addEventListener('appmessage', function(e) {
+    var payload = e.payload;
+    if (payload && payload.SettingsBits !== undefined) {
+        checkSettingsReport(payload);
+        return;
+    }
+    if (!payload || payload.Telemetry === undefined) {
+        return;
+    }
+    var batch = decodeTelemetry(payload.Telemetry);
+    if (!batch) {
+        console.log('TELEMETRY unknown batch format, ignored');
+        return;
+    }
+    var totals = addTelemetry(batch);
+    var histogram = totals.histogram.map(function(count, i) {
+        return TELEMETRY_BUCKETS[i] + '=' + count;
+    }).join(' ');
+    console.log('TELEMETRY hour=' + batch.hour +
+        ' updates=' + batch.updates + ' renders=' + batch.renders +
+        ' draws=' + (batch.hasDrawCounts ? batch.drawCalls : 'n/a') +
+        ' max_ms=' + batch.maxMs +
+        ' tier_switches=' + batch.tierSwitches + ' tier=' + batch.tier);
+    console.log('TELEMETRY total batches=' + totals.batches +
+        ' renders/update=' + (totals.renders / totals.updates).toFixed(2) +
+        ' draws/update=' + (totals.drawUpdates ?
+            (totals.drawCalls / totals.drawUpdates).toFixed(1) : 'n/a') +
+        ' max_ms=' + totals.maxMs + ' ' + histogram);
+});
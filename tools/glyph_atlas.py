@@ -0,0 +1,165 @@
+"""
+Packs the smears and charging icons into one black and white PNG, so the
+watch loads them with a single resource read (see load_glyph_atlas() in
+src/c/watchface.c), and the glyphs into pages the watch loads only once a
+row draws from them (see src/c/glyphcache.c). Run from wscript on every
+build; it only rewrites an atlas when one of its inputs is newer.
+
+Every cell starts on a multiple of 8 pixels, so each glyph's rows begin on a
+byte boundary of the packed 1-bit bitmap. The ATLAS_* defines in watchface.c
+must match LAYOUT below, and glyphcache.c's page table must match PAGES.
+"""
+
+import os
+import struct
+import zlib
+
+BIG_CELL_W = 32     # 30px glyphs
+SMALL_CELL_W = 16   # 12px glyphs
+ICON_CELL_W = 16    # 9px icons
+
+BIG_GLYPHS = ['0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+              'A', 'B', 'C', 'D', 'E', 'F']
+SMALL_GLYPHS = ['SMALL_' + c for c in
+                ['0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+                 'A', 'B', 'C', 'D', 'E', 'F',
+                 'H', 'M', 'O', 'R', 'S', 'T', 'U', 'W']]
+
+# (y, cell width, height, images left to right)
+LAYOUT = [
+    (0, BIG_CELL_W, 45, ['SMEAR_25', 'SMEAR_125']),
+    (45, SMALL_CELL_W, 18, ['SMEAR_SMALL_25', 'SMEAR_SMALL_125']),
+    (63, ICON_CELL_W, 5, ['charging_icon', 'charging_icon_low']),
+]
+
+# Each glyph page is one row of cells. Decimal mode never draws the big hex
+# page (the day of the week borrows the small E, F and A), and hex mode never
+# draws the day-of-week letters
+PAGES = {
+    'glyph_page_big_digits': [(0, BIG_CELL_W, 45, BIG_GLYPHS[:10])],
+    'glyph_page_big_hex': [(0, BIG_CELL_W, 45, BIG_GLYPHS[10:])],
+    'glyph_page_small_digits': [(0, SMALL_CELL_W, 18, SMALL_GLYPHS[:10])],
+    'glyph_page_small_hex': [(0, SMALL_CELL_W, 18, SMALL_GLYPHS[10:16])],
+    'glyph_page_small_letters': [(0, SMALL_CELL_W, 18, SMALL_GLYPHS[16:])],
+}
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+
+def _paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def read_png(path):
+    """Returns (width, height, rows), rows holding True wherever there's ink"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != PNG_SIGNATURE:
+        raise ValueError('{} is not a PNG'.format(path))
+
+    pos = 8
+    idat = b''
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        body = data[pos + 8:pos + 8 + length]
+        if kind == b'IHDR':
+            width, height, depth, color_type, _, _, interlace = \
+                struct.unpack('>IIBBBBB', body)
+        elif kind == b'IDAT':
+            idat += body
+        pos += 12 + length
+
+    channels = {0: 1, 2: 3, 4: 2, 6: 4}.get(color_type)
+    if depth != 8 or channels is None or interlace:
+        raise ValueError('{}: only 8-bit, non-interlaced gray/RGB(A) PNGs '
+                         'are supported'.format(path))
+
+    raw = bytearray(zlib.decompress(idat))
+    stride = width * channels
+    prev = bytearray(stride)
+    rows = []
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = raw[start + 1:start + 1 + stride]
+        for i in range(stride):
+            left = line[i - channels] if i >= channels else 0
+            up = prev[i]
+            up_left = prev[i - channels] if i >= channels else 0
+            if kind == 1:
+                line[i] = (line[i] + left) & 0xFF
+            elif kind == 2:
+                line[i] = (line[i] + up) & 0xFF
+            elif kind == 3:
+                line[i] = (line[i] + ((left + up) >> 1)) & 0xFF
+            elif kind == 4:
+                line[i] = (line[i] + _paeth(left, up, up_left)) & 0xFF
+        prev = line
+
+        ink = []
+        for x in range(width):
+            px = line[x * channels:(x + 1) * channels]
+            alpha = px[-1] if channels in (2, 4) else 255
+            gray = px[0] if channels < 3 else (px[0] + px[1] + px[2]) // 3
+            # Transparent pixels are paper, like the SDK's own conversion
+            ink.append(alpha >= 128 and gray < 128)
+        rows.append(ink)
+    return width, height, rows
+
+
+def _chunk(kind, body):
+    return (struct.pack('>I', len(body)) + kind + body +
+            struct.pack('>I', zlib.crc32(kind + body) & 0xFFFFFFFF))
+
+
+def write_png(path, width, height, rows):
+    """Writes an 8-bit grayscale PNG, ink black and everything else white"""
+    raw = bytearray()
+    for ink in rows:
+        raw.append(0)
+        raw.extend(0 if is_ink else 255 for is_ink in ink)
+    with open(path, 'wb') as f:
+        f.write(PNG_SIGNATURE)
+        f.write(_chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 0,
+                                            0, 0, 0)))
+        f.write(_chunk(b'IDAT', zlib.compress(bytes(raw), 9)))
+        f.write(_chunk(b'IEND', b''))
+
+
+def build_atlas(image_dir, out_path, layout=LAYOUT):
+    inputs = [os.path.join(image_dir, name + '.png')
+              for _, _, _, names in layout for name in names]
+    if os.path.exists(out_path):
+        out_mtime = os.path.getmtime(out_path)
+        if all(os.path.getmtime(p) <= out_mtime for p in inputs + [__file__]):
+            return False
+
+    width = max(cell_w * len(names) for _, cell_w, _, names in layout)
+    height = max(y + h for y, _, h, _ in layout)
+    atlas = [[False] * width for _ in range(height)]
+    for y, cell_w, cell_h, names in layout:
+        for i, name in enumerate(names):
+            w, h, rows = read_png(os.path.join(image_dir, name + '.png'))
+            if w > cell_w or h != cell_h:
+                raise ValueError('{}.png is {}x{}, expected at most {}x{}'
+                                 .format(name, w, h, cell_w, cell_h))
+            for row in range(h):
+                atlas[y + row][i * cell_w:i * cell_w + w] = rows[row]
+    write_png(out_path, width, height, atlas)
+    return True
+
+
+def build_all(image_dir):
+    """The atlas and every glyph page, each next to its source images"""
+    build_atlas(image_dir, os.path.join(image_dir, 'glyph_atlas.png'))
+    for name, layout in PAGES.items():
+        build_atlas(image_dir, os.path.join(image_dir, name + '.png'), layout)
+
+
+if __name__ == '__main__':
+    here = os.path.dirname(os.path.abspath(__file__))
+    build_all(os.path.join(here, '..', 'resources', 'images'))
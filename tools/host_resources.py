@@ -0,0 +1,119 @@
+"""
+Generates what the host build (host/Makefile) takes from the SDK's build
+instead: resource_ids.auto.h and message_keys.auto.h, numbered as the SDK
+numbers them, and resources.auto.c, with each bitmap resource packed as the
+watch loads a 1BitPalette one (see HostResource in host/pebble_host.h). Also
+runs the steps wscript runs before a build: the glyph atlas and pages, the
+layout tables and the replay trace header.
+
+    python3 tools/host_resources.py host/build/gen
+"""
+
+import json
+import os
+import sys
+
+import glyph_atlas
+import layout_tables
+import replay
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+
+# The SDK numbers message keys from here, in package.json's order
+FIRST_MESSAGE_KEY = 10000
+
+
+def write_if_changed(path, text):
+    """Only touches the file when its contents change, to spare rebuilds"""
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return False
+    with open(path, 'w') as f:
+        f.write(text)
+    return True
+
+
+def pack_1bit_palette(path):
+    """Rows of (width + 7) / 8 bytes, top bit leftmost, ink at index 0"""
+    width, height, rows = glyph_atlas.read_png(path)
+    data = bytearray()
+    for ink in rows:
+        for x in range(0, width, 8):
+            byte = 0
+            for bit, is_ink in enumerate(ink[x:x + 8]):
+                if not is_ink:
+                    byte |= 0x80 >> bit
+            data.append(byte)
+    return width, height, bytes(data)
+
+
+def resource_ids(media):
+    lines = ['#pragma once', '', '// Generated by tools/host_resources.py',
+             '']
+    for i, resource in enumerate(media):
+        lines.append('#define RESOURCE_ID_{} {}'.format(resource['name'],
+                                                        i + 1))
+    return '\n'.join(lines) + '\n'
+
+
+def message_keys(keys):
+    lines = ['#pragma once', '', '// Generated by tools/host_resources.py',
+             '']
+    for i, key in enumerate(keys):
+        lines.append('#define MESSAGE_KEY_{} {}'.format(
+            key, FIRST_MESSAGE_KEY + i))
+    return '\n'.join(lines) + '\n'
+
+
+def resources(media, image_dir):
+    lines = ['// Generated by tools/host_resources.py', '',
+             '#include "pebble_host.h"', '']
+    entries = []
+    for i, resource in enumerate(media):
+        if resource.get('memoryFormat') != '1BitPalette':
+            entries.append('    {0, 0, NULL},')
+            continue
+        width, height, data = pack_1bit_palette(
+            os.path.join(image_dir, os.path.basename(resource['file'])))
+        name = 'RESOURCE_{}'.format(resource['name'])
+        lines.append('static const uint8_t {}[] = {{'.format(name))
+        for start in range(0, len(data), 12):
+            lines.append('    ' + ' '.join(
+                '0x{:02x},'.format(b) for b in data[start:start + 12]))
+        lines.append('};')
+        lines.append('')
+        entries.append('    {{{}, {}, {}}},'.format(width, height, name))
+    lines.append('const HostResource HOST_RESOURCES[] = {')
+    lines.append('    {0, 0, NULL}, // Ids start at 1')
+    lines.extend(entries)
+    lines.append('};')
+    lines.append('')
+    lines.append('const int HOST_RESOURCE_COUNT = {};'.format(len(media) + 1))
+    return '\n'.join(lines) + '\n'
+
+
+def generate(out_dir):
+    with open(os.path.join(ROOT, 'package.json')) as f:
+        pebble = json.load(f)['pebble']
+    image_dir = os.path.join(ROOT, 'resources', 'images')
+    src_dir = os.path.join(ROOT, 'src', 'c')
+
+    glyph_atlas.build_all(image_dir)
+    layout_tables.write_header(os.path.join(src_dir, 'layout_tables.auto.h'))
+    replay.ensure_header(os.path.join(src_dir, 'replay_trace.auto.h'))
+
+    media = pebble['resources']['media']
+    os.makedirs(out_dir, exist_ok=True)
+    write_if_changed(os.path.join(out_dir, 'resource_ids.auto.h'),
+                     resource_ids(media))
+    write_if_changed(os.path.join(out_dir, 'message_keys.auto.h'),
+                     message_keys(pebble['messageKeys']))
+    write_if_changed(os.path.join(out_dir, 'resources.auto.c'),
+                     resources(media, image_dir))
+
+
+if __name__ == '__main__':
+    if len(sys.argv) != 2:
+        sys.exit('usage: host_resources.py <out dir>')
+    generate(sys.argv[1])
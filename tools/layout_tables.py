@@ -0,0 +1,297 @@
+"""
+Generates src/c/layout_tables.auto.h: for every value each row can show, on
+every platform geometry, where the value goes and which glyphs make it up;
+and for every height Timeline Quick View can leave the face, where the rows
+go. Run from wscript on every build, so a frame only ever looks things up.
+
+The positions reproduce the float math the face used to do per frame
+(single precision, truncated to int), so nothing moves by a pixel. The
+geometry below must match the defines at the top of src/c/watchface.c;
+the header carries a copy of it that watchface.c checks at compile time.
+"""
+
+import os
+import struct
+
+BIG_DIGIT_WIDTH_PX = 30
+BIG_DIGIT_HEIGHT_PX = 45
+BIG_DIGIT_SLIM_WIDTH_PX = 6
+SMALL_DIGIT_WIDTH_PX = 12
+SMALL_DIGIT_HEIGHT_PX = 18
+SMALL_DIGIT_SLIM_WIDTH_PX = 3
+INTERNAL_FONT_PADDING_PX = 4
+BATTERY_BAR_COUNT = 5
+SECONDS_ROW_HEIGHT_PX = 8
+
+# Rows top to bottom, as RowSlot orders them: hours, minutes, seconds -
+# connected - battery, then the three date rows
+ROW_HEIGHTS_PX = [BIG_DIGIT_HEIGHT_PX, BIG_DIGIT_HEIGHT_PX,
+                  SECONDS_ROW_HEIGHT_PX, SMALL_DIGIT_HEIGHT_PX,
+                  SMALL_DIGIT_HEIGHT_PX, SMALL_DIGIT_HEIGHT_PX]
+# When the face is obstructed, the rows it keeps: all of them, then the time
+# and seconds, then the time alone; the first that fits is used
+REFLOW_ROW_COUNTS = [6, 3, 2]
+# The seconds comb draws 1px into the padding below its row
+MIN_ROW_PADDING_PX = 1
+
+# (platform defines, display width, horizontal padding, display height,
+#  extra vertical padding on top)
+GEOMETRIES = [
+    (['PBL_PLATFORM_APLITE', 'PBL_PLATFORM_BASALT', 'PBL_PLATFORM_DIORITE',
+      'PBL_PLATFORM_FLINT'], 144, 2, 168, 0),
+    (['PBL_PLATFORM_EMERY'], 200, 8, 228, 5),
+]
+
+HOUR_OF_DAY, MINUTE_OF_HOUR, DAY_OF_WEEK, DAY_OF_MONTH, MONTH_OF_YEAR = \
+    range(5)
+
+# Small atlas cells for the non-hex day of week: 0 - F, then H M O R S T U W
+DAY_OF_WEEK_LETTERS = [(20, 22),  # SU
+                       (17, 18),  # MO
+                       (21, 22),  # TU
+                       (23, 14),  # WE
+                       (21, 16),  # TH
+                       (15, 19),  # FR
+                       (20, 10)]  # SA
+
+GLYPH_NONE = 0xFF
+
+
+def f32(value):
+    """Rounds to the nearest single precision float, like the ARM build"""
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+def track_x(pad, position, divisor, movement_width):
+    # int x = pad + ((float)position / divisor) * movement_width;
+    pct = f32(f32(position) / f32(divisor))
+    return int(f32(pad + f32(pct * movement_width)))
+
+
+def row_layout(row_type, value, x, is_hex):
+    """(x, left glyph, right glyph, ghost step), as render_hex_row did it"""
+    is_small = row_type in (DAY_OF_WEEK, DAY_OF_MONTH, MONTH_OF_YEAR)
+    char_w = SMALL_DIGIT_WIDTH_PX if is_small else BIG_DIGIT_WIDTH_PX
+    slim_char_w = (SMALL_DIGIT_SLIM_WIDTH_PX if is_small
+                   else BIG_DIGIT_SLIM_WIDTH_PX)
+    is_dow_letters = row_type == DAY_OF_WEEK and not is_hex
+    is_double_wide = (value >= 16 if is_hex
+                      else value >= 10 or row_type == MINUTE_OF_HOUR) or \
+        is_dow_letters
+    total_block_w = (char_w * 2 + INTERNAL_FONT_PADDING_PX if is_double_wide
+                     else char_w)
+
+    # Single glyphs in rows that are sometimes double wide sit one glyph
+    # (or one slim glyph) to the right, so they still seem to advance
+    is_single_char_only_row = is_hex and row_type in (DAY_OF_WEEK,
+                                                      MONTH_OF_YEAR)
+    is_slim_first_digit_row = row_type == HOUR_OF_DAY or \
+        (row_type == DAY_OF_MONTH and is_hex)
+    if not is_double_wide and not is_single_char_only_row:
+        x += ((slim_char_w if is_slim_first_digit_row else char_w) +
+              INTERNAL_FONT_PADDING_PX)
+
+    if is_dow_letters:
+        glyphs = DAY_OF_WEEK_LETTERS[value - 1]
+    elif is_double_wide:
+        base = 16 if is_hex else 10
+        glyphs = (value // base, value % base)
+    else:
+        glyphs = (value, GLYPH_NONE)
+    return x, glyphs[0], glyphs[1], total_block_w + INTERNAL_FONT_PADDING_PX
+
+
+def geometry_tables(width, pad):
+    track_w = width - 2 * pad
+    double_big_w = track_w - BIG_DIGIT_WIDTH_PX * 2 - INTERNAL_FONT_PADDING_PX
+    single_small_w = track_w - SMALL_DIGIT_WIDTH_PX
+    double_small_w = (track_w - SMALL_DIGIT_WIDTH_PX * 2 -
+                      INTERNAL_FONT_PADDING_PX)
+
+    def by_mode(entries):
+        return [entries(is_hex) for is_hex in (False, True)]
+
+    def hours(is_hex, is_12h):
+        entries = []
+        for hour in range(24):
+            shown = hour
+            if is_12h:
+                shown = hour - 12 if hour > 11 else hour
+                shown = 12 if shown == 0 else shown
+            entries.append(row_layout(HOUR_OF_DAY, shown,
+                                      track_x(pad, hour, 23, double_big_w),
+                                      is_hex))
+        return entries
+
+    return [
+        ('HOURS_LAYOUT', '[2][2][24]',
+         by_mode(lambda is_hex: [hours(is_hex, False), hours(is_hex, True)])),
+        ('MINUTES_LAYOUT', '[2][60]', by_mode(lambda is_hex: [
+            row_layout(MINUTE_OF_HOUR, m, track_x(pad, m, 59, double_big_w),
+                       is_hex) for m in range(60)])),
+        ('DAY_OF_WEEK_LAYOUT', '[2][7]', by_mode(lambda is_hex: [
+            row_layout(DAY_OF_WEEK, d,
+                       track_x(pad, d - 1, 6, single_small_w if is_hex
+                               else double_small_w), is_hex)
+            for d in range(1, 8)])),
+        ('MONTH_LAYOUT', '[2][12]', by_mode(lambda is_hex: [
+            # Decimal Oct-Dec are double wide, so their track stops short by
+            # a glyph and a gap, as the weekday letters' does
+            row_layout(MONTH_OF_YEAR, m,
+                       track_x(pad, m, 12, single_small_w if is_hex
+                               else double_small_w), is_hex)
+            for m in range(1, 13)])),
+        ('DAY_OF_MONTH_LAYOUT', '[2][31]', by_mode(lambda is_hex: [
+            row_layout(DAY_OF_MONTH, d, track_x(pad, d, 31, double_small_w),
+                       is_hex) for d in range(1, 32)])),
+    ]
+
+
+def row_padding(height):
+    """Padding under each row, and above the first, at full height"""
+    return (height - sum(ROW_HEIGHTS_PX)) // (len(ROW_HEIGHTS_PX) + 2)
+
+
+def reflow_min_height():
+    rows = REFLOW_ROW_COUNTS[-1]
+    return sum(ROW_HEIGHTS_PX[:rows]) + MIN_ROW_PADDING_PX * (rows + 2)
+
+
+def reflow(height, display_height, extra):
+    """(top, padding, rows shown) for an unobstructed height"""
+    if height == display_height:
+        # Unobstructed, the rows sit exactly where they always have
+        padding = row_padding(display_height)
+        return padding + extra, padding, len(ROW_HEIGHTS_PX)
+    for rows in REFLOW_ROW_COUNTS:
+        spare = height - sum(ROW_HEIGHTS_PX[:rows])
+        if spare >= MIN_ROW_PADDING_PX * (rows + 2):
+            break
+    # Same split as at full height, with what's left over shared above and
+    # below
+    padding = spare // (rows + 2)
+    return padding + (spare - padding * (rows + 2)) // 2, padding, rows
+
+
+def reflow_table(display_height, extra):
+    return [reflow(h, display_height, extra)
+            for h in range(reflow_min_height(), display_height + 1)]
+
+
+def battery_bar_counts():
+    # (int)round(((float)percent / 100.0F) * 5.0F), rounding half away
+    counts = []
+    for percent in range(101):
+        bars = f32(f32(f32(percent) / f32(100.0)) * BATTERY_BAR_COUNT)
+        counts.append(int(bars + 0.5))
+    return counts
+
+
+def _format_entries(value, indent):
+    if isinstance(value, tuple):
+        x, left, right, step = value
+        for field in value:
+            if not 0 <= field <= 0xFF:
+                raise ValueError('layout field {} overflows uint8_t'
+                                 .format(field))
+        return '{{{}, {{{}, {}}}, {}}}'.format(
+            x, left, 'ROW_GLYPH_NONE' if right == GLYPH_NONE else right, step)
+    inner = indent + '    '
+    if isinstance(value[0], tuple):
+        # Leaf rows: several entries per line
+        items = [_format_entries(v, inner) for v in value]
+        lines, line = [], ''
+        for item in items:
+            if line and len(inner) + len(line) + len(item) + 2 > 80:
+                lines.append(line.rstrip())
+                line = ''
+            line += item + ', '
+        lines.append(line.rstrip(', '))
+        return '{\n' + ''.join(inner + l + '\n' for l in lines) + indent + '}'
+    return ('{\n' + ',\n'.join(inner + _format_entries(v, inner)
+                               for v in value) + '\n' + indent + '}')
+
+
+def generate():
+    out = [
+        '// Generated by tools/layout_tables.py on every build; do not edit',
+        '// [is_hex] first; hours are [is_hex][is_12h_style][hour 0 - 23] and',
+        '// the rest are indexed by their value minus its first value',
+        '',
+        '#pragma once',
+        '',
+        '#include "layout.h"',
+        '',
+    ]
+    for i, (defines, width, pad, height, extra) in enumerate(GEOMETRIES):
+        condition = ' || '.join('defined({})'.format(d) for d in defines)
+        out.append('{} {}'.format('#if' if i == 0 else '#elif', condition))
+        out.append('#define LAYOUT_TABLES_DISPLAY_WIDTH_PX {}'.format(width))
+        out.append('#define LAYOUT_TABLES_HORIZONTAL_PADDING_PX {}'
+                   .format(pad))
+        out.append('#define LAYOUT_TABLES_DISPLAY_HEIGHT_PX {}'.format(height))
+        out.append('#define LAYOUT_TABLES_VERTICAL_PADDING_PX {}'
+                   .format(row_padding(height)))
+        out.append('#define LAYOUT_TABLES_EXTRA_VERTICAL_PADDING_PX {}'
+                   .format(extra))
+        for name, dims, entries in geometry_tables(width, pad):
+            out.append('static const RowLayout {}{} = {};'.format(
+                name, dims, _format_entries(entries, '')))
+        reflows = reflow_table(height, extra)
+        out.append('// [unobstructed height - '
+                   'LAYOUT_TABLES_REFLOW_MIN_HEIGHT_PX]')
+        out.append('static const RowReflow ROW_REFLOWS[{}] = {{'
+                   .format(len(reflows)))
+        line = ''
+        for entry in reflows:
+            item = '{{{}, {}, {}}}, '.format(*entry)
+            if line and 4 + len(line) + len(item) > 81:
+                out.append('    ' + line.rstrip())
+                line = ''
+            line += item
+        out.append('    ' + line.rstrip(', '))
+        out.append('};')
+    out.append('#else')
+    out.append('#error "No layout tables for this platform"')
+    out.append('#endif')
+    out.append('')
+    out.append('#define LAYOUT_TABLES_BIG_DIGIT_WIDTH_PX {}'
+               .format(BIG_DIGIT_WIDTH_PX))
+    out.append('#define LAYOUT_TABLES_SMALL_DIGIT_WIDTH_PX {}'
+               .format(SMALL_DIGIT_WIDTH_PX))
+    out.append('#define LAYOUT_TABLES_FONT_PADDING_PX {}'
+               .format(INTERNAL_FONT_PADDING_PX))
+    out.append('#define LAYOUT_TABLES_BIG_DIGIT_HEIGHT_PX {}'
+               .format(BIG_DIGIT_HEIGHT_PX))
+    out.append('#define LAYOUT_TABLES_SMALL_DIGIT_HEIGHT_PX {}'
+               .format(SMALL_DIGIT_HEIGHT_PX))
+    out.append('#define LAYOUT_TABLES_SECONDS_ROW_HEIGHT_PX {}'
+               .format(SECONDS_ROW_HEIGHT_PX))
+    out.append('#define LAYOUT_TABLES_REFLOW_MIN_HEIGHT_PX {}'
+               .format(reflow_min_height()))
+    out.append('')
+    counts = battery_bar_counts()
+    out.append('// Bars for each battery percentage, 0 - 100')
+    out.append('static const uint8_t BATTERY_BAR_COUNTS[101] = {')
+    for start in range(0, 101, 25):
+        out.append('    ' + ', '.join(str(c) for c in counts[start:start + 25])
+                   + (',' if start + 25 < 101 else ''))
+    out.append('};')
+    return '\n'.join(out) + '\n'
+
+
+def write_header(path):
+    """Only touches the header when its contents change, to spare rebuilds"""
+    text = generate()
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return False
+    with open(path, 'w') as f:
+        f.write(text)
+    return True
+
+
+if __name__ == '__main__':
+    here = os.path.dirname(os.path.abspath(__file__))
+    write_header(os.path.join(here, '..', 'src', 'c', 'layout_tables.auto.h'))
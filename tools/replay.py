@@ -0,0 +1,364 @@
+"""
+Replays a day of events through the REPLAY_MODE build (see src/c/common.h)
+for every platform at once, under each candidate setting, and reports what
+each simulated day cost: wakeups, frames, draw calls, pixels, motor time and
+AppMessage bytes. These stand in for energy, which neither the host build
+nor the emulator can measure.
+
+    python3 tools/replay.py capture debug.log -o day.trace  # TRACE lines
+    python3 tools/replay.py use day.trace --candidates default+PowerGovernor
+    python3 tools/replay.py use --days 3      # the synthetic trace instead
+    python3 tools/replay.py run               # host builds (host/Makefile)
+    pebble build                              # with REPLAY_MODE uncommented
+    python3 tools/replay.py run --emulator    # all emulators, in parallel
+    python3 tools/replay.py report replay_logs/basalt.log ...
+
+A trace file is one event per line, "<seconds> <kind> <value>", seconds
+counted from its first midnight, which a "start <epoch>" line gives. Debug
+builds log each event the face gets as a TRACE line, so a day on a real
+watch with DEBUG_MODE on captures a real trace. wscript writes the synthetic
+trace's header when there isn't one yet.
+"""
+
+import argparse
+import calendar
+import os
+import random
+import re
+import subprocess
+import sys
+import threading
+from multiprocessing.pool import ThreadPool
+
+PLATFORMS = ['aplite', 'basalt', 'diorite', 'flint', 'emery']
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HOST_DIR = os.path.join(os.path.dirname(HERE), 'host')
+HEADER_PATH = os.path.join(os.path.dirname(HERE), 'src', 'c',
+                           'replay_trace.auto.h')
+
+DAY_S = 24 * 60 * 60
+# Must match ReplayEventKind in src/c/replay.h
+KINDS = ['battery', 'bluetooth', 'settings', 'thresholds', 'tap']
+
+# Must match SettingsBit in src/c/watchface.c
+SETTING_BITS = {
+    'HexMode': 1 << 0,
+    'PowerMode': 1 << 1,
+    'ColorizeDigits': 1 << 2,
+    'GhostTime': 1 << 3,
+    'GhostDate': 1 << 4,
+    'HourlyVibrate': 1 << 5,
+    'DisconnectVibrate': 1 << 6,
+    'AnimateTransitions': 1 << 7,
+    'PowerGovernor': 1 << 8,
+    'SendTelemetry': 1 << 9,
+}
+DEFAULT_BITS = (SETTING_BITS['HexMode'] | SETTING_BITS['PowerMode'] |
+                SETTING_BITS['GhostTime'] | SETTING_BITS['DisconnectVibrate'])
+DEFAULT_CANDIDATES = ['default', 'default-PowerMode', 'default+PowerGovernor',
+                      'default+AnimateTransitions', 'default+HourlyVibrate']
+
+# A Monday, so a multi-day synthetic trace starts on a working week
+SYNTHETIC_START = calendar.timegm((2026, 1, 5, 0, 0, 0))
+
+TRACE_RE = re.compile(r'TRACE t=(\d+) (\w+)=(-?\d+)')
+DAY_RE = re.compile(r'REPLAY s=0x([0-9a-f]+) day=(\d+) wakeups=(\d+) '
+                    r'frames=(\d+) draws=(\d+) px=(\d+) vibe_ms=(\d+) '
+                    r'msg_bytes=(\d+)')
+DONE_RE = re.compile(r'REPLAY done candidates=(\d+) days=(\d+)')
+COLUMNS = ['wakeups', 'frames', 'draws', 'px', 'vibe_ms', 'msg_bytes']
+
+
+def battery_value(percent, is_charging=False, is_plugged=False):
+    """Packed as REPLAY_EVENT_BATTERY is"""
+    return percent | (is_charging << 8) | (is_plugged << 9)
+
+
+def synthetic_day(rng):
+    """One made-up day of (seconds, kind, value): worn from 7:00 to 23:00,
+    with wrist flicks while worn, two spells away from the phone, the
+    battery falling in the 10% steps the firmware reports and charging
+    before midnight"""
+    events = [(0, 'bluetooth', 1), (0, 'battery', battery_value(80))]
+    for hour in range(7, 23):
+        for _ in range(rng.randint(2, 10)):
+            events.append((hour * 3600 + rng.randrange(3600), 'tap',
+                           rng.randrange(3)))
+    for start_h, minutes in ((12.5, 15), (18.25, 10)):
+        start = int(start_h * 3600) + rng.randrange(600)
+        events.append((start, 'bluetooth', 0))
+        events.append((start + minutes * 60, 'bluetooth', 1))
+    for step, percent in enumerate(range(70, 20, -10)):
+        events.append((int((step + 1) * 3.5 * 3600) + rng.randrange(900),
+                       'battery', battery_value(percent)))
+    charge_start = 22 * 3600 + rng.randrange(1800)
+    for step, percent in enumerate(range(30, 90, 10)):
+        events.append((charge_start + step * 900, 'battery',
+                       battery_value(percent, True, True)))
+    return sorted(events)
+
+
+def synthetic_trace(days):
+    events = []
+    for day in range(days):
+        rng = random.Random(day)
+        events += [(t + day * DAY_S, kind, value)
+                   for t, kind, value in synthetic_day(rng)]
+    return SYNTHETIC_START, days, events
+
+
+def read_trace(path):
+    """Returns (start epoch, days, [(seconds, kind, value)])"""
+    start, events = None, []
+    with open(path) as f:
+        for number, line in enumerate(f, 1):
+            fields = line.split('#')[0].split()
+            if not fields:
+                continue
+            if fields[0] == 'start' and len(fields) == 2:
+                start = int(fields[1])
+            elif len(fields) == 3 and fields[1] in KINDS:
+                events.append((int(fields[0]), fields[1], int(fields[2], 0)))
+            else:
+                raise SystemExit('{}:{}: not an event'.format(path, number))
+    if start is None:
+        raise SystemExit('{}: no start line'.format(path))
+    events.sort()
+    days = max(1, -(-(events[-1][0] + 1) // DAY_S)) if events else 1
+    return start, days, events
+
+
+def write_trace(path, start, events):
+    with open(path, 'w') as f:
+        f.write('start {}\n'.format(start))
+        for t, kind, value in events:
+            f.write('{} {} {}\n'.format(t, kind, value))
+
+
+def capture(log_paths):
+    """TRACE lines from debug logs, as a trace from their first midnight"""
+    stamped = []
+    for path in log_paths:
+        with open(path) as f:
+            for line in f:
+                match = TRACE_RE.search(line)
+                if match and match.group(2) in KINDS:
+                    stamped.append((int(match.group(1)), match.group(2),
+                                    int(match.group(3))))
+    if not stamped:
+        raise SystemExit('no TRACE lines; capture from a DEBUG_MODE build')
+    stamped.sort()
+    start = stamped[0][0] - stamped[0][0] % DAY_S
+    return start, [(t - start, kind, value) for t, kind, value in stamped]
+
+
+def parse_candidate(text):
+    """A number, or default with settings added (+Name) or taken off
+    (-Name), like default-PowerMode+GhostDate"""
+    try:
+        return int(text, 0)
+    except ValueError:
+        pass
+    bits = DEFAULT_BITS
+    for sign, name in re.findall(r'([+-]?)(\w+)', text):
+        if name == 'default':
+            continue
+        if name not in SETTING_BITS:
+            raise SystemExit('unknown setting {}; one of {}'.format(
+                name, ', '.join(SETTING_BITS)))
+        if sign == '-':
+            bits &= ~SETTING_BITS[name]
+        else:
+            bits |= SETTING_BITS[name]
+    return bits
+
+
+def generate(start, days, events, candidates, source):
+    lines = [
+        '// Generated by tools/replay.py from {}; do not edit'.format(source),
+        '',
+        '#pragma once',
+        '',
+        '#include "replay.h"',
+        '',
+        '#define REPLAY_TRACE_START {}'.format(start),
+        '#define REPLAY_TRACE_DAYS {}'.format(days),
+        '',
+        'static const ReplayEvent REPLAY_EVENTS[] = {',
+    ]
+    for t, kind, value in events:
+        lines.append('    {{{}, REPLAY_EVENT_{}, {}}},'.format(
+            t, kind.upper(), value))
+    if not events:
+        # C has no empty initializers
+        lines.append('    {{{}, REPLAY_EVENT_BLUETOOTH, 1}},'.format(
+            days * DAY_S - 1))
+    lines.append('};')
+    lines.append('')
+    lines.append('static const uint32_t REPLAY_CANDIDATES[] = {' +
+                 ', '.join('0x{:03x}'.format(c) for c in candidates) + '};')
+    return '\n'.join(lines) + '\n'
+
+
+def write_header(text, path=HEADER_PATH):
+    """Only touches the header when its contents change, to spare rebuilds"""
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return False
+    with open(path, 'w') as f:
+        f.write(text)
+    return True
+
+
+def ensure_header(path=HEADER_PATH):
+    """From wscript: a REPLAY_MODE build needs some trace to compile"""
+    if os.path.exists(path):
+        return False
+    start, days, events = synthetic_trace(1)
+    return write_header(generate(
+        start, days, events, [parse_candidate(c) for c in DEFAULT_CANDIDATES],
+        'the synthetic day'), path)
+
+
+def run_host(platform, log_path, timeout_s):
+    """Runs one platform's host build of the replay"""
+    with open(log_path, 'w') as log:
+        subprocess.run([os.path.join(HOST_DIR, 'build', platform, 'replay')],
+                       stdout=log, stderr=subprocess.STDOUT,
+                       timeout=timeout_s)
+    return log_path
+
+
+def run_emulator(platform, log_path, timeout_s):
+    """Installs the built app on one emulator and logs until the replay
+    ends"""
+    with open(log_path, 'w') as log:
+        proc = subprocess.Popen(
+            ['pebble', 'install', '--emulator', platform, '--logs'],
+            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+            universal_newlines=True)
+        timer = threading.Timer(timeout_s, proc.terminate)
+        timer.start()
+        try:
+            for line in proc.stdout:
+                log.write(line)
+                if DONE_RE.search(line):
+                    break
+        finally:
+            proc.terminate()
+            proc.wait()
+            timer.cancel()
+    return log_path
+
+
+def parse_log(path):
+    """Returns ({settings bits: [per-day counters]}, whether it finished)"""
+    days, is_done = {}, False
+    with open(path) as f:
+        for line in f:
+            match = DAY_RE.search(line)
+            if match:
+                bits = int(match.group(1), 16)
+                days.setdefault(bits, []).append(
+                    [int(v) for v in match.groups()[2:]])
+            elif DONE_RE.search(line):
+                is_done = True
+    return days, is_done
+
+
+def describe(bits):
+    added = [n for n, b in SETTING_BITS.items()
+             if bits & b and not DEFAULT_BITS & b]
+    dropped = [n for n, b in SETTING_BITS.items()
+               if DEFAULT_BITS & b and not bits & b]
+    words = ['+' + n for n in added] + ['-' + n for n in dropped]
+    return ' '.join(words) or 'default'
+
+
+def report(name, log_path):
+    """Prints the per-day average of each candidate; returns whether the
+    replay finished"""
+    days, is_done = parse_log(log_path)
+    print('{}:{}'.format(name, '' if is_done else ' replay never finished'))
+    if not days:
+        return False
+    print('  {:>5} {:>8} {:>7} {:>8} {:>11} {:>8} {:>9}  {}'.format(
+        's', *COLUMNS, 'candidate'))
+    for bits, counters in days.items():
+        mean = [sum(c[i] for c in counters) // len(counters)
+                for i in range(len(COLUMNS))]
+        print('  0x{:03x} {:>8} {:>7} {:>8} {:>11} {:>8} {:>9}  {}'.format(
+            bits, *mean, describe(bits)))
+    return is_done
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    sub = parser.add_subparsers(dest='command')
+    cap = sub.add_parser('capture', help='trace from debug logs')
+    cap.add_argument('logs', nargs='+')
+    cap.add_argument('-o', '--output', required=True)
+    use = sub.add_parser('use', help='write the trace header the build reads')
+    use.add_argument('trace', nargs='?',
+                     help='a trace file; the synthetic trace without one')
+    use.add_argument('--days', type=int, default=1,
+                     help='of the synthetic trace')
+    use.add_argument('--candidates', nargs='+', default=DEFAULT_CANDIDATES,
+                     help='settings bits, or like default+Name-Name')
+    run = sub.add_parser('run', help='replay every platform, then report')
+    run.add_argument('--platforms', nargs='+', default=PLATFORMS,
+                     choices=PLATFORMS)
+    run.add_argument('--emulator', action='store_true',
+                     help='replay the pebble build on the emulators instead')
+    run.add_argument('--log-dir', default='replay_logs')
+    run.add_argument('--timeout', type=int, default=3600,
+                     help='seconds to give each platform')
+    rep = sub.add_parser('report', help='report on existing logs')
+    rep.add_argument('logs', nargs='+')
+    args = parser.parse_args()
+
+    if args.command == 'capture':
+        start, events = capture(args.logs)
+        write_trace(args.output, start, events)
+        print('{} events over {} day(s)'.format(
+            len(events), -(-(events[-1][0] + 1) // DAY_S)))
+        return 0
+    if args.command == 'use':
+        if args.trace:
+            start, days, events = read_trace(args.trace)
+            source = os.path.basename(args.trace)
+        else:
+            start, days, events = synthetic_trace(args.days)
+            source = 'the synthetic trace'
+        candidates = [parse_candidate(c) for c in args.candidates]
+        write_header(generate(start, days, events, candidates, source))
+        print('{} events over {} day(s), {} candidate(s)'.format(
+            len(events), days, len(candidates)))
+        return 0
+    if args.command == 'run':
+        if not args.emulator:
+            subprocess.check_call(['make', '-C', HOST_DIR, '-j{}'.format(
+                os.cpu_count() or 1)] + ['build/{}/replay'.format(p)
+                                         for p in args.platforms])
+        os.makedirs(args.log_dir, exist_ok=True)
+        jobs = [(p, os.path.join(args.log_dir, p + '.log'), args.timeout)
+                for p in args.platforms]
+        # Replays are separate processes; the threads only wait on them
+        with ThreadPool(len(jobs)) as pool:
+            pool.starmap(run_emulator if args.emulator else run_host, jobs)
+        logs = [(p, log) for p, log, _ in jobs]
+    elif args.command == 'report':
+        logs = [(os.path.splitext(os.path.basename(log))[0], log)
+                for log in args.logs]
+    else:
+        parser.print_help()
+        return 2
+
+    is_done = [report(name, log) for name, log in logs]
+    return 0 if all(is_done) else 1
+
+
+if __name__ == '__main__':
+    sys.exit(main())
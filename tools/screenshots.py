@@ -0,0 +1,303 @@
+"""
+Captures the store-page screenshots from the SCREENSHOT_MODE build (see
+src/c/common.h), for every platform at once. The face holds each preset on
+screen and logs a SHOT line. The host build (host/Makefile) writes its
+screen out as a PNG right there; on an emulator this grabs the display. Both
+are at the platform's native resolution and palette.
+
+    python3 tools/screenshots.py run             # into screenshots/
+    python3 tools/screenshots.py run --store-page
+    pebble build                                 # with SCREENSHOT_MODE
+    python3 tools/screenshots.py run --emulator
+    python3 tools/screenshots.py compare before after
+
+compare checks two runs pixel by pixel, for a change that shouldn't alter
+how the face looks.
+"""
+
+import argparse
+import multiprocessing
+import os
+import re
+import struct
+import subprocess
+import sys
+import threading
+import zlib
+from multiprocessing.pool import ThreadPool
+
+PLATFORMS = ['aplite', 'basalt', 'diorite', 'flint', 'emery']
+# Where each of the store page's own PNGs comes from: the platform, and the
+# shot the face logs for it. _pt is the Pebble Time's (basalt) and _pt2 the
+# Pebble Time 2's (emery)
+STORE_PAGE_SHOTS = {
+    'bw_normal': ('aplite', 'bw_normal'),
+    'bw_hex': ('aplite', 'bw_hex'),
+    'color_normal_pt': ('basalt', 'color_normal'),
+    'color_hex_pt': ('basalt', 'color_hex'),
+    'color_normal_pt2': ('emery', 'color_normal'),
+    'color_hex_pt2': ('emery', 'color_hex'),
+}
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HOST_DIR = os.path.join(os.path.dirname(HERE), 'host')
+STORE_PAGE_DIR = os.path.join(os.path.dirname(HERE), 'store-page')
+
+SHOT_RE = re.compile(r'SHOT name=(\w+)')
+DONE_RE = re.compile(r'SHOT done shots=(\d+)')
+WRITE_ERROR_RE = re.compile(r"SHOT couldn't write (.*)")
+
+
+def capture_host(platform, out_dir, timeout_s):
+    """Runs one platform's host build, which writes each shot itself.
+    Returns a list of problems"""
+    platform_dir = os.path.join(out_dir, platform)
+    os.makedirs(platform_dir, exist_ok=True)
+    env = dict(os.environ, HOST_SCREENSHOT_DIR=platform_dir)
+    try:
+        result = subprocess.run(
+            [os.path.join(HOST_DIR, 'build', platform, 'screenshot')],
+            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+            universal_newlines=True, env=env, timeout=timeout_s)
+    except subprocess.TimeoutExpired:
+        return ['run never finished']
+    problems, taken, expected = [], 0, None
+    for line in result.stdout.splitlines():
+        match = SHOT_RE.search(line)
+        if match:
+            taken += 1
+            continue
+        match = WRITE_ERROR_RE.search(line)
+        if match:
+            problems.append("couldn't write " + match.group(1))
+            continue
+        match = DONE_RE.search(line)
+        if match:
+            expected = int(match.group(1))
+    if expected is None:
+        problems.append('run never finished')
+    elif taken != expected:
+        problems.append('{} of {} shots taken'.format(taken, expected))
+    return problems
+
+
+def capture_emulator(platform, out_dir, timeout_s):
+    """Installs the built app on one emulator and grabs each shot it holds.
+    Returns a list of problems"""
+    platform_dir = os.path.join(out_dir, platform)
+    os.makedirs(platform_dir, exist_ok=True)
+    problems, taken, expected = [], 0, None
+    proc = subprocess.Popen(
+        ['pebble', 'install', '--emulator', platform, '--logs'],
+        stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+        universal_newlines=True)
+    timer = threading.Timer(timeout_s, proc.terminate)
+    timer.start()
+    try:
+        for line in proc.stdout:
+            match = SHOT_RE.search(line)
+            if match:
+                path = os.path.join(platform_dir, match.group(1) + '.png')
+                result = subprocess.run(
+                    ['pebble', 'screenshot', '--no-open', '--emulator',
+                     platform, path],
+                    stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                    universal_newlines=True)
+                if result.returncode:
+                    problems.append('{}: {}'.format(
+                        match.group(1), result.stdout.strip()))
+                else:
+                    taken += 1
+                continue
+            match = DONE_RE.search(line)
+            if match:
+                expected = int(match.group(1))
+                break
+    finally:
+        proc.terminate()
+        proc.wait()
+        timer.cancel()
+    if expected is None:
+        problems.append('run never finished')
+    elif taken != expected:
+        problems.append('{} of {} shots taken'.format(taken, expected))
+    return problems
+
+
+def copy_to_store_page(out_dir):
+    """Recompressed on the way: the host writes its PNGs uncompressed"""
+    for name, (platform, shot) in sorted(STORE_PAGE_SHOTS.items()):
+        path = os.path.join(out_dir, platform, shot + '.png')
+        if not os.path.exists(path):
+            continue
+        write_png(os.path.join(STORE_PAGE_DIR, name + '.png'),
+                  *read_png(path))
+        print('store-page/{}.png'.format(name))
+
+
+def _paeth(a, b, c):
+    p = a + b - c
+    pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+    if pa <= pb and pa <= pc:
+        return a
+    return b if pb <= pc else c
+
+
+def read_png(path):
+    """Returns (width, height, rows of RGBA bytes). Only what screenshots
+    are written as: 8 bits per channel, no interlacing"""
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'\x89PNG\r\n\x1a\n':
+        raise ValueError('{}: not a PNG'.format(path))
+    pos, idat, palette = 8, b'', None
+    while pos < len(data):
+        length, kind = struct.unpack('>I4s', data[pos:pos + 8])
+        chunk = data[pos + 8:pos + 8 + length]
+        pos += length + 12
+        if kind == b'IHDR':
+            width, height, depth, color_type, _, _, interlace = struct.unpack(
+                '>IIBBBBB', chunk)
+            if depth != 8 or interlace:
+                raise ValueError('{}: unsupported PNG layout'.format(path))
+        elif kind == b'PLTE':
+            palette = [chunk[i:i + 3] + b'\xff'
+                       for i in range(0, len(chunk), 3)]
+        elif kind == b'IDAT':
+            idat += chunk
+    channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color_type]
+    raw = zlib.decompress(idat)
+    stride = width * channels
+    rows, prev = [], bytearray(stride)
+    for y in range(height):
+        start = y * (stride + 1)
+        kind = raw[start]
+        line = bytearray(raw[start + 1:start + 1 + stride])
+        for x in range(stride):
+            a = line[x - channels] if x >= channels else 0
+            b = prev[x]
+            c = prev[x - channels] if x >= channels else 0
+            line[x] = (line[x] + (0, a, b, (a + b) // 2,
+                                  _paeth(a, b, c))[kind]) & 0xFF
+        prev = line
+        if color_type == 3:
+            rows.append(b''.join(palette[i] for i in line))
+        elif color_type == 2:
+            rows.append(b''.join(bytes(line[i:i + 3]) + b'\xff'
+                                 for i in range(0, stride, 3)))
+        elif color_type in (0, 4):
+            rows.append(b''.join(
+                bytes([line[i]] * 3) +
+                (bytes([line[i + 1]]) if color_type == 4 else b'\xff')
+                for i in range(0, stride, channels)))
+        else:
+            rows.append(bytes(line))
+    return width, height, rows
+
+
+def write_png(path, width, height, rows):
+    """Rows of RGBA bytes, as read_png() returns them"""
+    def chunk(kind, data):
+        return (struct.pack('>I', len(data)) + kind + data +
+                struct.pack('>I', zlib.crc32(kind + data) & 0xFFFFFFFF))
+    raw = b''.join(b'\x00' + bytes(row) for row in rows)
+    with open(path, 'wb') as f:
+        f.write(b'\x89PNG\r\n\x1a\n')
+        f.write(chunk(b'IHDR', struct.pack('>IIBBBBB', width, height, 8, 6,
+                                           0, 0, 0)))
+        f.write(chunk(b'IDAT', zlib.compress(raw, 9)))
+        f.write(chunk(b'IEND', b''))
+
+
+def compare_png(args):
+    """Returns (name, problem or None)"""
+    name, before, after = args
+    try:
+        w0, h0, rows0 = read_png(before)
+        w1, h1, rows1 = read_png(after)
+    except (OSError, ValueError) as e:
+        return name, str(e)
+    if (w0, h0) != (w1, h1):
+        return name, 'size {}x{} -> {}x{}'.format(w0, h0, w1, h1)
+    changed = [y for y in range(h0) if rows0[y] != rows1[y]]
+    if changed:
+        return name, '{} rows differ, first at y={}'.format(len(changed),
+                                                            changed[0])
+    return name, None
+
+
+def compare_dirs(before_dir, after_dir):
+    jobs = []
+    for root, _, files in os.walk(before_dir):
+        for name in sorted(files):
+            if name.endswith('.png'):
+                rel = os.path.relpath(os.path.join(root, name), before_dir)
+                jobs.append((rel, os.path.join(before_dir, rel),
+                             os.path.join(after_dir, rel)))
+    if not jobs:
+        print('no screenshots in ' + before_dir)
+        return 1
+    # Decoding is pure Python, so spread it over every core
+    with multiprocessing.Pool(min(len(jobs), os.cpu_count() or 1)) as pool:
+        results = pool.map(compare_png, jobs)
+    failed = False
+    for name, problem in results:
+        if problem:
+            failed = True
+            print('{}: {}'.format(name, problem))
+    print('{} of {} screenshots identical'.format(
+        sum(1 for _, p in results if not p), len(results)))
+    return 1 if failed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    sub = parser.add_subparsers(dest='command')
+    run = sub.add_parser('run', help='capture every platform')
+    run.add_argument('--platforms', nargs='+', default=PLATFORMS,
+                     choices=PLATFORMS)
+    run.add_argument('--emulator', action='store_true',
+                     help='capture the pebble build on the emulators instead')
+    run.add_argument('--out-dir', default='screenshots')
+    run.add_argument('--timeout', type=int, default=600,
+                     help='seconds to give each platform')
+    run.add_argument('--store-page', action='store_true',
+                     help='then copy the shots over store-page/')
+    compare = sub.add_parser('compare', help='compare two runs')
+    compare.add_argument('before')
+    compare.add_argument('after')
+    args = parser.parse_args()
+
+    if args.command == 'compare':
+        return compare_dirs(args.before, args.after)
+    if args.command != 'run':
+        parser.print_help()
+        return 2
+
+    jobs = [(p, args.out_dir, args.timeout) for p in args.platforms]
+    if args.emulator:
+        # Emulators are separate processes; the threads only wait on them
+        with ThreadPool(len(jobs)) as pool:
+            results = pool.starmap(capture_emulator, jobs)
+    else:
+        subprocess.check_call(['make', '-C', HOST_DIR, '-j{}'.format(
+            os.cpu_count() or 1)] + ['build/{}/screenshot'.format(p)
+                                     for p in args.platforms])
+        with multiprocessing.Pool(len(jobs)) as pool:
+            results = pool.starmap(capture_host, jobs)
+    failed = False
+    for platform, problems in zip(args.platforms, results):
+        if problems:
+            failed = True
+            print('{}: {} problem(s)'.format(platform, len(problems)))
+            for problem in problems:
+                print('  ' + problem)
+        else:
+            print('{}: ok'.format(platform))
+    if args.store_page and not failed:
+        copy_to_store_page(args.out_dir)
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
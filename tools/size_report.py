@@ -0,0 +1,68 @@
+"""
+Reports each platform's .text/.data/.bss (from the app ELF) and resource
+pack size, and checks them against tools/size_budgets.json. Run from wscript
+after every build, which fails if a budget is exceeded.
+
+Sizes are summed the way `size` (Berkeley format) does: text is every
+allocated read-only section, data every allocated writable one, bss the
+allocated ones with no file contents.
+"""
+
+import json
+import os
+import struct
+
+SHT_NOBITS = 8
+SHF_WRITE = 0x1
+SHF_ALLOC = 0x2
+
+
+def elf_sizes(path):
+    """Returns (text, data, bss) of a 32-bit little-endian ELF"""
+    with open(path, 'rb') as f:
+        elf = f.read()
+    if elf[:4] != b'\x7fELF' or elf[4:5] != b'\x01' or elf[5:6] != b'\x01':
+        raise ValueError('{} is not a 32-bit little-endian ELF'.format(path))
+
+    shoff, = struct.unpack_from('<I', elf, 0x20)
+    shentsize, shnum = struct.unpack_from('<HH', elf, 0x2E)
+    text = data = bss = 0
+    for i in range(shnum):
+        _, kind, flags, _, _, size = struct.unpack_from(
+            '<IIIIII', elf, shoff + (i * shentsize))
+        if not flags & SHF_ALLOC:
+            continue
+        if kind == SHT_NOBITS:
+            bss += size
+        elif flags & SHF_WRITE:
+            data += size
+        else:
+            text += size
+    return text, data, bss
+
+
+def load_budgets(path):
+    with open(path) as f:
+        return json.load(f)
+
+
+def check(platform, elf_path, pbpack_path, budgets):
+    """Logs one platform's report; returns the budgets it broke"""
+    text, data, bss = elf_sizes(elf_path)
+    static = text + data + bss
+    resources = (os.path.getsize(pbpack_path)
+                 if os.path.exists(pbpack_path) else 0)
+    budget = budgets.get(platform, {})
+
+    line = ('SIZE {:8} text={} data={} bss={} static={} resources={}'
+            .format(platform, text, data, bss, static, resources))
+    if 'app_memory' in budget:
+        line += ' heap_left={}'.format(budget['app_memory'] - static)
+    print(line)
+
+    failures = []
+    for name, value in (('static', static), ('resources', resources)):
+        if name in budget and value > budget[name]:
+            failures.append('{} {} is {} bytes, over its budget of {}'
+                            .format(platform, name, value, budget[name]))
+    return failures
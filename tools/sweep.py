@@ -0,0 +1,329 @@
+"""
+Runs the SWEEP_MODE build (see src/c/common.h) for every platform at once and
+checks the row hashes it logs against tools/sweep_golden. Any row whose
+hashes moved, any row that hashed differently at a random time than at the
+value time showing the same value, and any draw flagged as out of bounds
+fails the run.
+
+    python3 tools/sweep.py run           # host builds (host/Makefile)
+    python3 tools/sweep.py run --update  # accept the current frames
+    pebble build                         # with SWEEP_MODE uncommented
+    python3 tools/sweep.py run --emulator --golden-dir sweep_golden_emu
+    python3 tools/sweep.py compare sweep_logs/basalt.log ...
+
+A change that shouldn't alter a single pixel (a cache, a faster blitter)
+should leave the golden files untouched.
+"""
+
+import argparse
+import multiprocessing
+import os
+import re
+import subprocess
+import sys
+import threading
+from multiprocessing.pool import ThreadPool
+
+PLATFORMS = ['aplite', 'basalt', 'diorite', 'flint', 'emery']
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+HOST_DIR = os.path.join(os.path.dirname(HERE), 'host')
+GOLDEN_DIR = os.path.join(HERE, 'sweep_golden')
+
+FRAME_RE = re.compile(r'SWEEP s=(0x[0-9a-f]{2}) t=(\d+) 24h=(\d) '
+                      r'(?:at=([\d:,]+) )?((?:[0-9a-f]{8} )+)flags=(\d+)')
+FLAG_RE = re.compile(r'SWEEP flag (.*)')
+START_RE = re.compile(r'SWEEP start cases=(\d+) rows=(\d+) value_times=(\d+)')
+DONE_RE = re.compile(r'SWEEP done cases=(\d+)')
+
+# Replaces whatever said where the golden file's hashes came from
+UPDATE_HEADER = '# Written by tools/sweep.py run --update\n'
+
+
+def value_time(hour, minute, second, wday, mon, mday):
+    """For each row, top to bottom (RowSlot in watchface.c), the value time
+    that shows the same value; see harness_case_time() in harness.c"""
+    return [hour, minute, second, wday, mon, mday - 1]
+
+
+def run_host(platform, log_path, timeout_s, slice_idx, slice_count):
+    """Runs one slice of one platform's host build of the sweep"""
+    env = dict(os.environ,
+               HOST_SWEEP_SLICE='{}/{}'.format(slice_idx, slice_count))
+    with open(log_path, 'w') as log:
+        subprocess.run([os.path.join(HOST_DIR, 'build', platform, 'sweep')],
+                       stdout=log, stderr=subprocess.STDOUT, env=env,
+                       timeout=timeout_s)
+    return log_path
+
+
+def run_host_sliced(platforms, log_dir, timeout_s):
+    """Splits each platform's cases across a process per core, then joins
+    each platform's slices back into one log"""
+    slice_count = os.cpu_count() or 1
+    slice_logs = {p: [os.path.join(log_dir, '{}.{}.log'.format(p, i))
+                      for i in range(slice_count)] for p in platforms}
+    jobs = [(p, log, timeout_s, i, slice_count)
+            for p in platforms for i, log in enumerate(slice_logs[p])]
+    # Sweeps are separate processes; the threads only wait on them
+    with ThreadPool(slice_count) as pool:
+        pool.starmap(run_host, jobs)
+    for platform in platforms:
+        with open(os.path.join(log_dir, platform + '.log'), 'w') as log:
+            for slice_log in slice_logs[platform]:
+                with open(slice_log) as f:
+                    log.write(f.read())
+                os.remove(slice_log)
+
+
+def run_emulator(platform, log_path, timeout_s):
+    """Installs the built app on one emulator and logs until the sweep ends"""
+    with open(log_path, 'w') as log:
+        proc = subprocess.Popen(
+            ['pebble', 'install', '--emulator', platform, '--logs'],
+            stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+            universal_newlines=True)
+        timer = threading.Timer(timeout_s, proc.terminate)
+        timer.start()
+        try:
+            for line in proc.stdout:
+                log.write(line)
+                if DONE_RE.search(line):
+                    break
+        finally:
+            proc.terminate()
+            proc.wait()
+            timer.cancel()
+    return log_path
+
+
+class Sweep(object):
+    """What one platform's log holds, from one run or several slices"""
+
+    def __init__(self):
+        # (settings, 24h) -> {t: row hashes}
+        self.frames = {}
+        # (settings, 24h, t) -> the random time's fields
+        self.random_times = {}
+        self.flags = []
+        self.row_count = None
+        self.value_times = None
+        self.expected = 0
+        self.starts = 0
+        self.dones = 0
+
+    def frame_count(self):
+        return sum(len(by_t) for by_t in self.frames.values())
+
+
+def parse_log(path):
+    sweep = Sweep()
+    with open(path) as f:
+        for line in f:
+            match = FRAME_RE.search(line)
+            if match:
+                settings, t, is_24h, at, hashes, flags = match.groups()
+                case = (settings, int(is_24h))
+                sweep.frames.setdefault(case, {})[int(t)] = hashes.split()
+                if at:
+                    sweep.random_times[case + (int(t),)] = [
+                        int(v) for v in re.split('[:,]', at)]
+                if int(flags):
+                    sweep.flags.append('s={} t={} 24h={} flagged {} draws'
+                                       .format(settings, t, is_24h, flags))
+                continue
+            match = FLAG_RE.search(line)
+            if match:
+                sweep.flags.append(match.group(1))
+                continue
+            match = START_RE.search(line)
+            if match:
+                sweep.expected += int(match.group(1))
+                sweep.row_count = int(match.group(2))
+                sweep.value_times = int(match.group(3))
+                sweep.starts += 1
+                continue
+            if DONE_RE.search(line):
+                sweep.dones += 1
+    return sweep
+
+
+def fnv1a(text):
+    hash = 2166136261
+    for byte in text.encode():
+        hash = ((hash ^ byte) * 16777619) & 0xFFFFFFFF
+    return hash
+
+
+def golden_rows(sweep):
+    """One hash per row per (settings, clock style), over that row's hashes at
+    every value time in order: the random times only repeat them"""
+    golden = {}
+    for case, by_t in sweep.frames.items():
+        rows = []
+        for row in range(sweep.row_count):
+            text = ' '.join(by_t[t][row] for t in range(sweep.value_times))
+            rows.append('{:08x}'.format(fnv1a(text)))
+        golden[case] = rows
+    return golden
+
+
+def case_name(case):
+    return 's={} 24h={}'.format(*case)
+
+
+def _case_order(case):
+    return int(case[1]), int(case[0], 16)
+
+
+def golden_path(golden_dir, platform):
+    return os.path.join(golden_dir, platform + '.txt')
+
+
+def read_golden(golden_dir, platform):
+    path = golden_path(golden_dir, platform)
+    if not os.path.exists(path):
+        return None
+    golden = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if fields and not fields[0].startswith('#'):
+                settings = fields[0].split('=')[1]
+                is_24h = int(fields[1].split('=')[1])
+                golden[(settings, is_24h)] = fields[2:]
+    return golden
+
+
+def write_golden(golden_dir, platform, golden):
+    os.makedirs(golden_dir, exist_ok=True)
+    with open(golden_path(golden_dir, platform), 'w') as f:
+        f.write(UPDATE_HEADER)
+        for case in sorted(golden, key=_case_order):
+            f.write('{} {}\n'.format(case_name(case), ' '.join(golden[case])))
+
+
+def check_random_times(sweep):
+    """Each row at a random time must hash as it did at the value time that
+    shows the same value, or the rows aren't independent and the value times
+    don't cover every frame"""
+    problems = []
+    for (settings, is_24h, t), fields in sorted(sweep.random_times.items()):
+        by_t = sweep.frames[(settings, is_24h)]
+        for row, match_t in enumerate(value_time(*fields)):
+            if by_t[t][row] != by_t[match_t][row]:
+                problems.append(
+                    's={} t={} 24h={} row {} differs from t={}'.format(
+                        settings, t, is_24h, row, match_t))
+    return problems
+
+
+def check(platform, log_path, golden_dir, update):
+    """Returns a list of problems with one platform's sweep"""
+    sweep = parse_log(log_path)
+    problems = list(sweep.flags)
+    if sweep.starts == 0 or sweep.dones != sweep.starts:
+        return problems + ['sweep never finished']
+    if sweep.frame_count() != sweep.expected:
+        return problems + ['{} of {} frames logged'.format(
+            sweep.frame_count(), sweep.expected)]
+    problems += check_random_times(sweep)
+    current = golden_rows(sweep)
+    if update:
+        if not problems:
+            write_golden(golden_dir, platform, current)
+        return problems
+
+    golden = read_golden(golden_dir, platform)
+    if golden is None:
+        return problems + ['no golden file; run with --update first']
+    for case in sorted(golden, key=_case_order):
+        if case not in current:
+            problems.append('{} missing'.format(case_name(case)))
+            continue
+        rows = [str(i) for i, (a, b) in
+                enumerate(zip(current[case], golden[case])) if a != b]
+        if rows:
+            problems.append('{} rows {} changed'.format(case_name(case),
+                                                        ','.join(rows)))
+    return problems
+
+
+def _check_job(args):
+    platform, log_path, golden_dir, update = args
+    return platform, check(platform, log_path, golden_dir, update)
+
+
+def platform_of(log_path):
+    name = os.path.splitext(os.path.basename(log_path))[0]
+    if name not in PLATFORMS:
+        raise SystemExit('{}: name logs after their platform, like '
+                         'basalt.log'.format(log_path))
+    return name
+
+
+def report(results):
+    failed = False
+    for platform, problems in results:
+        if problems:
+            failed = True
+            print('{}: {} problem(s)'.format(platform, len(problems)))
+            for problem in problems[:20]:
+                print('  ' + problem)
+            if len(problems) > 20:
+                print('  ...')
+        else:
+            print('{}: ok'.format(platform))
+    return 1 if failed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    sub = parser.add_subparsers(dest='command')
+    run = sub.add_parser('run', help='sweep every platform, then compare')
+    run.add_argument('--platforms', nargs='+', default=PLATFORMS,
+                     choices=PLATFORMS)
+    run.add_argument('--emulator', action='store_true',
+                     help='sweep the pebble build on the emulators instead')
+    run.add_argument('--log-dir', default='sweep_logs')
+    run.add_argument('--timeout', type=int, default=3600,
+                     help='seconds to give each sweep')
+    compare = sub.add_parser('compare', help='compare existing logs')
+    compare.add_argument('logs', nargs='+')
+    for command in (run, compare):
+        command.add_argument('--golden-dir', default=GOLDEN_DIR)
+        command.add_argument('--update', action='store_true',
+                             help='write the golden files instead of '
+                                  'comparing')
+    args = parser.parse_args()
+
+    if args.command == 'run':
+        if not args.emulator:
+            subprocess.check_call(['make', '-C', HOST_DIR, '-j{}'.format(
+                os.cpu_count() or 1)] + ['build/{}/sweep'.format(p)
+                                         for p in args.platforms])
+        os.makedirs(args.log_dir, exist_ok=True)
+        logs = [(p, os.path.join(args.log_dir, p + '.log'))
+                for p in args.platforms]
+        if args.emulator:
+            # One emulator per platform; the threads only wait on them
+            with ThreadPool(len(logs)) as pool:
+                pool.starmap(run_emulator, [(p, log, args.timeout)
+                                            for p, log in logs])
+        else:
+            run_host_sliced(args.platforms, args.log_dir, args.timeout)
+        checks = [(p, log, args.golden_dir, args.update) for p, log in logs]
+    elif args.command == 'compare':
+        checks = [(platform_of(log), log, args.golden_dir, args.update)
+                  for log in args.logs]
+    else:
+        parser.print_help()
+        return 2
+
+    with multiprocessing.Pool(min(len(checks), os.cpu_count() or 1)) as pool:
+        results = pool.map(_check_job, checks)
+    return report(results)
+
+
+if __name__ == '__main__':
+    sys.exit(main())